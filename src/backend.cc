@@ -23,6 +23,7 @@
 #include <functional>      // for _Bind, less, bind, function
 #include <map>             // for multimap, _Rb_tree_iterator
 #include <utility>         // for pair, make_pair
+#include <vector>          // for vector
 
 #include "vm/vm.h"
 
@@ -187,7 +188,7 @@ void clear_tick_events() {
 }
 
 namespace {
-void look_for_objects_to_swap(void);
+void process_reset_queue();
 }
 
 // FIXME:
@@ -205,7 +206,7 @@ void backend(struct event_base *base) {
 
   // Register various tick events
   add_gametick_event(std::chrono::seconds(0), tick_event::callback_type(call_heart_beat));
-  add_gametick_event(std::chrono::minutes(5), tick_event::callback_type(look_for_objects_to_swap));
+  add_gametick_event(std::chrono::seconds(0), tick_event::callback_type(process_reset_queue));
   add_gametick_event(std::chrono::minutes(30),
                      tick_event::callback_type(std::bind(reclaim_objects, true)));
 #ifdef PACKAGE_MUDLIB_STATS
@@ -235,118 +236,276 @@ void backend(struct event_base *base) {
 
 namespace {
 /*
- * Despite the name, this routine takes care of several things.
- * It will run once every 5 minutes.
+ * Objects get reset() and clean_up() called from a queue ordered on the
+ * gametick either of them is due, instead of a sweep over all objects every
+ * 5 minutes.  The queue is a binary heap, and every object remembers its
+ * position in it, so it can be moved when set_reset() changes its time, and
+ * taken out when it is destructed.
  *
- * . It will loop through all objects.
- *
- *   . If an object is found in a state of not having done reset, and the
- *     delay to next reset has passed, then reset() will be done.
- *
- *   . If the object has a existed more than the time limit given for swapping,
- *     then 'clean_up' will first be called in the object
- *
- * There are some problems if the object self-destructs in clean_up, so
- * special care has to be taken of how the linked list is used.
+ * The due time is only a lower bound: the object may have been referenced,
+ * or reset some other way, since.  Objects are checked when it comes up and
+ * queued again for whatever is due next.  If something was due but couldn't
+ * be done (the object is still in its reset state, or clean_up() asked to
+ * be called again), it is checked again in 5 minutes, like the old sweep.
  */
-void look_for_objects_to_swap() {
+struct reset_entry_t {
+  uint64_t due;
+  object_t *ob;
+};
+std::vector<reset_entry_t> reset_heap;
+
+struct reset_queue_stats_t {
+  uint64_t resets;
+  uint64_t clean_ups;
+  uint64_t tick_resets;
+  uint64_t tick_clean_ups;
+  uint64_t tick_usec;
+};
+reset_queue_stats_t reset_stats;
+
+const uint64_t kNotDue = UINT64_MAX;
+
+// ob->reset_queue_index is its position in the heap plus one, 0 if it isn't in it.
+void reset_heap_set(size_t i, const reset_entry_t &entry) {
+  reset_heap[i] = entry;
+  entry.ob->reset_queue_index = i + 1;
+}
+
+void reset_heap_up(size_t i) {
+  auto entry = reset_heap[i];
+  while (i > 0) {
+    auto parent = (i - 1) / 2;
+    if (reset_heap[parent].due <= entry.due) {
+      break;
+    }
+    reset_heap_set(i, reset_heap[parent]);
+    i = parent;
+  }
+  reset_heap_set(i, entry);
+}
+
+void reset_heap_down(size_t i) {
+  auto entry = reset_heap[i];
+  auto n = reset_heap.size();
+  while (2 * i + 1 < n) {
+    auto child = 2 * i + 1;
+    if (child + 1 < n && reset_heap[child + 1].due < reset_heap[child].due) {
+      child++;
+    }
+    if (entry.due <= reset_heap[child].due) {
+      break;
+    }
+    reset_heap_set(i, reset_heap[child]);
+    i = child;
+  }
+  reset_heap_set(i, entry);
+}
+
+// When reset() or clean_up() has to be looked at next, kNotDue for never.
+uint64_t reset_due(object_t *ob) {
+  auto now = g_current_gametick;
+  auto recheck = now + time_to_gametick(std::chrono::minutes(5));
+  auto due = kNotDue;
+
+  if (!CONFIG_INT(__RC_NO_RESETS__) && !CONFIG_INT(__RC_LAZY_RESETS__) &&
+      (ob->flags & O_WILL_RESET)) {
+    uint64_t next_reset = ob->next_reset;
+    due = next_reset > now ? next_reset : recheck;
+  }
   auto time_to_clean_up = CONFIG_INT(__TIME_TO_CLEAN_UP__);
+  if (time_to_clean_up > 0 && (ob->flags & O_WILL_CLEAN_UP)) {
+    uint64_t clean_up =
+        ob->time_of_ref + time_to_gametick(std::chrono::seconds(time_to_clean_up));
+    due = std::min(due, clean_up > now ? clean_up : recheck);
+  }
+  return due;
+}
 
-  /* Next time is in 5 minutes */
-  add_gametick_event(std::chrono::seconds(5 * 60),
-                     tick_event::callback_type(look_for_objects_to_swap));
+/*
+ * Call reset() and clean_up() in the object if they are due, this is what
+ * the old sweep did for every object.
+ */
+void reset_and_clean_up(object_t *ob) {
+  auto time_to_clean_up = CONFIG_INT(__TIME_TO_CLEAN_UP__);
+  int ready_for_clean_up = 0;
 
-  object_t *ob, *next_ob, *last_good_ob;
   /*
-   * Objects object can be destructed, which means that next object to
-   * investigate is saved in next_ob. If very unlucky, that object can be
-   * destructed too. In that case, the loop is simply restarted.
+   * Check reference time before reset() is called.
    */
-  next_ob = obj_list;
-  last_good_ob = obj_list;
-  while (1) {
-    while ((ob = (object_t *)next_ob)) {
-      int ready_for_clean_up = 0;
-
+  if (gametick_to_time(g_current_gametick - ob->time_of_ref) >=
+      std::chrono::seconds(time_to_clean_up)) {
+    ready_for_clean_up = 1;
+  }
+  if (!CONFIG_INT(__RC_NO_RESETS__) && !CONFIG_INT(__RC_LAZY_RESETS__)) {
+    /*
+     * Should this object have reset(1) called ?
+     */
+    if ((ob->flags & O_WILL_RESET) && (g_current_gametick >= ob->next_reset) &&
+        !(ob->flags & O_RESET_STATE)) {
+      debug(d_flag, "RESET /%s\n", ob->obname);
+      reset_object(ob);
+      reset_stats.tick_resets++;
       if (ob->flags & O_DESTRUCTED) {
-        if (last_good_ob->flags & O_DESTRUCTED) {
-          ob = obj_list; /* restart */
-        } else {
-          ob = (object_t *)last_good_ob;
-        }
+        return;
       }
-      next_ob = ob->next_all;
+    }
+  }
+  if (time_to_clean_up > 0) {
+    /*
+     * Has enough time passed, to give the object a chance to
+     * self-destruct ? Save the O_RESET_STATE, which will be cleared.
+     *
+     * Only call clean_up in objects that has defined such a function.
+     *
+     * Only if the clean_up returns a non-zero value, will it be called
+     * again.
+     */
+
+    if (ready_for_clean_up && (ob->flags & O_WILL_CLEAN_UP)) {
+      int save_reset_state = ob->flags & O_RESET_STATE;
+
+      debug(d_flag, "clean up /%s\n", ob->obname);
 
       /*
-       * Check reference time before reset() is called.
+       * Supply a flag to the object that says if this program is
+       * inherited by other objects. Cloned objects might as well
+       * believe they are not inherited. Swapped objects will not
+       * have a ref count > 1 (and will have an invalid ob->prog
+       * pointer).
+       *
+       * Note that if it is in the apply_low cache, it will also
+       * get a flag of 1, which may cause the mudlib not to clean
+       * up the object.  This isn't bad because:
+       * (1) one expects it is rare for objects that have untouched
+       * long enough to clean_up to still be in the cache, especially
+       * on busy MUDs.
+       * (2) the ones that are are the more heavily used ones, so
+       * keeping them around seems justified.
        */
-      if (gametick_to_time(g_current_gametick - ob->time_of_ref) >=
-          std::chrono::seconds(time_to_clean_up)) {
-        ready_for_clean_up = 1;
-      }
-      if (!CONFIG_INT(__RC_NO_RESETS__) && !CONFIG_INT(__RC_LAZY_RESETS__)) {
-        /*
-         * Should this object have reset(1) called ?
-         */
-        if ((ob->flags & O_WILL_RESET) && (g_current_gametick >= ob->next_reset) &&
-            !(ob->flags & O_RESET_STATE)) {
-          debug(d_flag, "RESET /%s\n", ob->obname);
-          reset_object(ob);
-          if (ob->flags & O_DESTRUCTED) {
-            continue;
-          }
-        }
+
+      push_number(ob->flags & (O_CLONE) ? 0 : ob->prog->ref);
+      set_eval(max_eval_cost);
+      auto svp = safe_apply(APPLY_CLEAN_UP, ob, 1, ORIGIN_DRIVER);
+      reset_stats.tick_clean_ups++;
+      if (ob->flags & O_DESTRUCTED) {
+        return;
       }
-      if (time_to_clean_up > 0) {
-        /*
-         * Has enough time passed, to give the object a chance to
-         * self-destruct ? Save the O_RESET_STATE, which will be cleared.
-         *
-         * Only call clean_up in objects that has defined such a function.
-         *
-         * Only if the clean_up returns a non-zero value, will it be called
-         * again.
-         */
-
-        if (ready_for_clean_up && (ob->flags & O_WILL_CLEAN_UP)) {
-          int save_reset_state = ob->flags & O_RESET_STATE;
-
-          debug(d_flag, "clean up /%s\n", ob->obname);
-
-          /*
-           * Supply a flag to the object that says if this program is
-           * inherited by other objects. Cloned objects might as well
-           * believe they are not inherited. Swapped objects will not
-           * have a ref count > 1 (and will have an invalid ob->prog
-           * pointer).
-           *
-           * Note that if it is in the apply_low cache, it will also
-           * get a flag of 1, which may cause the mudlib not to clean
-           * up the object.  This isn't bad because:
-           * (1) one expects it is rare for objects that have untouched
-           * long enough to clean_up to still be in the cache, especially
-           * on busy MUDs.
-           * (2) the ones that are are the more heavily used ones, so
-           * keeping them around seems justified.
-           */
-
-          push_number(ob->flags & (O_CLONE) ? 0 : ob->prog->ref);
-          set_eval(max_eval_cost);
-          auto svp = safe_apply(APPLY_CLEAN_UP, ob, 1, ORIGIN_DRIVER);
-          if (!svp || (svp->type == T_NUMBER && svp->u.number == 0)) {
-            ob->flags &= ~O_WILL_CLEAN_UP;
-          }
-          ob->flags |= save_reset_state;
-        }
+      if (!svp || (svp->type == T_NUMBER && svp->u.number == 0)) {
+        ob->flags &= ~O_WILL_CLEAN_UP;
       }
-      last_good_ob = ob;
+      ob->flags |= save_reset_state;
+    }
+  }
+}
+
+/*
+ * Runs every gametick: handle the objects that are due, until there are
+ * none left or "reset budget msec" is used up.
+ */
+void process_reset_queue() {
+  add_gametick_event(gametick_to_time(1), tick_event::callback_type(process_reset_queue));
+
+  auto budget = std::chrono::milliseconds(CONFIG_INT(__RC_RESET_BUDGET_MSEC__));
+  auto start = std::chrono::steady_clock::now();
+
+  reset_stats.tick_resets = 0;
+  reset_stats.tick_clean_ups = 0;
+  while (!reset_heap.empty() && reset_heap.front().due <= g_current_gametick) {
+    auto ob = reset_heap.front().ob;
+    reset_queue_remove(ob);
+    reset_and_clean_up(ob);
+    if (!(ob->flags & O_DESTRUCTED)) {
+      reset_queue_update(ob);
+    }
+    if (budget.count() > 0 && std::chrono::steady_clock::now() - start >= budget) {
+      break;
     }
-    break;
   }
-} /* look_for_objects_to_swap() */
+  reset_stats.resets += reset_stats.tick_resets;
+  reset_stats.clean_ups += reset_stats.tick_clean_ups;
+  reset_stats.tick_usec = std::chrono::duration_cast<std::chrono::microseconds>(
+                              std::chrono::steady_clock::now() - start)
+                              .count();
+}
 
+// Objects in the subtree of the heap at i that are due now.
+size_t reset_queue_due(size_t i) {
+  if (i >= reset_heap.size() || reset_heap[i].due > g_current_gametick) {
+    return 0;
+  }
+  return 1 + reset_queue_due(2 * i + 1) + reset_queue_due(2 * i + 2);
+}
 }  // namespace
 
+void reset_queue_update(object_t *ob) {
+  auto due = reset_due(ob);
+  if (due == kNotDue) {
+    reset_queue_remove(ob);
+    return;
+  }
+  if (ob->reset_queue_index) {
+    auto i = ob->reset_queue_index - 1;
+    auto old_due = reset_heap[i].due;
+    reset_heap[i].due = due;
+    if (due < old_due) {
+      reset_heap_up(i);
+    } else {
+      reset_heap_down(i);
+    }
+    return;
+  }
+  reset_heap.push_back({due, ob});
+  reset_heap_up(reset_heap.size() - 1);
+}
+
+void reset_queue_remove(object_t *ob) {
+  if (!ob->reset_queue_index) {
+    return;
+  }
+  auto i = ob->reset_queue_index - 1;
+  ob->reset_queue_index = 0;
+  auto last = reset_heap.back();
+  reset_heap.pop_back();
+  if (i < reset_heap.size()) {
+    auto old_due = reset_heap[i].due;
+    reset_heap_set(i, last);
+    if (last.due < old_due) {
+      reset_heap_up(i);
+    } else {
+      reset_heap_down(i);
+    }
+  }
+}
+
+mapping_t *reset_queue_status() {
+  auto m = allocate_mapping(7);
+  add_mapping_pair(m, "queued", reset_heap.size());
+  add_mapping_pair(m, "due", reset_queue_due(0));
+  add_mapping_pair(m, "resets", reset_stats.resets);
+  add_mapping_pair(m, "clean ups", reset_stats.clean_ups);
+  add_mapping_pair(m, "tick resets", reset_stats.tick_resets);
+  add_mapping_pair(m, "tick clean ups", reset_stats.tick_clean_ups);
+  add_mapping_pair(m, "tick usec", reset_stats.tick_usec);
+  return m;
+}
+
+mapping_t *reset_queue_status(object_t *ob) {
+  auto m = allocate_mapping(3);
+  auto queued = ob->reset_queue_index != 0;
+  add_mapping_pair(m, "queued", queued);
+  if (queued) {
+    auto &entry = reset_heap[ob->reset_queue_index - 1];
+    add_mapping_pair(m, "position", ob->reset_queue_index - 1);
+    // In seconds, negative if overdue.
+    auto ticks = static_cast<int64_t>(entry.due) - static_cast<int64_t>(g_current_gametick);
+    add_mapping_pair(m, "due in",
+                     std::chrono::duration_cast<std::chrono::seconds>(
+                         gametick_to_time(static_cast<int>(ticks)))
+                         .count());
+  }
+  return m;
+}
+
 namespace {
 // TODO: Figure out what to do with this.
 const int kNumConst = 5;
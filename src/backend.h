@@ -4,6 +4,8 @@
 #include <chrono>
 #include <functional>
 
+#include "base/internal/slab.h"
+
 /*
  * backend.c
  */
@@ -26,6 +28,10 @@ struct tick_event {
   callback_type callback;
 
   tick_event(callback_type &callback) : valid(true), callback(callback) {}
+
+  // Every call_out() makes one of these.
+  static void *operator new(size_t size) { return slab_alloc(size); }
+  static void operator delete(void *ptr, size_t size) { slab_free(ptr, size); }
 };
 
 // Register a event to run on game ticks.
@@ -42,6 +48,15 @@ void clear_tick_events();
 int time_to_gametick(std::chrono::milliseconds msec);
 std::chrono::milliseconds gametick_to_time(int ticks);
 
+// Reset and clean_up scheduling, call reset_queue_update() whenever an
+// object's next_reset changes, or it gets O_WILL_RESET or O_WILL_CLEAN_UP.
+void reset_queue_update(struct object_t *);
+void reset_queue_remove(struct object_t *);
+// Mapping for the reset_queue_status() efun.
+struct mapping_t *reset_queue_status();
+// Where ob is in the queue, for reset_queue_status(ob).
+struct mapping_t *reset_queue_status(struct object_t *ob);
+
 void update_load_av(void);
 void update_compile_av(int);
 char *query_load_av(void);
@@ -15,6 +15,9 @@
 #define PORT_MUD 4
 #define PORT_WEBSOCKET 5
 
+// Most SO_REUSEPORT listening sockets opened for one port.
+#define MAX_PORT_LISTENERS 16
+
 struct port_def_t {
   int kind;
   int port;
@@ -24,7 +27,8 @@ struct port_def_t {
   int in_volume;
   int out_packets;
   int out_volume;
-  struct evconnlistener *ev_conn;
+  struct evconnlistener *ev_conn[MAX_PORT_LISTENERS];
+  int num_listeners;
 };
 
 extern port_def_t external_port[5];
@@ -94,6 +94,21 @@ static const flagEntry kDefaultFlags[] = {
     {"enable_commands call init", __RC_ENABLE_COMMANDS_CALL_INIT__, 1},
     {"sprintf add_justified ignore ANSI colors", __RC_SPRINTF_ADD_JUSTFIED_IGNORE_ANSI_COLORS__, 1},
     {"call_out(0) nest level", __RC_CALL_OUT_ZERO_NEST_LEVEL__, 1000},
+    {"file cache size", __RC_FILE_CACHE_SIZE__, 0},
+    {"regexp cache size", __RC_REGEXP_CACHE_SIZE__, 256},
+    {"output batch size", __RC_OUTPUT_BATCH_SIZE__, 0},
+    {"worker threads", __RC_WORKER_THREADS__, 0},
+    {"listen sockets", __RC_LISTEN_SOCKETS__, 1},
+    {"logins per tick", __RC_LOGINS_PER_TICK__, 0},
+    {"login queue size", __RC_LOGIN_QUEUE_SIZE__, 1024},
+    {"output high watermark", __RC_OUTPUT_HIGH_WATERMARK__, 0},
+    {"output low watermark", __RC_OUTPUT_LOW_WATERMARK__, 0},
+    {"output overflow policy", __RC_OUTPUT_OVERFLOW_POLICY__, 1},
+    {"command budget msec", __RC_COMMAND_BUDGET_MSEC__, 0},
+    {"user commands per second", __RC_USER_COMMANDS_PER_SECOND__, 0},
+    {"reset budget msec", __RC_RESET_BUDGET_MSEC__, 0},
+    {"reclaim budget msec", __RC_RECLAIM_BUDGET_MSEC__, 0},
+    {"lazy init", __RC_LAZY_INIT__, 0},
 };
 
 void config_init() {
@@ -373,3 +388,12 @@ void read_config(char *filename) {
   config_lines.clear();
   config_lines.shrink_to_fit();
 }
+
+int config_int_index(const char *key) {
+  for (int i = 0; i < (sizeof(kDefaultFlags) / sizeof(flagEntry)); i++) {
+    if (kDefaultFlags[i].key == key) {
+      return kDefaultFlags[i].pos;
+    }
+  }
+  return -1;
+}
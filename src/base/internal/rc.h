@@ -18,6 +18,8 @@ constexpr int g_num_external_cmds = 100;
 extern char *external_cmd[g_num_external_cmds];
 
 void read_config(char *);
+// Index of the int setting called key in the config file, -1 if none.
+int config_int_index(const char *key);
 
 extern int config_int[NUM_CONFIG_INTS];
 extern char *config_str[NUM_CONFIG_STRS];
@@ -0,0 +1,236 @@
+/*
+ * slab.cc
+ *
+ * Blocks are handed out in size classes of 16 bytes up to SLAB_MAX_SIZE.
+ * Each thread keeps its own free list per class, so the common case takes
+ * no lock; it fetches blocks from, and returns surplus blocks to, the shared
+ * lists of the class in batches.  Chunks are never given back to the system,
+ * their blocks just wait on a free list for the next allocation of their
+ * size.
+ */
+
+#include "base/std.h"
+
+#include "base/internal/slab.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+#include "base/internal/outbuf.h"
+
+namespace {
+
+const size_t kGranule = 16;
+const int kNumClasses = SLAB_MAX_SIZE / kGranule;
+const size_t kChunkSize = 64 * 1024;
+// Bytes worth of blocks moved between a thread and the shared lists at once.
+const size_t kBatchBytes = 8 * 1024;
+
+size_t class_size(int cls) { return (cls + 1) * kGranule; }
+size_t batch_count(int cls) { return kBatchBytes / class_size(cls); }
+
+struct free_block_t {
+  free_block_t *next;
+};
+
+struct shared_class_t {
+  free_block_t *free;
+  size_t num_free;
+  size_t chunks;
+};
+
+struct cache_t;
+
+// Everything below is guarded by shared_mutex.
+std::mutex shared_mutex;
+shared_class_t shared[kNumClasses];
+
+std::vector<cache_t *> &caches() {
+  static auto *all = new std::vector<cache_t *>;
+  return *all;
+}
+
+struct cache_t {
+  free_block_t *free[kNumClasses] = {};
+  size_t num_free[kNumClasses] = {};
+  // Blocks this thread allocated minus the ones it freed.  Only the owning
+  // thread writes these, slab_status() reads them from anywhere.
+  std::atomic<int64_t> in_use[kNumClasses];
+
+  cache_t() {
+    for (auto &n : in_use) {
+      n.store(0, std::memory_order_relaxed);
+    }
+    std::lock_guard<std::mutex> lock(shared_mutex);
+    caches().push_back(this);
+  }
+};
+
+// Each thread gets its cache on first use and keeps it; the driver's threads
+// live as long as the driver does.
+thread_local cache_t *cache;
+
+cache_t *thread_cache() {
+  if (!cache) {
+    cache = new cache_t;
+  }
+  return cache;
+}
+
+// Cut a new chunk into blocks of cls, with shared_mutex held.
+void add_chunk(int cls) {
+  auto size = class_size(cls);
+  auto chunk = reinterpret_cast<char *>(malloc(kChunkSize));
+  if (!chunk) {
+    fatal("Out of memory allocating a slab.\n");
+  }
+  for (auto p = chunk; p + size <= chunk + kChunkSize; p += size) {
+    auto block = reinterpret_cast<free_block_t *>(p);
+    block->next = shared[cls].free;
+    shared[cls].free = block;
+    shared[cls].num_free++;
+  }
+  shared[cls].chunks++;
+}
+
+void refill(cache_t *c, int cls) {
+  std::lock_guard<std::mutex> lock(shared_mutex);
+  auto &s = shared[cls];
+  if (!s.free) {
+    add_chunk(cls);
+  }
+  for (auto n = batch_count(cls); n && s.free; n--) {
+    auto block = s.free;
+    s.free = block->next;
+    s.num_free--;
+    block->next = c->free[cls];
+    c->free[cls] = block;
+    c->num_free[cls]++;
+  }
+}
+
+void give_back(cache_t *c, int cls) {
+  std::lock_guard<std::mutex> lock(shared_mutex);
+  auto &s = shared[cls];
+  for (auto n = batch_count(cls); n && c->free[cls]; n--) {
+    auto block = c->free[cls];
+    c->free[cls] = block->next;
+    c->num_free[cls]--;
+    block->next = s.free;
+    s.free = block;
+    s.num_free++;
+  }
+}
+
+void count(std::atomic<int64_t> *n, int64_t d) {
+  n->store(n->load(std::memory_order_relaxed) + d, std::memory_order_relaxed);
+}
+}  // namespace
+
+int slab_class(size_t size) {
+  if (size > SLAB_MAX_SIZE) {
+    return -1;
+  }
+  return size ? (size - 1) / kGranule : 0;
+}
+
+void *slab_alloc_class(int cls) {
+  auto c = thread_cache();
+  if (!c->free[cls]) {
+    refill(c, cls);
+  }
+  auto block = c->free[cls];
+  c->free[cls] = block->next;
+  c->num_free[cls]--;
+  count(&c->in_use[cls], 1);
+  return block;
+}
+
+void slab_free_class(void *ptr, int cls) {
+  auto c = thread_cache();
+  auto block = reinterpret_cast<free_block_t *>(ptr);
+  block->next = c->free[cls];
+  c->free[cls] = block;
+  c->num_free[cls]++;
+  count(&c->in_use[cls], -1);
+  if (c->num_free[cls] > 4 * batch_count(cls)) {
+    give_back(c, cls);
+  }
+}
+
+void *slab_alloc(size_t size) {
+  auto cls = slab_class(size);
+  if (cls < 0) {
+    return malloc(size);
+  }
+  return slab_alloc_class(cls);
+}
+
+void *slab_calloc(size_t size) {
+  auto cls = slab_class(size);
+  if (cls < 0) {
+    return calloc(size, 1);
+  }
+  auto ptr = slab_alloc_class(cls);
+  memset(ptr, 0, size);
+  return ptr;
+}
+
+void *slab_realloc(void *ptr, size_t old_size, size_t size) {
+  auto old_cls = slab_class(old_size);
+  auto cls = slab_class(size);
+  if (old_cls == cls) {
+    return cls < 0 ? realloc(ptr, size) : ptr;
+  }
+  auto ret = slab_alloc(size);
+  if (ret) {
+    memcpy(ret, ptr, old_size < size ? old_size : size);
+  }
+  slab_free(ptr, old_size);
+  return ret;
+}
+
+void slab_free(void *ptr, size_t size) {
+  auto cls = slab_class(size);
+  if (cls < 0) {
+    free(ptr);
+    return;
+  }
+  slab_free_class(ptr, cls);
+}
+
+size_t slab_status(outbuffer_t *out, int verbose) {
+  std::lock_guard<std::mutex> lock(shared_mutex);
+
+  size_t total_chunks = 0;
+  int64_t total_blocks = 0, total_used = 0;
+  if (verbose) {
+    outbuf_add(out, "Slab allocator:\n");
+    outbuf_add(out, "Size\t  Chunks\t  In use\t    Free\n");
+  }
+  for (int cls = 0; cls < kNumClasses; cls++) {
+    int64_t used = 0;
+    for (auto c : caches()) {
+      used += c->in_use[cls].load(std::memory_order_relaxed);
+    }
+    int64_t blocks = shared[cls].chunks * (kChunkSize / class_size(cls));
+    total_chunks += shared[cls].chunks;
+    total_blocks += blocks;
+    total_used += used;
+    if (verbose && shared[cls].chunks) {
+      outbuf_addv(out, "%4zu\t%8zu\t%8" PRId64 "\t%8" PRId64 "\n", class_size(cls),
+                  shared[cls].chunks, used, blocks - used);
+    }
+  }
+  if (verbose) {
+    outbuf_addv(out, "Total\t%8zu\t%8" PRId64 "\t%8" PRId64 "\n", total_chunks, total_used,
+                total_blocks - total_used);
+  } else {
+    outbuf_addv(out, "Slabs (blocks in use):\t\t%8" PRId64 " %8zu\n", total_used,
+                total_chunks * kChunkSize);
+  }
+  return total_chunks * kChunkSize;
+}
@@ -0,0 +1,49 @@
+#ifndef SLAB_H
+#define SLAB_H
+
+#include <cstddef>
+
+#include "base/internal/debugmalloc.h"
+
+/*
+ * slab.cc
+ *
+ * Size class allocator for the small blocks the VM goes through all the
+ * time: arrays, mappings, strings, function pointers, refs.  Blocks of one
+ * size class are cut from 64k chunks and go back on a free list of their
+ * class, which keeps them from scattering over the heap.  Anything larger
+ * than SLAB_MAX_SIZE goes to malloc().
+ *
+ * The caller has to hand the size back when freeing, since there is no
+ * header.  With DEBUGMALLOC everything goes through debugmalloc instead,
+ * so checkmemory() keeps seeing every block.
+ */
+#define SLAB_MAX_SIZE 256
+
+void *slab_alloc(size_t size);
+void *slab_calloc(size_t size);
+void *slab_realloc(void *ptr, size_t old_size, size_t size);
+void slab_free(void *ptr, size_t size);
+
+// Blocks that did come from a slab, for callers that keep the class around.
+// slab_class() is -1 for sizes above SLAB_MAX_SIZE.
+int slab_class(size_t size);
+void *slab_alloc_class(int cls);
+void slab_free_class(void *ptr, int cls);
+
+// Per size class usage, returns the bytes held in chunks.
+size_t slab_status(struct outbuffer_t *out, int verbose);
+
+#ifdef DEBUGMALLOC
+#define SLAB_ALLOC(size, tag, desc) DMALLOC(size, tag, desc)
+#define SLAB_CALLOC(size, tag, desc) DCALLOC(size, 1, tag, desc)
+#define SLAB_REALLOC(ptr, old_size, size, tag, desc) DREALLOC(ptr, size, tag, desc)
+#define SLAB_FREE(ptr, size) FREE(ptr)
+#else
+#define SLAB_ALLOC(size, tag, desc) slab_alloc(size)
+#define SLAB_CALLOC(size, tag, desc) slab_calloc(size)
+#define SLAB_REALLOC(ptr, old_size, size, tag, desc) slab_realloc(ptr, old_size, size)
+#define SLAB_FREE(ptr, size) slab_free(ptr, size)
+#endif
+
+#endif
@@ -21,6 +21,12 @@ uint64_t inet_socket_in_volume = 0;
 uint64_t inet_socket_out_packets = 0;
 uint64_t inet_socket_out_volume = 0;
 
+// Command scheduler stats
+uint64_t user_commands = 0;
+uint64_t user_commands_throttled = 0;
+uint64_t command_slices_cut = 0;
+uint64_t command_queue_max_depth = 0;
+
 // Compiler stats
 uint64_t total_num_prog_blocks = 0;
 uint64_t total_prog_block_size = 0;
@@ -29,6 +35,7 @@ uint64_t total_prog_block_size = 0;
 uint64_t tot_alloc_object = 0;
 uint64_t tot_alloc_object_size = 0;
 uint64_t tot_dangling_object = 0;
+uint64_t tot_destructed_object = 0;
 
 // Array stats
 uint64_t num_arrays = 0;
@@ -42,6 +49,7 @@ uint64_t total_class_size = 0;
 uint64_t num_mappings = 0;
 uint64_t total_mapping_size = 0;
 uint64_t total_mapping_nodes = 0;
+uint64_t num_shared_mappings = 0;
 
 // Apply cache stats
 uint64_t apply_cache_lookups = 0;
@@ -28,12 +28,20 @@ extern uint64_t inet_socket_in_volume;
 extern uint64_t inet_socket_out_packets;
 extern uint64_t inet_socket_out_volume;
 
+// Command scheduler stats
+extern uint64_t user_commands;
+extern uint64_t user_commands_throttled;
+extern uint64_t command_slices_cut;
+extern uint64_t command_queue_max_depth;
+
 // Compiler stats
 extern uint64_t total_num_prog_blocks, total_prog_block_size;
 
 // Object stats
 extern uint64_t tot_alloc_object, tot_alloc_object_size;
 extern uint64_t tot_dangling_object;
+// Destructed objects that are still referenced from somewhere.
+extern uint64_t tot_destructed_object;
 
 // Array stats
 extern uint64_t num_arrays, total_array_size;
@@ -43,6 +51,8 @@ extern uint64_t num_classes, total_class_size;
 
 // Mapping stats
 extern uint64_t num_mappings, total_mapping_size, total_mapping_nodes;
+// Mappings that share the table of another one, see share_mapping().
+extern uint64_t num_shared_mappings;
 
 // Apply cache stats
 extern uint64_t apply_cache_lookups;
@@ -10,6 +10,7 @@
 #include "base/internal/log.h"
 #include "base/internal/outbuf.h"
 #include "base/internal/rc.h"
+#include "base/internal/slab.h"
 
 /* used temporarily by SVALUE_STRLEN() */
 unsigned int svalue_strlen_size;
@@ -86,9 +87,16 @@ static int htable_size_minus_one;
 
 static block_t *alloc_new_string(const char * /*string*/, int /*h*/);
 
+char short_strings[256][2];
+
 void init_strings() {
   int x, y;
 
+  for (x = 0; x < 256; x++) {
+    short_strings[x][0] = x;
+    short_strings[x][1] = '\0';
+  }
+
   /* ensure that htable size is a power of 2 */
   y = CONFIG_INT(__SHARED_STRING_HASH_TABLE_SIZE__);
   for (htable_size = 1; htable_size < y; htable_size *= 2) {
@@ -104,6 +112,13 @@ void init_strings() {
   }
 }
 
+const char *short_string(const char *str, int len) {
+  if (len > 1) {
+    return nullptr;
+  }
+  return short_strings[len ? static_cast<unsigned char>(*str) : 0];
+}
+
 /*
  * Looks for a string in the table.  If it finds it, returns a pointer to
  * the start of the string part, and moves the entry for the string to
@@ -159,7 +174,7 @@ static block_t *alloc_new_string(const char *string, int h) {
     cut = 1;
   }
   size = sizeof(block_t) + len + 1;
-  b = reinterpret_cast<block_t *>(DMALLOC(size, TAG_SHARED_STRING, "alloc_new_string"));
+  b = reinterpret_cast<block_t *>(SLAB_ALLOC(size, TAG_SHARED_STRING, "alloc_new_string"));
   strncpy(STRING(b), string, len);
   STRING(b)
   [len] = '\0'; /* strncpy doesn't put on \0 if 'from' too
@@ -256,7 +271,7 @@ void free_string(const char *str) {
   DEBUG_CHECK1(!b, "free_string: not found in string table! (\"%s\")\n", str);
 
   SUB_NEW_STRING(SIZE(b), sizeof(block_t));
-  FREE(b);
+  SLAB_FREE(b, sizeof(block_t) + SIZE(b) + 1);
   CHECK_STRING_STATS;
 }
 
@@ -276,7 +291,7 @@ void deallocate_string(char *str) {
   }
   DEBUG_CHECK1(!b, "stralloc.c: deallocate_string called on non-shared string: %s.\n", str);
   // printf("freeing string: %s\n", str);
-  FREE(b);
+  SLAB_FREE(b, sizeof(block_t) + SIZE(b) + 1);
 }
 
 int add_string_status(outbuffer_t *out, int verbose) {
@@ -310,6 +325,42 @@ malloc_block_t the_null_string_blocks[2] = { { DME 0, 1 }, { DME 0, 0 } };
 char *the_null_string = (char *)&the_null_string_blocks[1];
 */
 
+/*
+ * Malloc strings small enough for a slab keep their slab class, plus one, in
+ * the otherwise unused bing field; their size can still change after they
+ * are allocated, so it can't be used to find the class again.
+ */
+#ifdef DEBUGMALLOC
+static malloc_block_t *int_alloc_mstr_block(size_t size, const char *tag) {
+  auto mbt = reinterpret_cast<malloc_block_t *>(DMALLOC(size, TAG_MALLOC_STRING, tag));
+  mbt->bing = 0;
+  return mbt;
+}
+#define alloc_mstr_block(x, y) int_alloc_mstr_block(x, y)
+#else
+static malloc_block_t *int_alloc_mstr_block(size_t size) {
+  malloc_block_t *mbt;
+  auto cls = slab_class(size);
+  if (cls < 0) {
+    mbt = reinterpret_cast<malloc_block_t *>(malloc(size));
+    mbt->bing = 0;
+  } else {
+    mbt = reinterpret_cast<malloc_block_t *>(slab_alloc_class(cls));
+    mbt->bing = cls + 1;
+  }
+  return mbt;
+}
+#define alloc_mstr_block(x, y) int_alloc_mstr_block(x)
+#endif
+
+void free_mstr_block(malloc_block_t *mbt) {
+  if (mbt->bing) {
+    slab_free_class(mbt, mbt->bing - 1);
+  } else {
+    FREE(mbt);
+  }
+}
+
 #ifdef DEBUGMALLOC
 char *int_new_string(unsigned int size, const char *tag)
 #else
@@ -326,8 +377,7 @@ char *int_new_string(unsigned int size)
   }
 #endif
 
-  mbt = reinterpret_cast<malloc_block_t *>(
-      DMALLOC(size + sizeof(malloc_block_t) + 1, TAG_MALLOC_STRING, tag));
+  mbt = alloc_mstr_block(size + sizeof(malloc_block_t) + 1, tag);
   if (size < UINT_MAX) {
     mbt->size = size;
     ADD_NEW_STRING(size, sizeof(malloc_block_t));
@@ -342,11 +392,20 @@ char *int_new_string(unsigned int size)
 }
 
 char *extend_string(const char *str, int len) {
-  malloc_block_t *mbt;
+  malloc_block_t *mbt = MSTR_BLOCK(str);
   int oldsize = MSTR_SIZE(str);
-
-  mbt = reinterpret_cast<malloc_block_t *>(DREALLOC(
-      MSTR_BLOCK(str), len + sizeof(malloc_block_t) + 1, TAG_MALLOC_STRING, "extend_string"));
+  size_t size = len + sizeof(malloc_block_t) + 1;
+
+  if (!mbt->bing) {
+    mbt = reinterpret_cast<malloc_block_t *>(
+        DREALLOC(mbt, size, TAG_MALLOC_STRING, "extend_string"));
+  } else if (slab_class(size) != mbt->bing - 1) {
+    auto old = mbt;
+    auto bing = (mbt = alloc_mstr_block(size, "extend_string"))->bing;
+    memcpy(mbt, old, sizeof(malloc_block_t) + (oldsize < len ? oldsize : len) + 1);
+    mbt->bing = bing;
+    free_mstr_block(old);
+  }
   if (len < UINT_MAX) {
     mbt->size = len;
   } else {
@@ -411,14 +470,12 @@ char *int_string_unlink(const char *str)
   if (mbt->size == USHRT_MAX) {
     int l = strlen(str + USHRT_MAX) + USHRT_MAX; /* ouch */
 
-    newmbt = reinterpret_cast<malloc_block_t *>(
-        DMALLOC(l + sizeof(malloc_block_t) + 1, TAG_MALLOC_STRING, desc));
+    newmbt = alloc_mstr_block(l + sizeof(malloc_block_t) + 1, desc);
     memcpy(reinterpret_cast<char *>(newmbt + 1), reinterpret_cast<char *>(mbt + 1), l + 1);
     newmbt->size = USHRT_MAX;
     ADD_NEW_STRING(USHRT_MAX, sizeof(malloc_block_t));
   } else {
-    newmbt = reinterpret_cast<malloc_block_t *>(
-        DMALLOC(mbt->size + sizeof(malloc_block_t) + 1, TAG_MALLOC_STRING, desc));
+    newmbt = alloc_mstr_block(mbt->size + sizeof(malloc_block_t) + 1, desc);
     memcpy(reinterpret_cast<char *>(newmbt + 1), reinterpret_cast<char *>(mbt + 1), mbt->size + 1);
     newmbt->size = mbt->size;
     ADD_NEW_STRING(mbt->size, sizeof(malloc_block_t));
@@ -94,6 +94,8 @@ typedef struct malloc_block_s {
   unsigned short ref;
 } malloc_block_t;
 
+void free_mstr_block(malloc_block_t *);
+
 #define MSTR_BLOCK(x) (((malloc_block_t *)(x)) - 1)
 #define MSTR_EXTRA_REF(x) (MSTR_BLOCK(x)->extra_ref)
 #define MSTR_REF(x) (MSTR_BLOCK(x)->ref)
@@ -104,7 +106,8 @@ typedef struct malloc_block_s {
 #define FREE_MSTR(x)                                                                      \
   SAFE(DEBUG_CHECK(MSTR_REF(x) != 1, "FREE_MSTR used on a multiply referenced string\n"); \
        svalue_strlen_size = MSTR_SIZE(x);                                                 \
-       SUB_NEW_STRING(svalue_strlen_size, sizeof(malloc_block_t)); FREE(MSTR_BLOCK(x));   \
+       SUB_NEW_STRING(svalue_strlen_size, sizeof(malloc_block_t));                        \
+       free_mstr_block(MSTR_BLOCK(x));                                                    \
        SUB_STRING(svalue_strlen_size);)
 
 /* This counts on some rather crucial alignment between malloc_block_t and
@@ -169,6 +172,19 @@ int add_string_status(outbuffer_t *, int);
 
 char *extend_string(const char *, int);
 
+/* Every string of at most one character, set up by init_strings().  Results
+ * that short (explode() by "", one character ranges) are handed out from
+ * here as STRING_CONSTANT, which costs no allocation and no reference
+ * count.  short_string() returns 0 for anything longer.
+ *
+ * This is all the driver does for short strings: they are not stored
+ * inside svalue_t, since code everywhere reads sv->u.string as a pointer.
+ * Strings of two or more characters are allocated as usual, from the
+ * size class slabs.
+ */
+extern char short_strings[256][2];
+const char *short_string(const char *, int);
+
 extern unsigned int svalue_strlen_size;
 
 extern int num_distinct_strings;
@@ -0,0 +1,108 @@
+#include "base/internal/worker_pool.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "base/internal/rc.h"
+
+namespace {
+
+// One worker_pool_run() call.  Workers pick up indexes from next until it
+// reaches count.  A worker that shows up late still holds on to its own job,
+// where there is nothing left to do, instead of to the next one.
+struct job_t {
+  const std::function<void(size_t)> *fn;
+  size_t count;
+  std::atomic<size_t> next{0};
+  std::atomic<size_t> done{0};
+};
+
+// Stopped and joined at exit.  Destroying a condition variable that idle
+// workers still wait on would make exit() hang.
+struct pool_t {
+  std::mutex mutex;
+  std::condition_variable work_ready;
+  std::condition_variable work_done;
+  std::vector<std::thread> workers;
+  std::shared_ptr<job_t> current_job;
+  bool stopping = false;
+
+  ~pool_t() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopping = true;
+    }
+    work_ready.notify_all();
+    for (auto &t : workers) {
+      t.join();
+    }
+  }
+} pool;
+
+void run_job(job_t *job) {
+  size_t i;
+  size_t finished = 0;
+  while ((i = job->next++) < job->count) {
+    (*job->fn)(i);
+    finished++;
+  }
+  if (finished && (job->done += finished) == job->count) {
+    std::lock_guard<std::mutex> lock(pool.mutex);
+    pool.work_done.notify_one();
+  }
+}
+
+void worker_main() {
+  std::shared_ptr<job_t> job;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(pool.mutex);
+      pool.work_ready.wait(lock, [&] { return pool.stopping || pool.current_job != job; });
+      if (pool.stopping) {
+        return;
+      }
+      job = pool.current_job;
+    }
+    run_job(job.get());
+  }
+}
+
+void start_workers() {
+  auto n = CONFIG_INT(__RC_WORKER_THREADS__);
+  for (int i = 0; i < n; i++) {
+    pool.workers.emplace_back(worker_main);
+  }
+}
+}  // namespace
+
+int worker_pool_size() { return CONFIG_INT(__RC_WORKER_THREADS__) + 1; }
+
+void worker_pool_run(size_t count, const std::function<void(size_t)> &fn) {
+  if (count < 2 || worker_pool_size() < 2) {
+    for (size_t i = 0; i < count; i++) {
+      fn(i);
+    }
+    return;
+  }
+  if (pool.workers.empty()) {
+    start_workers();
+  }
+
+  auto job = std::make_shared<job_t>();
+  job->fn = &fn;
+  job->count = count;
+  {
+    std::lock_guard<std::mutex> lock(pool.mutex);
+    pool.current_job = job;
+  }
+  pool.work_ready.notify_all();
+
+  run_job(job.get());
+
+  std::unique_lock<std::mutex> lock(pool.mutex);
+  pool.work_done.wait(lock, [&] { return job->done == count; });
+}
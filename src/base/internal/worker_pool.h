@@ -0,0 +1,22 @@
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include <cstddef>
+#include <functional>
+
+/*
+ * worker_pool.cc
+ *
+ * Run fn(0) .. fn(count - 1) spread over the "worker threads" and the
+ * calling thread, and return once all of them are done.  With no worker
+ * threads configured it is a plain loop.
+ *
+ * fn must not touch anything the other calls do: no LPC values, no
+ * DMALLOC() and no libevent.
+ */
+void worker_pool_run(size_t count, const std::function<void(size_t)> &fn);
+
+// Number of threads worker_pool_run() uses, including the caller.
+int worker_pool_size();
+
+#endif
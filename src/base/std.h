@@ -161,6 +161,7 @@ throw "pointers of size other than 4 or 8 not implemented"; \
 
 #include "base/internal/debugmalloc.h"
 #include "base/internal/md.h"
+#include "base/internal/slab.h"
 
 #include "base/internal/external_port.h"
 
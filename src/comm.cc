@@ -20,13 +20,21 @@
 #include <stdio.h>               // for snprintf, vsnprintf, fwrite, etc
 #include <string.h>              // for NULL, memcpy, strlen, etc
 #include <unistd.h>              // for gethostname
+#include <algorithm>             // for min, max
+#include <chrono>                // for steady_clock
+#include <deque>                 // for deque
 #include <memory>                // for unique_ptr
+#include <string>                // for string
+#include <vector>                // for vector
 
 #include "backend.h"
+#include "base/internal/worker_pool.h"
 #include "fliconv.h"
+#include "include/output_limit.h"
 #include "interactive.h"
 #include "thirdparty/libtelnet/libtelnet.h"
 #include "net/telnet.h"
+#include "net/websocket.h"
 #include "user.h"
 #include "vm/vm.h"
 
@@ -44,6 +52,8 @@ static char *first_cmd_in_buf(interactive_t * /*ip*/);
 static int cmd_in_buf(interactive_t * /*ip*/);
 static int call_function_interactive(interactive_t * /*i*/, char * /*str*/);
 static void print_prompt(interactive_t * /*ip*/);
+static bool uses_telnet(interactive_t * /*ip*/);
+static void batch_output(interactive_t * /*ip*/);
 
 #ifdef NO_SNOOP
 #define handle_snoop(str, len, who)
@@ -61,26 +71,62 @@ struct user_event_data {
   int idx;
 };
 
-void maybe_schedule_user_command(interactive_t *user) {
-  // If user has a complete command, schedule a command execution.
-  if (user->iflags & CMD_IN_BUF) {
-    struct timeval zero_sec = {0, 0};
-    evtimer_del(user->ev_command);
-    evtimer_add(user->ev_command, &zero_sec);
-  }
+/*
+ * Commands are run by a scheduler instead of straight from the input
+ * callbacks.  Users with a complete command wait in command_queue, and
+ * each slice runs one command for every user that was waiting when it
+ * started, so a user flooding commands goes to the back of the line after
+ * each one.  A slice stops early once it has used up "command budget
+ * msec", the rest of the users wait for the next slice, after pending I/O
+ * has been handled.
+ *
+ * Users over their "user commands per second" wait on their own
+ * ev_command timer, and rejoin the queue when it fires.
+ */
+std::deque<interactive_t *> command_queue;
+struct event *ev_command_slice = nullptr;
+
+int64_t now_usec() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
 }
 
-void on_user_command(evutil_socket_t fd, short what, void *arg) {
-  debug(event, "User has an full command ready: %d:%s%s%s%s \n", (int)fd,
-        (what & EV_TIMEOUT) ? " timeout" : "", (what & EV_READ) ? " read" : "",
-        (what & EV_WRITE) ? " write" : "", (what & EV_SIGNAL) ? " signal" : "");
-  auto user = reinterpret_cast<interactive_t *>(arg);
+void schedule_command_slice() {
+  struct timeval zero_sec = {0, 0};
+  evtimer_add(ev_command_slice, &zero_sec);
+}
 
-  if (user == NULL) {
-    fatal("on_user_command: user == NULL, Driver BUG.");
-    return;
+void queue_user_command(interactive_t *user) {
+  command_queue.push_back(user);
+  if (command_queue.size() > command_queue_max_depth) {
+    command_queue_max_depth = command_queue.size();
   }
+  schedule_command_slice();
+}
 
+/*
+ * Rate limiting, with a burst of a second's worth of commands.  Returns how
+ * many microseconds the user has to wait before its next command, or 0 and
+ * charges the command to it.
+ */
+int64_t command_throttle(interactive_t *user) {
+  auto rate = CONFIG_INT(__RC_USER_COMMANDS_PER_SECOND__);
+  if (rate <= 0) {
+    return 0;
+  }
+  auto interval = 1000000 / rate;
+  auto tolerance = interval * (rate - 1);
+  auto now = now_usec();
+  auto tat = std::max(user->command_tat, now);
+  if (tat - now > tolerance) {
+    return tat - now - tolerance;
+  }
+  user->command_tat = tat + interval;
+  return 0;
+}
+
+void run_user_command(interactive_t *user) {
   // FIXME: this function currently calls into mudlib and will throw errors
   // This catch block should be moved one level down.
   error_context_t econ;
@@ -96,15 +142,69 @@ void on_user_command(evutil_socket_t fd, short what, void *arg) {
   /* Has to be cleared if we jumped out of process_user_command() */
   current_interactive = 0;
 
-  // if user still have pending command, continue to schedule it.
-  //
-  // NOTE: It is important to only execute one command here, then schedule next
-  // command at the tail, This ensure users have a fair chance that no one can
-  // keep running commands.
-  //
-  // currently command scehduling is done inside process_user_command().
-  //
-  // maybe_schedule_user_command(user);
+  user_commands++;
+}
+
+void on_command_slice(evutil_socket_t /*fd*/, short /*what*/, void * /*arg*/) {
+  auto budget = CONFIG_INT(__RC_COMMAND_BUDGET_MSEC__) * int64_t(1000);
+  auto start = now_usec();
+
+  // Users that get requeued during this slice wait for the next one.
+  for (auto n = command_queue.size(); n && !command_queue.empty(); n--) {
+    auto user = command_queue.front();
+    command_queue.pop_front();
+
+    auto wait = command_throttle(user);
+    if (wait) {
+      struct timeval delay = {static_cast<time_t>(wait / 1000000),
+                              static_cast<suseconds_t>(wait % 1000000)};
+      evtimer_add(user->ev_command, &delay);
+      user_commands_throttled++;
+      continue;
+    }
+
+    user->iflags &= ~CMD_QUEUED;
+    run_user_command(user);
+
+    if (budget > 0 && now_usec() - start >= budget) {
+      command_slices_cut++;
+      break;
+    }
+  }
+  if (!command_queue.empty()) {
+    schedule_command_slice();
+  }
+}
+
+// The rate limit of a user has run out.
+void on_user_command(evutil_socket_t /*fd*/, short /*what*/, void *arg) {
+  auto user = reinterpret_cast<interactive_t *>(arg);
+
+  if (user == NULL) {
+    fatal("on_user_command: user == NULL, Driver BUG.");
+    return;
+  }
+  queue_user_command(user);
+}
+
+void schedule_user_command(interactive_t *user) {
+  // If user has a complete command, schedule a command execution.
+  if ((user->iflags & CMD_IN_BUF) && !(user->iflags & CMD_QUEUED)) {
+    user->iflags |= CMD_QUEUED;
+    if (!ev_command_slice) {
+      ev_command_slice = evtimer_new(g_event_base, on_command_slice, nullptr);
+    }
+    queue_user_command(user);
+  }
+}
+
+// Take a user that is going away out of the scheduler.
+void unschedule_user_command(interactive_t *user) {
+  if (user->iflags & CMD_QUEUED) {
+    command_queue.erase(std::remove(command_queue.begin(), command_queue.end(), user),
+                        command_queue.end());
+    user->iflags &= ~CMD_QUEUED;
+  }
 }
 
 void on_user_read(bufferevent *bev, void *arg) {
@@ -154,29 +254,22 @@ void new_user_event_listener(interactive_t *user) {
   bufferevent_enable(bev, EV_READ | EV_WRITE);
 
   bufferevent_set_timeouts(bev, NULL, NULL);
+  // Stop reading from the socket while this much input is waiting.
+  bufferevent_setwatermark(bev, EV_READ, 0, MAX_TEXT * 32);
 
   user->ev_buffer = bev;
   user->ev_command = evtimer_new(g_event_base, on_user_command, user);
 }
 
 /*
- * This is the new user connection handler. This function is called by the
- * event handler when data is pending on the listening socket (new_user_fd).
- * If space is available, an interactive data structure is initialized and
- * the user is connected.
+ * Set up an interactive for a newly accepted connection, and call connect()
+ * and logon() for it.
  */
-void new_user_handler(evconnlistener *listener, evutil_socket_t fd, struct sockaddr *addr,
-                      int addrlen, void *arg) {
-  debug(connections, "New connection from %s.\n", sockaddr_to_string(addr, addrlen));
-
-  // TODO: we don't really need to pass in port, we can figure out by
-  // evconnlistener_get_fd and compare it
-  auto *port = reinterpret_cast<port_def_t *>(arg);
-
+void new_user(port_def_t *port, evutil_socket_t fd, struct sockaddr *addr, int addrlen) {
   {
     int one = 1;
     if (setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one)) == -1) {
-      debug(connections, "new_user_handler: user fd %d, set_socket_tcp_nodelay error: %s.\n", fd,
+      debug(connections, "new_user: user fd %d, set_socket_tcp_nodelay error: %s.\n", fd,
             evutil_socket_error_to_string(evutil_socket_geterror(fd)));
     }
   }
@@ -197,6 +290,10 @@ void new_user_handler(evconnlistener *listener, evutil_socket_t fd, struct socka
 // never actually used, but avoids multiple ifdefs later on!
 #endif
 
+  user->output_high = CONFIG_INT(__RC_OUTPUT_HIGH_WATERMARK__);
+  user->output_low = CONFIG_INT(__RC_OUTPUT_LOW_WATERMARK__);
+  user->output_policy = CONFIG_INT(__RC_OUTPUT_OVERFLOW_POLICY__);
+
   user->fd = fd;
   user->local_port = port->port;
   user->external_port = (port - external_port);  // FIXME: pointer arith
@@ -272,7 +369,7 @@ void new_user_handler(evconnlistener *listener, evutil_socket_t fd, struct socka
   // Call logon() on the object.
   ret = safe_apply(APPLY_LOGON, ob, 0, ORIGIN_DRIVER);
   if (ret == NULL) {
-    debug_message("new_user_handler: logon() on object %s has failed, the user is disconnected.\n",
+    debug_message("new_user: logon() on object %s has failed, the user is disconnected.\n",
                   ob->obname);
     destruct_object(ob);
     ob = NULL;
@@ -281,123 +378,234 @@ void new_user_handler(evconnlistener *listener, evutil_socket_t fd, struct socka
   }
   set_command_giver(0);
 
-  debug(connections, ("new_user_handler: end\n"));
-} /* new_user_handler() */
+  debug(connections, ("new_user: end\n"));
+} /* new_user() */
 
-}  // namespace
+/*
+ * Connections accepted but not logged in yet, because more than "logins per
+ * tick" connections arrived in one gametick.
+ */
+struct pending_login_t {
+  port_def_t *port;
+  evutil_socket_t fd;
+  struct sockaddr_storage addr;
+  int addrlen;
+};
+std::deque<pending_login_t> pending_logins;
+// Logins done in the current gametick.
+int logins_this_tick;
+bool login_tick_scheduled;
+
+void schedule_login_tick();
+
+// Runs once per gametick while logins are being limited.
+void on_login_tick() {
+  login_tick_scheduled = false;
+  logins_this_tick = 0;
+
+  auto limit = CONFIG_INT(__RC_LOGINS_PER_TICK__);
+  while (!pending_logins.empty() && logins_this_tick < limit) {
+    auto login = pending_logins.front();
+    pending_logins.pop_front();
+    logins_this_tick++;
+    new_user(login.port, login.fd, reinterpret_cast<sockaddr *>(&login.addr), login.addrlen);
+  }
+  if (logins_this_tick) {
+    schedule_login_tick();
+  }
+}
+
+void schedule_login_tick() {
+  if (!login_tick_scheduled) {
+    login_tick_scheduled = true;
+    add_gametick_event(gametick_to_time(1), tick_event::callback_type(on_login_tick));
+  }
+}
 
 /*
- * Initialize new user connection socket.
+ * This is the new user connection handler. This function is called by the
+ * event handler when a connection has been accepted on one of the listening
+ * sockets of an external port.  The user is connected right away, unless
+ * "logins per tick" connections have been handled already, in which case it
+ * waits in the login queue.
  */
-bool init_user_conn() {
-  for (int i = 0; i < 5; i++) {
-#ifdef F_NETWORK_STATS
-    external_port[i].in_packets = 0;
-    external_port[i].in_volume = 0;
-    external_port[i].out_packets = 0;
-    external_port[i].out_volume = 0;
-#endif
-    if (!external_port[i].port) continue;
+void new_user_handler(evconnlistener * /*listener*/, evutil_socket_t fd, struct sockaddr *addr,
+                      int addrlen, void *arg) {
+  debug(connections, "New connection from %s.\n", sockaddr_to_string(addr, addrlen));
+
+  auto *port = reinterpret_cast<port_def_t *>(arg);
+
+  auto limit = CONFIG_INT(__RC_LOGINS_PER_TICK__);
+  if (limit <= 0 || (pending_logins.empty() && logins_this_tick < limit)) {
+    if (limit > 0) {
+      logins_this_tick++;
+      schedule_login_tick();
+    }
+    new_user(port, fd, addr, addrlen);
+    return;
+  }
+
+  if (pending_logins.size() >= static_cast<size_t>(CONFIG_INT(__RC_LOGIN_QUEUE_SIZE__))) {
+    debug_message("Login queue is full, dropping connection from %s.\n",
+                  sockaddr_to_string(addr, addrlen));
+    evutil_closesocket(fd);
+    return;
+  }
+  pending_login_t login;
+  login.port = port;
+  login.fd = fd;
+  memcpy(&login.addr, addr, addrlen);
+  login.addrlen = addrlen;
+  pending_logins.push_back(login);
+  schedule_login_tick();
+}
+
+/*
+ * Create a listening socket bound to the given port, returns -1 on error.
+ */
+evutil_socket_t listen_on_port(port_def_t *port, bool reuseport) {
 #ifdef IPV6
-    auto fd = socket(AF_INET6, SOCK_STREAM, 0);
+  auto fd = socket(AF_INET6, SOCK_STREAM, 0);
 #else
-    auto fd = socket(AF_INET, SOCK_STREAM, 0);
+  auto fd = socket(AF_INET, SOCK_STREAM, 0);
 #endif
-    if (fd == -1) {
-      debug_message("socket_create: socket error: %s.\n",
-                    evutil_socket_error_to_string(evutil_socket_geterror(fd)));
-      return false;
-    }
-    if (evutil_make_socket_nonblocking(fd) == -1) {
-      debug(sockets, "socket_accept: set_socket_nonblocking error: %s.\n",
-            evutil_socket_error_to_string(evutil_socket_geterror(accept_fd)));
-      evutil_closesocket(fd);
-      return false;
-    }
-    if (evutil_make_socket_closeonexec(fd) == -1) {
-      debug(sockets, "socket_accept: make_socket_closeonexec error: %s.\n",
-            evutil_socket_error_to_string(evutil_socket_geterror(accept_fd)));
+  if (fd == -1) {
+    debug_message("socket_create: socket error: %s.\n",
+                  evutil_socket_error_to_string(evutil_socket_geterror(fd)));
+    return -1;
+  }
+  if (evutil_make_socket_nonblocking(fd) == -1) {
+    debug(sockets, "socket_accept: set_socket_nonblocking error: %s.\n",
+          evutil_socket_error_to_string(evutil_socket_geterror(fd)));
+    evutil_closesocket(fd);
+    return -1;
+  }
+  if (evutil_make_socket_closeonexec(fd) == -1) {
+    debug(sockets, "socket_accept: make_socket_closeonexec error: %s.\n",
+          evutil_socket_error_to_string(evutil_socket_geterror(fd)));
+    evutil_closesocket(fd);
+    return -1;
+  }
+  {
+    int one = 1;
+    if (setsockopt(fd, SOL_SOCKET, SO_KEEPALIVE, (void *)&one, sizeof(one)) < 0) {
       evutil_closesocket(fd);
-      return false;
+      return -1;
     }
-    {
-      int one = 1;
-      if (setsockopt(fd, SOL_SOCKET, SO_KEEPALIVE, (void *)&one, sizeof(one)) < 0) {
-        evutil_closesocket(fd);
-        return false;
-      }
-    }
-    if (evutil_make_listen_socket_reuseable(fd) < 0) {
+  }
+  if (evutil_make_listen_socket_reuseable(fd) < 0) {
+    evutil_closesocket(fd);
+    return -1;
+  }
+#ifdef SO_REUSEPORT
+  if (reuseport) {
+    int one = 1;
+    if (setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, (void *)&one, sizeof(one)) < 0) {
+      debug_message("socket_create: SO_REUSEPORT error: %s.\n",
+                    evutil_socket_error_to_string(evutil_socket_geterror(fd)));
       evutil_closesocket(fd);
-      return false;
+      return -1;
     }
+  }
+#endif
 #ifdef __CYGWIN__
 #ifdef IPV6
-    // On windows, IPv6 sockets are IPv6 only by default. We have to change it.
-    {
-      auto zero = 0;
-      if (setsockopt(fd, IPPROTO_IPV6, IPV6_V6ONLY, (void *)&zero, sizeof(zero)) == -1) {
-        debug_message("socket_create: setsockopt error: %s.\n",
-                      evutil_socket_error_to_string(evutil_socket_geterror(fd)));
-        evutil_closesocket(fd);
-        return false;
-      }
+  // On windows, IPv6 sockets are IPv6 only by default. We have to change it.
+  {
+    auto zero = 0;
+    if (setsockopt(fd, IPPROTO_IPV6, IPV6_V6ONLY, (void *)&zero, sizeof(zero)) == -1) {
+      debug_message("socket_create: setsockopt error: %s.\n",
+                    evutil_socket_error_to_string(evutil_socket_geterror(fd)));
+      evutil_closesocket(fd);
+      return -1;
     }
+  }
 #endif
 #endif
-    {
-      /*
-       * fill in socket address information.
-       */
-      struct addrinfo *res;
+  {
+    /*
+     * fill in socket address information.
+     */
+    struct addrinfo *res;
 
-      char service[NI_MAXSERV];
-      snprintf(service, sizeof(service), "%u", external_port[i].port);
+    char service[NI_MAXSERV];
+    snprintf(service, sizeof(service), "%u", port->port);
 
-      // Must be initialized to all zero.
-      struct addrinfo hints = {0};
+    // Must be initialized to all zero.
+    struct addrinfo hints = {0};
 #ifdef IPV6
-      hints.ai_family = AF_INET6;
-      hints.ai_flags |= AI_V4MAPPED;
+    hints.ai_family = AF_INET6;
+    hints.ai_flags |= AI_V4MAPPED;
 #else
-      hints.ai_family = AF_INET;
+    hints.ai_family = AF_INET;
 #endif
-      hints.ai_socktype = SOCK_STREAM;
-      hints.ai_flags |= AI_PASSIVE | AI_NUMERICSERV;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags |= AI_PASSIVE | AI_NUMERICSERV;
 
-      int ret;
+    int ret;
 
-      auto mudip = CONFIG_STR(__MUD_IP__);
-      if (mudip != nullptr && strlen(mudip) > 0) {
-        ret = getaddrinfo(mudip, service, &hints, &res);
-      } else {
-        ret = getaddrinfo(NULL, service, &hints, &res);
-      }
-      if (ret) {
-        debug_message("init_user_conn: getaddrinfo error: %s \n", gai_strerror(ret));
+    auto mudip = CONFIG_STR(__MUD_IP__);
+    if (mudip != nullptr && strlen(mudip) > 0) {
+      ret = getaddrinfo(mudip, service, &hints, &res);
+    } else {
+      ret = getaddrinfo(NULL, service, &hints, &res);
+    }
+    if (ret) {
+      debug_message("init_user_conn: getaddrinfo error: %s \n", gai_strerror(ret));
+      evutil_closesocket(fd);
+      return -1;
+    }
+
+    if (bind(fd, res->ai_addr, res->ai_addrlen) == -1) {
+      debug_message("socket_create: bind error: %s.\n",
+                    evutil_socket_error_to_string(evutil_socket_geterror(fd)));
+      evutil_closesocket(fd);
+      freeaddrinfo(res);
+      return -1;
+    }
+    debug_message("Accepting connections on %s.\n",
+                  sockaddr_to_string(res->ai_addr, res->ai_addrlen));
+    freeaddrinfo(res);
+  }
+  return fd;
+}
+
+}  // namespace
+
+/*
+ * Initialize new user connection socket.
+ */
+bool init_user_conn() {
+  auto listeners = 1;
+#ifdef SO_REUSEPORT
+  listeners = std::max(1, std::min(CONFIG_INT(__RC_LISTEN_SOCKETS__), MAX_PORT_LISTENERS));
+#endif
+  for (int i = 0; i < 5; i++) {
+#ifdef F_NETWORK_STATS
+    external_port[i].in_packets = 0;
+    external_port[i].in_volume = 0;
+    external_port[i].out_packets = 0;
+    external_port[i].out_volume = 0;
+#endif
+    if (!external_port[i].port) continue;
+    for (int j = 0; j < listeners; j++) {
+      auto fd = listen_on_port(&external_port[i], listeners > 1);
+      if (fd == -1) {
         return false;
       }
-
-      if (bind(fd, res->ai_addr, res->ai_addrlen) == -1) {
-        debug_message("socket_create: bind error: %s.\n",
-                      evutil_socket_error_to_string(evutil_socket_geterror(fd)));
+      // Listen on connection event
+      auto conn = evconnlistener_new(
+          g_event_base, new_user_handler, &external_port[i],
+          LEV_OPT_REUSEABLE | LEV_OPT_CLOSE_ON_FREE | LEV_OPT_CLOSE_ON_EXEC, 1024, fd);
+      if (conn == NULL) {
+        debug_message("listening failed: %s !",
+                      evutil_socket_error_to_string(EVUTIL_SOCKET_ERROR()));
         evutil_closesocket(fd);
-        freeaddrinfo(res);
         return false;
       }
-      debug_message("Accepting connections on %s.\n",
-                    sockaddr_to_string(res->ai_addr, res->ai_addrlen));
-      freeaddrinfo(res);
+      external_port[i].ev_conn[j] = conn;
+      external_port[i].num_listeners = j + 1;
     }
-    // Listen on connection event
-    auto conn = evconnlistener_new(
-        g_event_base, new_user_handler, &external_port[i],
-        LEV_OPT_REUSEABLE | LEV_OPT_CLOSE_ON_FREE | LEV_OPT_CLOSE_ON_EXEC, 1024, fd);
-    if (conn == NULL) {
-      debug_message("listening failed: %s !", evutil_socket_error_to_string(EVUTIL_SOCKET_ERROR()));
-      return false;
-    }
-    external_port[i].ev_conn = conn;
   }
   return true;
 }
@@ -412,12 +620,17 @@ void shutdown_external_ports() {
     if (!external_port[i].port) {
       continue;
     }
-    if (external_port[i].ev_conn) evconnlistener_free(external_port[i].ev_conn);
-    if (evutil_closesocket(external_port[i].fd) == -1) {
-      debug_message("shutdown_external_ports: failed: %s",
-                    evutil_socket_error_to_string(evutil_socket_geterror(external_port[i].fd)));
+    // The listeners close their sockets.
+    for (int j = 0; j < external_port[i].num_listeners; j++) {
+      evconnlistener_free(external_port[i].ev_conn[j]);
     }
+    external_port[i].num_listeners = 0;
+  }
+  // Nobody will log these in any more.
+  for (auto &login : pending_logins) {
+    evutil_closesocket(login.fd);
   }
+  pending_logins.clear();
 
   debug_message("closed external ports\n");
 }
@@ -463,10 +676,101 @@ static int shadow_catch_message(object_t *ob, const char *str) {
 #endif
 
 /*
- * Send a message to an interactive object. If that object is shadowed,
- * special handling is done.
+ * Bytes of output waiting to be written to the connection, including
+ * batched output that hasn't been compressed yet.
  */
-void add_message(object_t *who, const char *data, int len) {
+static size_t output_queued(interactive_t *ip) {
+  auto queued = evbuffer_get_length(bufferevent_get_output(ip->ev_buffer));
+  if (ip->telnet) {
+    queued += telnet_pending(ip->telnet);
+  }
+  return queued;
+}
+
+static size_t output_low_watermark(interactive_t *ip) {
+  if (ip->output_low > 0 && ip->output_low < ip->output_high) {
+    return ip->output_low;
+  }
+  return ip->output_high / 2;
+}
+
+/*
+ * Disconnecting and calling output_overflow() wait until the current
+ * callback is done: add_message() is called from all over the place, which
+ * doesn't expect the interactive to go away or more LPC code to run.
+ */
+static void on_output_overflow(evutil_socket_t /*fd*/, short /*what*/, void *arg) {
+  auto ob = reinterpret_cast<object_t *>(arg);
+  auto ip = ob->interactive;
+  if (!(ob->flags & O_DESTRUCTED) && ip && !(ip->iflags & (NET_DEAD | CLOSING))) {
+    if (ip->output_policy == OUTPUT_DISCONNECT) {
+      debug(connections, "Disconnecting %s, %zu bytes of output queued.\n", ob->obname,
+            output_queued(ip));
+      remove_interactive(ob, 0);
+    } else {
+      save_command_giver(ob);
+      push_number(output_queued(ip));
+      safe_apply(APPLY_OUTPUT_OVERFLOW, ob, 1, ORIGIN_DRIVER);
+      restore_command_giver();
+    }
+  }
+  free_object(&ob, "on_output_overflow");
+}
+
+static void output_overflow(interactive_t *ip) {
+  ip->iflags |= OUTPUT_BLOCKED;
+
+  switch (ip->output_policy) {
+    case OUTPUT_TRUNCATE: {
+      static const char marker[] = "\n*** Output truncated ***\n";
+      if (uses_telnet(ip)) {
+        telnet_send_text(ip->telnet, marker, sizeof(marker) - 1);
+        batch_output(ip);
+      } else {
+        bufferevent_write(ip->ev_buffer, marker, sizeof(marker) - 1);
+      }
+      break;
+    }
+    case OUTPUT_DISCONNECT:
+    case OUTPUT_NOTIFY: {
+      struct timeval now = {0, 0};
+      add_ref(ip->ob, "output_overflow");
+      event_base_once(g_event_base, -1, EV_TIMEOUT, on_output_overflow, ip->ob, &now);
+      break;
+    }
+    default:
+      break;
+  }
+}
+
+/*
+ * Output is blocked once more than the high watermark of it is queued, and
+ * stays blocked until the queue is down to the low watermark.
+ */
+static bool output_blocked(interactive_t *ip) {
+  if (ip->output_high <= 0) {
+    return false;
+  }
+  auto queued = output_queued(ip);
+  if (ip->iflags & OUTPUT_BLOCKED) {
+    if (queued > output_low_watermark(ip)) {
+      return true;
+    }
+    ip->iflags &= ~OUTPUT_BLOCKED;
+    return false;
+  }
+  if (queued < static_cast<size_t>(ip->output_high)) {
+    return false;
+  }
+  output_overflow(ip);
+  return true;
+}
+
+/*
+ * Returns who's interactive if a message can be sent to it, otherwise the
+ * message is dropped (or written on stderr) and nullptr is returned.
+ */
+static interactive_t *message_target(object_t *who, const char *data, int len) {
   /*
    * if who->interactive is not valid, write message on stderr.
    * (maybe)
@@ -477,23 +781,20 @@ void add_message(object_t *who, const char *data, int len) {
       putc(']', stderr);
       fwrite(data, len, 1, stderr);
     }
-    return;
+    return nullptr;
+  }
+  if (output_blocked(who->interactive)) {
+    return nullptr;
   }
 
   inet_packets++;
+  return who->interactive;
+}
 
-  auto ip = who->interactive;
-  if (ip->connection_type == PORT_TELNET) {
-    int translen;
-    char *trans = translate(ip->trans->outgoing, data, len, &translen);
-
-    inet_volume += translen;
-    telnet_send_text(ip->telnet, trans, translen);
-  } else {
-    inet_volume += len;
-    bufferevent_write(ip->ev_buffer, data, len);
-  }
-
+/*
+ * Shadows and snoopers get their copy once the message has been sent.
+ */
+static void message_sent(object_t *who, interactive_t *ip, const char *data, int len) {
 #ifdef SHADOW_CATCH_MESSAGE
   /*
    * shadow handling.
@@ -508,8 +809,215 @@ void add_message(object_t *who, const char *data, int len) {
   handle_snoop(data, len, ip);
 
   add_message_calls++;
+}
+
+/*
+ * With "output batch size" set, compressed output is held back by zlib and
+ * flushed once at the end of the backend cycle, or as soon as enough of it
+ * is waiting.
+ */
+static struct event *ev_output_flush = nullptr;
+
+static void on_output_flush(evutil_socket_t /*fd*/, short /*what*/, void * /*arg*/) {
+  std::vector<telnet_t *> pending;
+  users_foreach([&](interactive_t *user) {
+    if (user->telnet && telnet_pending(user->telnet)) {
+      pending.push_back(user->telnet);
+    }
+  });
+  // Compression is spread over the worker threads, sending stays here.
+  worker_pool_run(pending.size(), [&](size_t i) { telnet_deflate_pending(pending[i]); });
+  for (auto telnet : pending) {
+    telnet_flush(telnet);
+  }
+}
+
+static void batch_output(interactive_t *ip) {
+  auto pending = telnet_pending(ip->telnet);
+  if (!pending) {
+    return;
+  }
+  if (pending >= CONFIG_INT(__RC_OUTPUT_BATCH_SIZE__)) {
+    telnet_flush(ip->telnet);
+    return;
+  }
+  if (!ev_output_flush) {
+    ev_output_flush = event_new(g_event_base, -1, 0, on_output_flush, nullptr);
+  }
+  // Runs after every other callback that is already due in this cycle.
+  if (!event_pending(ev_output_flush, EV_TIMEOUT, nullptr)) {
+    event_active(ev_output_flush, EV_TIMEOUT, 0);
+  }
+}
+
+/*
+ * Escape text the way telnet_send_text() does: IAC is doubled, and unless
+ * in binary mode, \r becomes CR NUL and \n becomes CR LF.  Returns the
+ * escaped length, only writes to out if it isn't null.
+ */
+static size_t telnet_escape(const char *text, size_t len, bool binary, char *out) {
+  size_t n = 0;
+  for (size_t i = 0; i < len; i++) {
+    char c = text[i];
+    if (c == static_cast<char>(TELNET_IAC)) {
+      if (out) {
+        out[n] = out[n + 1] = c;
+      }
+      n += 2;
+    } else if (!binary && (c == '\r' || c == '\n')) {
+      if (out) {
+        out[n] = '\r';
+        out[n + 1] = c == '\r' ? '\0' : '\n';
+      }
+      n += 2;
+    } else {
+      if (out) {
+        out[n] = c;
+      }
+      n++;
+    }
+  }
+  return n;
+}
+
+/*
+ * Telnet connections, and websockets once the handshake is done, have
+ * their output go through telnet.
+ */
+static bool uses_telnet(interactive_t *ip) {
+  return ip->connection_type == PORT_TELNET ||
+         (ip->connection_type == PORT_WEBSOCKET && (ip->iflags & HANDSHAKE_COMPLETE));
+}
+
+/*
+ * Send a message to an interactive object. If that object is shadowed,
+ * special handling is done.
+ */
+void add_message(object_t *who, const char *data, int len) {
+  auto ip = message_target(who, data, len);
+  if (!ip) {
+    return;
+  }
+
+  if (uses_telnet(ip)) {
+    int translen;
+    char *trans = translate(ip->trans->outgoing, data, len, &translen);
+
+    inet_volume += translen;
+    if (ip->connection_type == PORT_WEBSOCKET) {
+      // Escape it all first, so the message goes out in one frame.
+      bool binary = telnet_is_transmit_binary(ip->telnet);
+      auto escaped_len = telnet_escape(trans, translen, binary, nullptr);
+      std::unique_ptr<char[]> escaped(new char[escaped_len]);
+      telnet_escape(trans, translen, binary, escaped.get());
+      telnet_send_escaped(ip->telnet, escaped.get(), escaped_len);
+    } else {
+      telnet_send_text(ip->telnet, trans, translen);
+    }
+    batch_output(ip);
+  } else {
+    inet_volume += len;
+    bufferevent_write(ip->ev_buffer, data, len);
+  }
+
+  message_sent(who, ip, data, len);
 } /* add_message() */
 
+/*
+ * One encoding of a shared message.  Output buffers hold references to it
+ * instead of copies, the last one to let go of it frees it.
+ */
+struct message_encoding_t {
+  bool telnet;
+  iconv_t translator;
+  bool binary;
+
+  int refs;
+  size_t len;
+  char *data;
+};
+
+static void release_message_encoding(const void * /*data*/, size_t /*len*/, void *arg) {
+  auto enc = reinterpret_cast<message_encoding_t *>(arg);
+  if (!--enc->refs) {
+    FREE(enc->data);
+    delete enc;
+  }
+}
+
+static message_encoding_t *encode_message(shared_message_t *msg, interactive_t *ip) {
+  bool telnet = uses_telnet(ip);
+  iconv_t translator = nullptr;
+#ifdef USE_ICONV
+  if (telnet) {
+    translator = ip->trans->outgoing;
+  }
+#endif
+  bool binary = telnet && telnet_is_transmit_binary(ip->telnet);
+
+  for (auto enc : msg->encodings) {
+    if (enc->telnet == telnet && enc->translator == translator &&
+        enc->binary == binary) {
+      return enc;
+    }
+  }
+
+  auto enc = new message_encoding_t;
+  enc->telnet = telnet;
+  enc->translator = translator;
+  enc->binary = binary;
+  enc->refs = 1;  // held by msg
+  if (telnet) {
+    int translen;
+    char *trans = translate(ip->trans->outgoing, msg->data, msg->len, &translen);
+
+    enc->len = telnet_escape(trans, translen, binary, nullptr);
+    enc->data = reinterpret_cast<char *>(DMALLOC(enc->len + 1, TAG_TEMPORARY, "encode_message"));
+    telnet_escape(trans, translen, binary, enc->data);
+  } else {
+    enc->len = msg->len;
+    enc->data = reinterpret_cast<char *>(DMALLOC(enc->len + 1, TAG_TEMPORARY, "encode_message"));
+    memcpy(enc->data, msg->data, msg->len);
+  }
+  msg->encodings.push_back(enc);
+  return enc;
+}
+
+shared_message_t::~shared_message_t() {
+  for (auto enc : encodings) {
+    release_message_encoding(nullptr, 0, enc);
+  }
+}
+
+/*
+ * Send a message that also goes to other interactives.  Connections using
+ * MCCP still get their own compressed stream, but without escaping the
+ * text again.
+ */
+void add_message(object_t *who, shared_message_t *msg) {
+  auto ip = message_target(who, msg->data, msg->len);
+  if (!ip) {
+    return;
+  }
+
+  auto enc = encode_message(msg, ip);
+  inet_volume += enc->len;
+  if (enc->telnet && telnet_is_deflating(ip->telnet)) {
+    telnet_send_escaped(ip->telnet, enc->data, enc->len);
+    batch_output(ip);
+  } else if (enc->len) {
+    auto output = bufferevent_get_output(ip->ev_buffer);
+    if (enc->telnet && ip->connection_type == PORT_WEBSOCKET) {
+      unsigned char header[WEBSOCKET_MAX_HEADER];
+      evbuffer_add(output, header, websocket_frame_header(enc->len, header));
+    }
+    enc->refs++;
+    evbuffer_add_reference(output, enc->data, enc->len, release_message_encoding, enc);
+  }
+
+  message_sent(who, ip, msg->data, msg->len);
+}
+
 void add_vmessage(object_t *who, const char *format, ...) {
   va_list args, args2;
   va_start(args, format);
@@ -538,6 +1046,10 @@ int flush_message(interactive_t *ip) {
     return 0;
   }
 
+  if (ip->telnet) {
+    telnet_flush(ip->telnet);
+  }
+
   // Flush things normally.
   if (bufferevent_flush(ip->ev_buffer, EV_WRITE, BEV_FLUSH) == -1) {
     return 0;
@@ -566,13 +1078,91 @@ void flush_message_all() {
 }
 
 /*
- * Read pending data for a user into user->interactive->text.
- * This also does telnet negotiation.
+ * Make room in ip->text for "want" more bytes and a terminating NUL.  The
+ * buffer is only allocated once there is input, and grows as needed, up to
+ * a bit more than the maximum string length.  Returns the room there is.
  */
-void get_user_data(interactive_t *ip) {
+static int reserve_text(interactive_t *ip, int want) {
+  if (ip->text_start > 0 && ip->text_end + want >= ip->text_size) {
+    memmove(ip->text, ip->text + ip->text_start, ip->text_end - ip->text_start);
+    ip->text_end -= ip->text_start;
+    ip->text_start = 0;
+  }
+
+  int needed = ip->text_end + want + 1;
+  if (needed > ip->text_size) {
+    int limit = CONFIG_INT(__MAX_STRING_LENGTH__) + MAX_TEXT;
+    int size = std::min(std::max(needed, ip->text_size * 2), limit);
+    if (size > ip->text_size) {
+      if (ip->text) {
+        ip->text = reinterpret_cast<char *>(DREALLOC(ip->text, size, TAG_INTERACTIVE, "reserve_text"));
+      } else {
+        ip->text = reinterpret_cast<char *>(DMALLOC(size, TAG_INTERACTIVE, "reserve_text"));
+      }
+      ip->text_size = size;
+    }
+  }
+  return ip->text_size - ip->text_end - 1;
+}
+
+/*
+ * Give the input buffer back once everything in it has been used.
+ */
+static void release_text(interactive_t *ip) {
+  if (ip->text && ip->text_start == ip->text_end) {
+    FREE(ip->text);
+    ip->text = nullptr;
+    ip->text_size = ip->text_start = ip->text_end = 0;
+  }
+}
+
+/*
+ * Room for telnet input in ip->text.  If the current command gets too long
+ * to ever be used, it is thrown away.
+ */
+static int telnet_text_space(interactive_t *ip) {
+  int text_space = reserve_text(ip, MAX_TEXT);
+
+  if (text_space < MAX_TEXT / 16) {
+    ip->iflags |= SKIP_COMMAND;
+    ip->text_start = ip->text_end = 0;
+    text_space = reserve_text(ip, MAX_TEXT);
+  }
+  return std::min(text_space, MAX_TEXT);
+}
+
+/*
+ * Run received bytes through telnet into ip->text, and schedule the
+ * command if there is a complete one.
+ */
+static void telnet_input(interactive_t *ip, const char *buf, int num_bytes) {
+  int start = ip->text_end;
+
+  // this will read data into ip->text
+  telnet_recv(ip->telnet, buf, num_bytes);
+
+  if (ip->text_end > start) {
+    /* handle snooping - snooper does not see type-ahead due to
+     telnet being in linemode */
+    if (!(ip->iflags & NOECHO)) {
+      handle_snoop(ip->text + start, ip->text_end - start, ip);
+    }
+
+    // If we read something, search for command.
+    if (cmd_in_buf(ip)) {
+      ip->iflags |= CMD_IN_BUF;
+      schedule_user_command(ip);
+    }
+  }
+}
+
+/*
+ * Read and handle one chunk of pending data.  Returns false if there was
+ * nothing to read, or the connection was closed.
+ */
+static bool read_user_data(interactive_t *ip) {
   int num_bytes, text_space;
   unsigned char buf[MAX_TEXT];
-  int ws_space;
 
   text_space = sizeof(buf);
 
@@ -581,43 +1171,29 @@ void get_user_data(interactive_t *ip) {
   /* compute how much data we can read right now */
   switch (ip->connection_type) {
     case PORT_WEBSOCKET:
-      ws_space = MAX_TEXT - ip->ws_text_end;
-      /* check if we need more space */
-      if (ws_space < MAX_TEXT / 16) {
-        if (ip->ws_text_start > 0) {
-          memmove(ip->ws_text, ip->ws_text + ip->ws_text_start,
-                  ip->ws_text_end - ip->ws_text_start);
-          ws_space += ip->ws_text_start;
-          ip->ws_text_end -= ip->ws_text_start;
-          ip->ws_text_start = 0;
+      if (ip->iflags & HANDSHAKE_COMPLETE) {
+        // After the handshake a websocket carries a telnet stream.
+        num_bytes = websocket_recv(ip, reinterpret_cast<char *>(buf), telnet_text_space(ip));
+        if (num_bytes == -1) {
+          ip->iflags |= NET_DEAD;
+          remove_interactive(ip->ob, 0);
+          return false;
         }
-      }
-      if ((ip->iflags & HANDSHAKE_COMPLETE) && (!ip->ws_size) && ws_space > 8) {
-        ws_space = 8;  // only read the header or we'll end up queueing several
-                       // websocket packets with no triggers to read them
-      }
-      if (ip->ws_size && ws_space > ip->ws_size) {
-        ws_space = ip->ws_size;  // keep the next packet in the socket
+        if (!num_bytes) {
+          return false;
+        }
+#ifdef F_NETWORK_STATS
+        inet_in_packets++;
+        inet_in_volume += num_bytes;
+        external_port[ip->external_port].in_packets++;
+        external_port[ip->external_port].in_volume += num_bytes;
+#endif
+        telnet_input(ip, reinterpret_cast<const char *>(&buf[0]), num_bytes);
+        return true;
       }
       break;
     case PORT_TELNET:
-      text_space = MAX_TEXT - ip->text_end;
-
-      /* check if we need more space */
-      if (text_space < MAX_TEXT / 16) {
-        if (ip->text_start > 0) {
-          memmove(ip->text, ip->text + ip->text_start, ip->text_end - ip->text_start);
-          text_space += ip->text_start;
-          ip->text_end -= ip->text_start;
-          ip->text_start = 0;
-        }
-        if (text_space < MAX_TEXT / 16){
-          ip->iflags |= SKIP_COMMAND;
-          ip->text_start = ip->text_end = 0;
-          text_space = MAX_TEXT;
-        }
-
-      }
+      text_space = telnet_text_space(ip);
       break;
 
     case PORT_MUD:
@@ -626,6 +1202,17 @@ void get_user_data(interactive_t *ip) {
       } else {
         text_space = *reinterpret_cast<volatile int *>(ip->text) - ip->text_end + 4;
       }
+      reserve_text(ip, text_space);
+      text_space = std::min(text_space, static_cast<int>(sizeof(buf)));
+      break;
+
+    case PORT_ASCII:
+      text_space = std::min(reserve_text(ip, sizeof(buf)), static_cast<int>(sizeof(buf)));
+      if (!text_space) {
+        // Line too long, throw it away.
+        ip->text_start = ip->text_end = 0;
+        text_space = sizeof(buf);
+      }
       break;
 
     default:
@@ -638,12 +1225,8 @@ void get_user_data(interactive_t *ip) {
 
   num_bytes = bufferevent_read(ip->ev_buffer, buf, text_space);
 
-  if (num_bytes == -1) {
-    debug(connections, "get_user_data: fd %d, read error: %s.\n", ip->fd,
-          evutil_socket_error_to_string(evutil_socket_geterror(ip->fd)));
-    ip->iflags |= NET_DEAD;
-    remove_interactive(ip->ob, 0);
-    return;
+  if (!num_bytes) {
+    return false;
   }
 
 #ifdef F_NETWORK_STATS
@@ -656,145 +1239,61 @@ void get_user_data(interactive_t *ip) {
   /* process the data that we've just read */
 
   switch (ip->connection_type) {
-    case PORT_WEBSOCKET:
-      if (ip->iflags & HANDSHAKE_COMPLETE) {
-        memcpy(ip->ws_text + ip->ws_text_end, buf, num_bytes);
-        ip->ws_text_end += num_bytes;
-        if (!ip->ws_size) {
-          unsigned char *data = reinterpret_cast<unsigned char *>(&ip->ws_text[ip->ws_text_start]);
-          if (ip->ws_text_end - ip->ws_text_start < 8) {
-            break;
-          }
-          unsigned char msize = data[1];
-          int size = msize & 0x7f;
-          ip->ws_text_start += 2;
-          if (size == 126) {
-            size = (data[2] << 8) | data[3];
-            ip->ws_text_start += 2;
-          } else if (size == 127) {  // insane real size
-            ip->iflags |= NET_DEAD;
-            remove_interactive(ip->ob, 0);
-            return;
-          }
-          ip->ws_size = size;
-          if (msize & 0x80) {
-            memcpy(&ip->ws_mask, &ip->ws_text[ip->ws_text_start], 4);
-            ip->ws_text_start += 4;
-          } else {
-            ip->ws_mask = 0;
-          }
-          ip->ws_maskoffs = 0;
-        }
-        int i;
-        if (ip->ws_size) {
-          int *wdata = reinterpret_cast<int *>(&ip->ws_text[ip->ws_text_start]);
-          int *dest = reinterpret_cast<int *>(&buf[0]);
-          if (ip->ws_maskoffs) {
-            int newmask;
-            for (i = 0; i < 4; i++) {
-              (reinterpret_cast<char *>(&newmask))[i] =
-                  (reinterpret_cast<char *>(&ip->ws_mask))[(i + ip->ws_maskoffs) % 4];
-            }
-            ip->ws_mask = newmask;
-            ip->ws_maskoffs = 0;
-          }
-          i = 0;
-          while (ip->ws_size > 3 && ip->ws_text_end - ip->ws_text_start > 3) {
-            dest[i] = wdata[i] ^ ip->ws_mask;
-            i++;
-            ip->ws_text_start += 4;
-            ip->ws_size -= 4;
-          }
-          num_bytes = i * 4;
-          int left = ip->ws_size;
-          if (left > ip->ws_text_end - ip->ws_text_start) {
-            left = ip->ws_text_end - ip->ws_text_start;
-          }
-          if (left) {
-            ip->ws_maskoffs = left;
-            dest[i] = wdata[i] ^ ip->ws_mask;
-            num_bytes += left;
-            ip->ws_text_start += left;
-            ip->ws_size -= left;
-          }
-        }
-        //          for(i=0;i<num_bytes;i++)
-        //              printf("%x ", buf[i]);
-        //          puts("");
-        // and on with the telnet case
-      } else {
-        char *str = new_string(num_bytes, "PORT_WEBSOCKET");
-        memcpy(str, buf, num_bytes);
-        ip->ws_size = 0;
-        ip->ws_text_end = 0;
-        str[num_bytes] = 0;
-        push_malloced_string(str);
-        if (current_interactive) {
-          fatal("eek! someone already here\n");
-          return;
-        }
-        object_t *ob = ip->ob;
-        set_command_giver(ob);
-        current_interactive = ob;
-        safe_apply(APPLY_PROCESS_INPUT, ob, 1, ORIGIN_DRIVER);
-        set_command_giver(0);
-        current_interactive = 0;
-
-        break;  // they're not allowed to send the other stuff until we replied,
-                // so all data should be handshake stuff
-      }
-      break;
-    case PORT_TELNET: {
-      int start = ip->text_end;
-
-      // this will read data into ip->text
-      telnet_recv(ip->telnet, reinterpret_cast<const char *>(&buf[0]), num_bytes);
-
-      if (ip->text_end > start) {
-        /* handle snooping - snooper does not see type-ahead due to
-         telnet being in linemode */
-        if (!(ip->iflags & NOECHO)) {
-          handle_snoop(ip->text + start, ip->text_end - start, ip);
-        }
-
-        // If we read something, search for command.
-        if (cmd_in_buf(ip)) {
-          ip->iflags |= CMD_IN_BUF;
-          struct timeval zero_sec = {0, 0};
-          evtimer_del(ip->ev_command);
-          evtimer_add(ip->ev_command, &zero_sec);
-        }
+    case PORT_WEBSOCKET: {
+      // Only the handshake gets here.
+      char *str = new_string(num_bytes, "PORT_WEBSOCKET");
+      memcpy(str, buf, num_bytes);
+      ip->ws_size = 0;
+      str[num_bytes] = 0;
+      push_malloced_string(str);
+      if (current_interactive) {
+        fatal("eek! someone already here\n");
+        return false;
       }
-      break;
+      object_t *ob = ip->ob;
+      set_command_giver(ob);
+      current_interactive = ob;
+      safe_apply(APPLY_PROCESS_INPUT, ob, 1, ORIGIN_DRIVER);
+      set_command_giver(0);
+      current_interactive = 0;
+
+      // they're not allowed to send the other stuff until we replied,
+      // so all data should be handshake stuff
+      return false;
     }
+    case PORT_TELNET:
+      telnet_input(ip, reinterpret_cast<const char *>(&buf[0]), num_bytes);
+      break;
     case PORT_MUD:
       memcpy(ip->text + ip->text_end, buf, num_bytes);
       ip->text_end += num_bytes;
 
-      if (num_bytes == text_space) {
-        if (ip->text_end == 4) {
-          *reinterpret_cast<volatile int *>(ip->text) = ntohl(*reinterpret_cast<int *>(ip->text));
-          if (*reinterpret_cast<volatile int *>(ip->text) > MAX_TEXT - 5) {
-            remove_interactive(ip->ob, 0);
-          }
+      if (ip->text_end == 4) {
+        *reinterpret_cast<volatile int *>(ip->text) = ntohl(*reinterpret_cast<int *>(ip->text));
+        auto len = *reinterpret_cast<volatile int *>(ip->text);
+        if (len < 0 || len > CONFIG_INT(__MAX_STRING_LENGTH__)) {
+          remove_interactive(ip->ob, 0);
+          return false;
+        }
+      } else if (ip->text_end == *reinterpret_cast<volatile int *>(ip->text) + 4) {
+        svalue_t value;
+
+        ip->text[ip->text_end] = 0;
+        if (restore_svalue(ip->text + 4, &value) == 0) {
+          STACK_INC;
+          *sp = value;
         } else {
-          svalue_t value;
-
-          ip->text[ip->text_end] = 0;
-          if (restore_svalue(ip->text + 4, &value) == 0) {
-            STACK_INC;
-            *sp = value;
-          } else {
-            push_undefined();
-          }
-          ip->text_end = 0;
-          safe_apply(APPLY_PROCESS_INPUT, ip->ob, 1, ORIGIN_DRIVER);
+          push_undefined();
         }
+        ip->text_end = 0;
+        release_text(ip);
+        safe_apply(APPLY_PROCESS_INPUT, ip->ob, 1, ORIGIN_DRIVER);
       }
       break;
 
     case PORT_ASCII: {
       char *nl, *p;
+      auto ob = ip->ob;
 
       memcpy(ip->text + ip->text_end, buf, num_bytes);
       ip->text_end += num_bytes;
@@ -804,7 +1303,7 @@ void get_user_data(interactive_t *ip) {
         ip->text_start = (nl + 1) - ip->text;
 
         *nl = 0;
-        if (*(nl - 1) == '\r') {
+        if (nl > p && *(nl - 1) == '\r') {
           *--nl = 0;
         }
 
@@ -817,8 +1316,7 @@ void get_user_data(interactive_t *ip) {
           safe_apply(APPLY_PROCESS_INPUT, ip->ob, 1, ORIGIN_DRIVER);
         }
 
-        if (ip->text_start == ip->text_end) {
-          ip->text_start = ip->text_end = 0;
+        if (!IP_VALID(ip, ob) || ip->text_start == ip->text_end) {
           break;
         }
 
@@ -838,6 +1336,27 @@ void get_user_data(interactive_t *ip) {
     } break;
 #endif
   }
+  return true;
+}
+
+/*
+ * Read pending data for a user into user->interactive->text.
+ * This also does telnet negotiation.
+ *
+ * Reading stops while there is a command waiting to run, the rest stays in
+ * the input buffer until process_user_command() comes back for it.
+ */
+void get_user_data(interactive_t *ip) {
+  auto ob = ip->ob;
+
+  while (IP_VALID(ip, ob) && !(ip->iflags & (NET_DEAD | CLOSING | CMD_IN_BUF))) {
+    if (!read_user_data(ip)) {
+      break;
+    }
+  }
+  if (IP_VALID(ip, ob)) {
+    release_text(ip);
+  }
 }
 
 static int clean_buf(interactive_t *ip) {
@@ -1015,10 +1534,9 @@ static void process_input(interactive_t *ip, char *user_command) {
 
 #ifndef NO_ADD_ACTION
   if (ret->type == T_STRING) {
-    static char buf[MAX_TEXT];
+    std::string buf(ret->u.string);
 
-    strncpy(buf, ret->u.string, MAX_TEXT - 1);
-    parse_command(buf, command_giver);
+    parse_command(&buf[0], command_giver);
   } else {
     if (ret->type != T_NUMBER || !ret->u.number) {
       parse_command(user_command, command_giver);
@@ -1080,7 +1598,7 @@ int process_user_command(interactive_t *ip) {
       /* only 1 char ... switch to line buffer mode */
       ip->iflags |= WAS_SINGLE_CHAR;
       ip->iflags &= ~SINGLE_CHAR;
-      ip->text_start = ip->text_end = *ip->text = 0;
+      ip->text_start = ip->text_end = 0;
       set_linemode(ip, true);
     } else {
       if (ip->iflags & WAS_SINGLE_CHAR) {
@@ -1120,11 +1638,11 @@ exit:
    */
   if (IP_VALID(ip, command_giver)) {
     print_prompt(ip);
-    // FIXME: this doesn't belong here, should be moved to event.cc
     if (ip->iflags & CMD_IN_BUF) {
-      struct timeval zero_sec = {0, 0};
-      evtimer_del(ip->ev_command);
-      evtimer_add(ip->ev_command, &zero_sec);
+      schedule_user_command(ip);
+    } else {
+      // Pick up input that was left waiting for this command to finish.
+      get_user_data(ip);
     }
   }
 
@@ -1197,6 +1715,7 @@ void remove_interactive(object_t *ob, int dested) {
     event_free(ip->ev_command);
     ip->ev_command = NULL;
   }
+  unschedule_user_command(ip);
 
   // Free telnet handle
   if (ip->telnet != NULL) {
@@ -1217,6 +1736,9 @@ void remove_interactive(object_t *ob, int dested) {
     ip->input_to = 0;
   }
 #endif
+  if (ip->text) {
+    FREE(ip->text);
+  }
   user_del(ip);
   FREE(ip);
   ob->interactive = 0;
@@ -1321,7 +1843,6 @@ static int call_function_interactive(interactive_t *i, char *str) {
   // FIXME: this logic can be combined with above.
   if (was_single && !(i->iflags & SINGLE_CHAR)) {
     i->text_start = i->text_end = 0;
-    i->text[0] = '\0';
     i->iflags &= ~CMD_IN_BUF;
     set_linemode(i, true);
   }
@@ -1546,6 +2067,29 @@ int query_idle(object_t *ob) {
   return (get_current_time() - ob->interactive->last_time);
 } /* query_idle() */
 
+size_t query_command_queue_depth() { return command_queue.size(); }
+
+int query_output_queued(object_t *ob) {
+  if (!ob->interactive) {
+    return 0;
+  }
+  return output_queued(ob->interactive);
+}
+
+void set_output_watermarks(object_t *ob, int high, int low, int policy) {
+  if (!ob->interactive) {
+    error("set_output_watermarks() of non-interactive object.\n");
+  }
+  if (policy < OUTPUT_DROP || policy > OUTPUT_NOTIFY) {
+    error("Bad policy %d for set_output_watermarks().\n", policy);
+  }
+  auto ip = ob->interactive;
+  ip->output_high = high;
+  ip->output_low = low;
+  ip->output_policy = policy;
+  ip->iflags &= ~OUTPUT_BLOCKED;
+}
+
 #ifdef F_EXEC
 int replace_interactive(object_t *ob, object_t *obfrom) {
   if (ob->interactive) {
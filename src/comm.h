@@ -7,6 +7,7 @@
 #define COMM_H
 
 #include <sys/socket.h>  // for sockaddr, socklen_t
+#include <vector>
 
 /*
  * This macro is for testing whether ip is still valid, since many
@@ -41,8 +42,25 @@
  * comm.c
  */
 
+/*
+ * A message going to many interactives, as with say() or tell_room().  It
+ * is translated and telnet escaped once for each distinct output encoding
+ * among the receivers, and their output buffers share that copy.
+ */
+struct shared_message_t {
+  shared_message_t(const char *data, int len) : data(data), len(len) {}
+  shared_message_t(const shared_message_t &) = delete;
+  shared_message_t &operator=(const shared_message_t &) = delete;
+  ~shared_message_t();
+
+  const char *data;
+  int len;
+  std::vector<struct message_encoding_t *> encodings;
+};
+
 void add_vmessage(struct object_t *, const char *, ...);
 void add_message(struct object_t *, const char *, int);
+void add_message(struct object_t *, shared_message_t *);
 void add_binary_message_noflush(struct object_t *, const unsigned char *, int);
 void add_binary_message(struct object_t *, const unsigned char *, int);
 
@@ -62,6 +80,9 @@ int flush_message(struct interactive_t *);
 void flush_message_all();
 
 int query_idle(struct object_t *);
+int query_output_queued(struct object_t *);
+size_t query_command_queue_depth();
+void set_output_watermarks(struct object_t *, int, int, int);
 #ifndef NO_SNOOP
 int new_set_snoop(struct object_t *, struct object_t *);
 struct object_t *query_snoop(struct object_t *);
@@ -17,6 +17,116 @@ typedef void *iconv_t;
 
 struct translation *head;
 
+namespace {
+
+// Checks 8 bytes at a time, which compilers turn into vector code.
+bool is_ascii(const char *str, size_t len) {
+  const unsigned char *p = reinterpret_cast<const unsigned char *>(str);
+  const uint64_t high_bits = 0x8080808080808080ULL;
+  uint64_t acc = 0;
+
+  for (; len >= 32; p += 32, len -= 32) {
+    uint64_t w[4];
+    memcpy(w, p, sizeof(w));
+    acc |= w[0] | w[1] | w[2] | w[3];
+  }
+  for (; len >= 8; p += 8, len -= 8) {
+    uint64_t w;
+    memcpy(&w, p, sizeof(w));
+    acc |= w;
+  }
+  if (acc & high_bits) {
+    return false;
+  }
+  while (len--) {
+    if (*p++ & 0x80) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool is_valid_utf8(const char *str, size_t len) {
+  const unsigned char *p = reinterpret_cast<const unsigned char *>(str);
+  const unsigned char *end = p + len;
+
+  while (p < end) {
+    if (*p < 0x80) {
+      p++;
+      continue;
+    }
+    int n;
+    unsigned int cp;
+    if ((*p & 0xe0) == 0xc0) {
+      n = 1;
+      cp = *p & 0x1f;
+    } else if ((*p & 0xf0) == 0xe0) {
+      n = 2;
+      cp = *p & 0x0f;
+    } else if ((*p & 0xf8) == 0xf0) {
+      n = 3;
+      cp = *p & 0x07;
+    } else {
+      return false;
+    }
+    if (end - p <= n) {
+      return false;
+    }
+    for (int i = 1; i <= n; i++) {
+      if ((p[i] & 0xc0) != 0x80) {
+        return false;
+      }
+      cp = (cp << 6) | (p[i] & 0x3f);
+    }
+    // overlong forms, surrogates and out of range code points
+    static const unsigned int min_cp[] = {0, 0x80, 0x800, 0x10000};
+    if (cp < min_cp[n] || cp > 0x10ffff || (cp >= 0xd800 && cp <= 0xdfff)) {
+      return false;
+    }
+    p += n + 1;
+  }
+  return true;
+}
+
+// Which of the TRANSLATE_* shortcuts are safe for cd.
+int probe_translation(iconv_t cd, bool utf8) {
+  char ascii[127];
+  char out[sizeof(ascii) * 4];
+  char *in = ascii, *outp = out;
+  size_t inleft = sizeof(ascii), outleft = sizeof(out);
+  int flags = 0;
+
+  for (size_t i = 0; i < sizeof(ascii); i++) {
+    ascii[i] = i + 1;
+  }
+  if (iconv(cd, &in, &inleft, &outp, &outleft) != (size_t)-1 && !inleft &&
+      outp - out == sizeof(ascii) && !memcmp(ascii, out, sizeof(ascii))) {
+    flags |= TRANSLATE_ASCII_SAFE;
+    if (utf8) {
+      flags |= TRANSLATE_UTF8_IDENTITY;
+    }
+  }
+  iconv(cd, nullptr, nullptr, nullptr, nullptr);
+  return flags;
+}
+
+bool is_utf8_name(const char *encoding) {
+  return !strcasecmp(encoding, "UTF-8") || !strcasecmp(encoding, "UTF8");
+}
+
+int translation_flags(iconv_t tr) {
+  for (auto cur = head; cur; cur = cur->next) {
+    if (cur->outgoing == tr) {
+      return cur->outgoing_flags;
+    }
+    if (cur->incoming == tr) {
+      return cur->incoming_flags;
+    }
+  }
+  return 0;
+}
+}  // namespace
+
 static struct translation *find_translator(const char *encoding) {
   struct translation *cur = head;
   while (cur) {
@@ -52,6 +162,8 @@ struct translation *get_translator(const char *encoding) {
     return 0;
   }
   name[strlen(encoding)] = 0;
+  ret->incoming_flags = probe_translation(ret->incoming, is_utf8_name(encoding));
+  ret->outgoing_flags = probe_translation(ret->outgoing, is_utf8_name(encoding));
   if (!head) {
     head = ret;
   } else {
@@ -64,49 +176,61 @@ struct translation *get_translator(const char *encoding) {
   return ret;
 }
 
+/*
+ * Convert inlen bytes of mes with tr.  The result is in a static buffer
+ * (or is mes itself), valid until the next call.
+ */
 char *translate(iconv_t tr, const char *mes, int inlen, int *outlen) {
-  size_t len = inlen;
-  size_t len2;
-  unsigned char *tmp = (unsigned char *)mes;
   static char *res = 0;
   static size_t reslen = 0;
-  char *tmp2;
 
-  if (!res) {
-    res = reinterpret_cast<char *>(DMALLOC(1, TAG_PERMANENT, "translate"));
-    reslen = 1;
+  // Most text is plain ASCII, which almost every encoding shares.
+  auto flags = translation_flags(tr);
+  if (((flags & TRANSLATE_ASCII_SAFE) && is_ascii(mes, inlen)) ||
+      ((flags & TRANSLATE_UTF8_IDENTITY) && is_valid_utf8(mes, inlen))) {
+    *outlen = inlen;
+    return const_cast<char *>(mes);
+  }
+
+  if (reslen < static_cast<size_t>(inlen) + 1) {
+    reslen = inlen + 1;
+    if (res) {
+      FREE(res);
+    }
+    res = reinterpret_cast<char *>(DMALLOC(reslen, TAG_PERMANENT, "translate"));
   }
 
-  tmp2 = res;
-  len2 = reslen;
+  size_t len = inlen;
+  char *tmp = const_cast<char *>(mes);
+  char *tmp2 = res;
+  // Keep room for the terminating zero.
+  size_t len2 = reslen - 1;
 
   while (len) {
-    iconv(tr, reinterpret_cast<char **>(&tmp), &len, &tmp2, &len2);
+    if (iconv(tr, &tmp, &len, &tmp2, &len2) != (size_t)-1) {
+      break;
+    }
+    if (errno == E2BIG) {
+      // Grow the buffer and carry on where we stopped.
+      auto done = tmp2 - res;
+      reslen = reslen * 2 + len;
+      res = reinterpret_cast<char *>(DREALLOC(res, reslen, TAG_PERMANENT, "translate"));
+      tmp2 = res + done;
+      len2 = reslen - 1 - done;
+      continue;
+    }
 #ifdef PACKAGE_DWLIB
-    if (len > 1 && tmp[0] == 0xff && tmp[1] == 0xf9) {
+    if (len > 1 && static_cast<unsigned char>(tmp[0]) == 0xff &&
+        static_cast<unsigned char>(tmp[1]) == 0xf9) {
       len -= 2;
       tmp += 2;
-#else
-    if (0) {
-#endif
-    } else {
-      if (E2BIG == errno) {
-        errno = 0;
-        tmp = (unsigned char *)mes;
-        len = strlen(mes) + 1;
-        FREE(res);
-        reslen *= 2;
-        res = reinterpret_cast<char *>(DMALLOC(reslen, TAG_PERMANENT, "translate"));
-        tmp2 = res;
-        len2 = reslen;
-        continue;
-      }
-      tmp2[0] = 0;
-      *outlen = reslen - len2;
-      return res;
+      continue;
     }
+#endif
+    break;
   }
-  *outlen = reslen - len2;
+  tmp2[0] = 0;
+  *outlen = tmp2 - res;
   return res;
 }
 
@@ -146,6 +270,10 @@ void f_to_utf8() {
   }
   char *text = const_cast<char *>(sp->u.string);
   char *translated = translate_easy(newt->incoming, text);
+  // Nothing to convert: the argument is already the result.
+  if (translated == text) {
+    return;
+  }
   pop_stack();
   copy_and_push_string(translated);
 }
@@ -160,6 +288,10 @@ void f_utf8_to() {
   }
   char *text = const_cast<char *>(sp->u.string);
   char *translated = translate_easy(newt->outgoing, text);
+  // Nothing to convert: the argument is already the result.
+  if (translated == text) {
+    return;
+  }
   pop_stack();
   copy_and_push_string(translated);
 }
@@ -202,9 +334,9 @@ void f_arr_to_str() {
   }
 
   trans = translate(newt->incoming, reinterpret_cast<char *>(in), (sp->u.arr->size + 1) * 4, &len);
-  FREE(in);
   pop_stack();
   copy_and_push_string(trans);
+  FREE(in);
 }
 
 #endif
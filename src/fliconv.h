@@ -7,9 +7,17 @@ struct translation {
   char *name;
   iconv_t incoming;
   iconv_t outgoing;
+  // TRANSLATE_* flags, for each direction.
+  int incoming_flags;
+  int outgoing_flags;
   struct translation *next;
 };
 
+// ASCII text converts to itself.
+#define TRANSLATE_ASCII_SAFE 1
+// Valid UTF-8 converts to itself.
+#define TRANSLATE_UTF8_IDENTITY 2
+
 char *translate(iconv_t tr, const char *mes, int inlen, int *outlen);
 char *translate_easy(iconv_t tr, const char *mes);
 struct translation *get_translator(const char *encoding);
@@ -0,0 +1,13 @@
+/*
+ * inventory.h -- which objects inventory_count() and inventory_find() look
+ * at, or'ed together.  Without INV_DEEP only the direct inventory counts.
+ */
+
+#ifndef _INVENTORY_H_
+#define _INVENTORY_H_
+
+#define INV_DEEP 1        /* the whole tree, like deep_inventory() */
+#define INV_LIVING 2      /* only living objects                   */
+#define INV_INTERACTIVE 4 /* only interactive objects              */
+
+#endif /* _INVENTORY_H_ */
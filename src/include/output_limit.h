@@ -0,0 +1,15 @@
+/*
+ * output_limit.h -- what happens to output sent to a connection that has
+ * more than its high watermark of output queued, see set_output_watermarks()
+ * and the "output overflow policy" config option.
+ */
+
+#ifndef _OUTPUT_LIMIT_H_
+#define _OUTPUT_LIMIT_H_
+
+#define OUTPUT_DROP 0       /* drop it silently                            */
+#define OUTPUT_TRUNCATE 1   /* drop it, with a marker where output stopped */
+#define OUTPUT_DISCONNECT 2 /* close the connection                        */
+#define OUTPUT_NOTIFY 3     /* drop it, and call output_overflow()         */
+
+#endif /* _OUTPUT_LIMIT_H_ */
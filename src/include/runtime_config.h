@@ -99,6 +99,21 @@
 #define __RC_SPRINTF_ADD_JUSTFIED_IGNORE_ANSI_COLORS__ CFG_INT(54)
 #define __RC_APPLY_CACHE_BITS__ CFG_INT(55)
 #define __RC_CALL_OUT_ZERO_NEST_LEVEL__ CFG_INT(56)
+#define __RC_FILE_CACHE_SIZE__ CFG_INT(57)
+#define __RC_REGEXP_CACHE_SIZE__ CFG_INT(58)
+#define __RC_OUTPUT_BATCH_SIZE__ CFG_INT(59)
+#define __RC_WORKER_THREADS__ CFG_INT(60)
+#define __RC_LISTEN_SOCKETS__ CFG_INT(61)
+#define __RC_LOGINS_PER_TICK__ CFG_INT(62)
+#define __RC_LOGIN_QUEUE_SIZE__ CFG_INT(63)
+#define __RC_OUTPUT_HIGH_WATERMARK__ CFG_INT(64)
+#define __RC_OUTPUT_LOW_WATERMARK__ CFG_INT(65)
+#define __RC_OUTPUT_OVERFLOW_POLICY__ CFG_INT(66)
+#define __RC_COMMAND_BUDGET_MSEC__ CFG_INT(67)
+#define __RC_USER_COMMANDS_PER_SECOND__ CFG_INT(68)
+#define __RC_RESET_BUDGET_MSEC__ CFG_INT(69)
+#define __RC_RECLAIM_BUDGET_MSEC__ CFG_INT(70)
+#define __RC_LAZY_INIT__ CFG_INT(71)
 
 #define RUNTIME_CONFIG_NEXT CFG_INT(100)
 #endif /* RUNTIME_CONFIG_H */
@@ -33,6 +33,8 @@
 #define USING_GMCP 0x10000         /* we've negotiated gmcp */
 #define HANDSHAKE_COMPLETE 0x20000 /* websocket connected */
 #define USING_COMPRESS 0x40000     /* we've negotiated compress */
+#define OUTPUT_BLOCKED 0x80000     /* over the output high watermark */
+#define CMD_QUEUED 0x100000        /* waiting in the command scheduler */
 
 struct interactive_t {
   struct object_t *ob; /* points to the associated object         */
@@ -48,7 +50,8 @@ struct interactive_t {
   int local_port;      /* which of our ports they connected to    */
   int external_port;   /* external port index for connection      */
   const char *prompt;  /* prompt string for interactive object    */
-  char text[MAX_TEXT]; /* input buffer for interactive object     */
+  char *text;          /* input buffer, allocated while not empty */
+  int text_size;       /* allocated size of text                  */
   int text_end;        /* first free char in buffer               */
   int text_start;      /* where we are up to in user command buffer */
   int last_time;       /* time of last command executed           */
@@ -69,12 +72,15 @@ struct interactive_t {
   // iconv handle
   struct translation *trans;
 
-  char ws_text[MAX_TEXT]; /* input buffer for interactive object     */
-  int ws_text_end;        /* first free char in buffer               */
-  int ws_text_start;      /* where we are up to in user command buffer */
-  int ws_size;
-  int ws_mask;
-  char ws_maskoffs;
+  // websocket frame being received, see net/websocket.cc
+  uint64_t ws_size;           /* payload bytes left in the frame         */
+  unsigned char ws_mask[4];   /* masking key of the frame                */
+  int ws_maskoffs;            /* index into ws_mask for the next byte    */
+
+  // output backpressure, see set_output_watermarks()
+  int output_high;   /* queued bytes that block output, 0 for no limit */
+  int output_low;    /* output is let through again below this      */
+  int output_policy; /* OUTPUT_* from include/output_limit.h        */
 
   // libtelnet handle
   struct telnet_t *telnet;
@@ -82,6 +88,7 @@ struct interactive_t {
   // libevent event handle.
   struct bufferevent *ev_buffer;
   struct event *ev_command;
+  int64_t command_tat; /* when the rate limit allows the next command, usec */
 };
 
 #endif /* INTERACTIVE_H */
@@ -8,6 +8,7 @@
 #include <string>
 
 #include "comm.h"
+#include "net/websocket.h"
 #include "packages/core/mssp.h"
 #include "packages/core/telnet_ext.h"
 #include "thirdparty/libtelnet/libtelnet.h"  // for telnet_t, telnet_event_t*
@@ -31,7 +32,11 @@ static void telnet_event_handler(telnet_t * /*telnet*/, telnet_event_t * /*ev*/,
                                  void * /*user_data*/);
 
 struct telnet_t *net_telnet_init(interactive_t *user) {
-  return telnet_init(my_telopts, telnet_event_handler, 0, user);
+  auto telnet = telnet_init(my_telopts, telnet_event_handler, 0, user);
+  if (CONFIG_INT(__RC_OUTPUT_BATCH_SIZE__)) {
+    telnet_defer_flush(telnet, 1);
+  }
+  return telnet;
 }
 
 // ANSI
@@ -65,7 +70,11 @@ static inline void on_telnet_data(const char *buffer, unsigned long size, intera
 }
 
 static inline void on_telnet_send(const char *buffer, unsigned long size, interactive_t *ip) {
-  bufferevent_write(ip->ev_buffer, buffer, size);
+  if (ip->connection_type == PORT_WEBSOCKET) {
+    websocket_send(ip, buffer, size);
+  } else {
+    bufferevent_write(ip->ev_buffer, buffer, size);
+  }
 }
 
 static inline void on_telnet_iac(unsigned char cmd, interactive_t *ip) {
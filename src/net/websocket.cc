@@ -0,0 +1,209 @@
+/*
+ * websocket.cc
+ *
+ * RFC 6455 framing for websocket connections, once the mudlib has done the
+ * handshake.  Frames are decoded straight out of the connection's input
+ * evbuffer: payloads are unmasked as they are copied out, a frame doesn't
+ * need to have arrived in full, and fragmented messages simply continue
+ * the byte stream.
+ */
+
+#include "base/std.h"
+
+#include "net/websocket.h"
+
+#include <algorithm>
+#include <event2/buffer.h>
+#include <event2/bufferevent.h>
+
+#include "interactive.h"
+
+namespace {
+
+const int kOpContinuation = 0x0;
+const int kOpText = 0x1;
+const int kOpBinary = 0x2;
+const int kOpClose = 0x8;
+const int kOpPing = 0x9;
+const int kOpPong = 0xa;
+
+const unsigned char kFin = 0x80;
+const unsigned char kMasked = 0x80;
+
+// Control frames can't be fragmented and carry at most 125 bytes.
+const size_t kMaxControlPayload = 125;
+
+/*
+ * XOR data with the masking key, starting at mask[offset].  Works on eight
+ * bytes at a time, which the compiler turns into vector instructions where
+ * it can.
+ */
+void unmask(unsigned char *data, size_t len, const unsigned char *mask, int offset) {
+  unsigned char key[8];
+  for (int i = 0; i < 8; i++) {
+    key[i] = mask[(i + offset) % 4];
+  }
+  uint64_t key64;
+  memcpy(&key64, key, sizeof(key64));
+
+  size_t i = 0;
+  for (; i + 8 <= len; i += 8) {
+    uint64_t word;
+    memcpy(&word, data + i, sizeof(word));
+    word ^= key64;
+    memcpy(data + i, &word, sizeof(word));
+  }
+  for (; i < len; i++) {
+    data[i] ^= key[i % 4];
+  }
+}
+
+size_t frame_header(int opcode, size_t len, unsigned char *out) {
+  out[0] = kFin | opcode;
+  if (len < 126) {
+    out[1] = len;
+    return 2;
+  }
+  if (len <= 0xffff) {
+    out[1] = 126;
+    out[2] = len >> 8;
+    out[3] = len;
+    return 4;
+  }
+  out[1] = 127;
+  for (int i = 0; i < 8; i++) {
+    out[2 + i] = static_cast<uint64_t>(len) >> (56 - 8 * i);
+  }
+  return 10;
+}
+
+void send_frame(interactive_t *ip, int opcode, const char *data, size_t len) {
+  unsigned char header[WEBSOCKET_MAX_HEADER];
+  auto output = bufferevent_get_output(ip->ev_buffer);
+  evbuffer_add(output, header, frame_header(opcode, len, header));
+  evbuffer_add(output, data, len);
+}
+
+/*
+ * Handle a control frame whose header is hlen bytes long, if all of it has
+ * arrived.  Returns 0 if it hasn't, 1 if it was handled, -1 to close the
+ * connection.
+ */
+int control_frame(interactive_t *ip, struct evbuffer *input, const unsigned char *header,
+                  size_t hlen, size_t len, const unsigned char *mask) {
+  if (!(header[0] & kFin) || len > kMaxControlPayload) {
+    return -1;
+  }
+  if (evbuffer_get_length(input) < hlen + len) {
+    return 0;
+  }
+  unsigned char payload[kMaxControlPayload];
+  evbuffer_drain(input, hlen);
+  evbuffer_remove(input, payload, len);
+  if (mask) {
+    unmask(payload, len, mask, 0);
+  }
+
+  switch (header[0] & 0x0f) {
+    case kOpPing:
+      send_frame(ip, kOpPong, reinterpret_cast<char *>(payload), len);
+      return 1;
+    case kOpPong:
+      return 1;
+    case kOpClose:
+      // Echo the status code back, the connection is closed after that.
+      send_frame(ip, kOpClose, reinterpret_cast<char *>(payload), std::min<size_t>(len, 2));
+      return -1;
+    default:
+      return -1;
+  }
+}
+}  // namespace
+
+int websocket_recv(interactive_t *ip, char *buf, int size) {
+  auto input = bufferevent_get_input(ip->ev_buffer);
+  int total = 0;
+
+  while (total < size) {
+    if (!ip->ws_size) {
+      // Need a frame header, which is 2 to 14 bytes.
+      unsigned char header[WEBSOCKET_MAX_HEADER + 4];
+      auto avail = evbuffer_get_length(input);
+      if (avail < 2) {
+        break;
+      }
+      evbuffer_copyout(input, header, std::min(avail, sizeof(header)));
+
+      uint64_t len = header[1] & 0x7f;
+      size_t hlen = 2;
+      if (len == 126) {
+        hlen += 2;
+      } else if (len == 127) {
+        hlen += 8;
+      }
+      const unsigned char *mask = nullptr;
+      if (header[1] & kMasked) {
+        mask = header + hlen;
+        hlen += 4;
+      }
+      if (avail < hlen) {
+        break;
+      }
+      if (len == 126) {
+        len = (header[2] << 8) | header[3];
+      } else if (len == 127) {
+        len = 0;
+        for (int i = 2; i < 10; i++) {
+          len = (len << 8) | header[i];
+        }
+      }
+
+      auto opcode = header[0] & 0x0f;
+      if (opcode & 0x8) {
+        auto result = control_frame(ip, input, header, hlen, len, mask);
+        if (result == -1) {
+          return -1;
+        }
+        if (result == 0) {
+          break;
+        }
+        continue;
+      }
+      if (opcode != kOpContinuation && opcode != kOpText && opcode != kOpBinary) {
+        return -1;
+      }
+
+      // Data frames are just more of the stream, text or binary.
+      evbuffer_drain(input, hlen);
+      ip->ws_size = len;
+      if (mask) {
+        memcpy(ip->ws_mask, mask, sizeof(ip->ws_mask));
+      } else {
+        memset(ip->ws_mask, 0, sizeof(ip->ws_mask));
+      }
+      ip->ws_maskoffs = 0;
+      continue;
+    }
+
+    size_t n = std::min<uint64_t>(size - total, ip->ws_size);
+    n = std::min(n, evbuffer_get_length(input));
+    if (!n) {
+      break;
+    }
+    auto data = reinterpret_cast<unsigned char *>(buf + total);
+    evbuffer_remove(input, data, n);
+    unmask(data, n, ip->ws_mask, ip->ws_maskoffs);
+    ip->ws_maskoffs = (ip->ws_maskoffs + n) % 4;
+    ip->ws_size -= n;
+    total += n;
+  }
+  return total;
+}
+
+void websocket_send(interactive_t *ip, const char *data, size_t len) {
+  send_frame(ip, kOpBinary, data, len);
+}
+
+size_t websocket_frame_header(size_t len, unsigned char *out) {
+  return frame_header(kOpBinary, len, out);
+}
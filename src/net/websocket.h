@@ -0,0 +1,21 @@
+#ifndef WEBSOCKET_H_
+#define WEBSOCKET_H_
+
+#include <stddef.h>
+
+// Largest frame header websocket_frame_header() writes.
+#define WEBSOCKET_MAX_HEADER 10
+
+// Decode frames waiting in the input buffer of a websocket connection, and
+// unmask up to size bytes of their payload into buf.  Control frames are
+// answered here.  Returns the number of bytes decoded, or -1 if the
+// connection should be closed.
+int websocket_recv(struct interactive_t *ip, char *buf, int size);
+
+// Send data in a binary frame.
+void websocket_send(struct interactive_t *ip, const char *data, size_t len);
+
+// Write the header of a binary frame carrying len bytes, returns its size.
+size_t websocket_frame_header(size_t len, unsigned char *out);
+
+#endif /* WEBSOCKET_H_ */
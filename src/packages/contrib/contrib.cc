@@ -256,8 +256,28 @@ static int doCopy(mapping_t *map, mapping_node_t *elt, void *dest) {
   return 0;
 }
 
+static int findDeep(mapping_t *map, mapping_node_t *elt, void *found) {
+  switch (elt->values[1].type) {
+    case T_ARRAY:
+    case T_CLASS:
+    case T_MAPPING:
+#ifndef NO_BUFFER_TYPE
+    case T_BUFFER:
+#endif
+      return *reinterpret_cast<int *>(found) = 1;
+  }
+  return 0;
+}
+
 static mapping_t *deep_copy_mapping(mapping_t *arg) {
   mapping_t *map;
+  int deep = 0;
+
+  /* nothing in it needs copying, so the copy can share the table */
+  mapTraverse(arg, findDeep, &deep);
+  if (!deep) {
+    return share_mapping(arg);
+  }
 
   map = allocate_mapping(0);     /* this should be fixed.  -Beek */
   mapTraverse(arg, doCopy, map); /* Not horridly efficient either */
@@ -1,9 +1,14 @@
 #include "base/package_api.h"
 
 #include "packages/core/add_action.h"
+#include "packages/core/verb_index.h"
 
 #ifndef NO_ADD_ACTION
 
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+
 #define MAX_VERB_BUFF 100
 
 object_t *hashed_living[CFG_LIVING_HASH_SIZE] = {0};
@@ -15,6 +20,21 @@ static int illegal_sentence_action;
 static const char *last_verb;
 static object_t *illegal_sentence_ob;
 
+/*
+ * With "lazy init", init() of an object that isn't living is not called when
+ * a living meets it, but only once that living gives a command.  These are
+ * the objects each living still has to do that for, in the order it met
+ * them; each holds a reference.
+ */
+struct pending_init_t {
+  std::vector<object_t *> obs;
+  std::unordered_set<object_t *> seen;
+};
+static std::unordered_map<object_t *, pending_init_t> pending_inits;
+// And the other way around: the livings each of those objects waits for.
+static std::unordered_map<object_t *, std::vector<object_t *>> pending_livings;
+static uint64_t inits_deferred, inits_run, inits_dropped;
+
 static void notify_no_command(void) {
   union string_or_func p;
   svalue_t *v;
@@ -150,8 +170,117 @@ void stat_living_objects(outbuffer_t *out) {
   outbuf_add(out, "-----------------------------\n");
   outbuf_addv(out, "%d living named objects, average search length: %4.2f\n\n", num_living_names,
               static_cast<double>(search_length) / num_searches);
+  outbuf_addv(out,
+              "Lazy init: %" PRIu64 " deferred, %" PRIu64 " run, %" PRIu64
+              " dropped, %zu livings waiting\n\n",
+              inits_deferred, inits_run, inits_dropped, pending_inits.size());
+  print_verb_index_stats(out);
+}
+
+static bool is_near(object_t *ob, object_t *living) {
+  return ob == living->super || ob->super == living ||
+         (living->super && ob->super == living->super);
+}
+
+// Call init() in ob with living as this_player(), or leave it for later.
+static void call_init(object_t *ob, object_t *living) {
+  if (CONFIG_INT(__RC_LAZY_INIT__) && !(ob->flags & O_ENABLE_COMMANDS)) {
+    auto &pending = pending_inits[living];
+    if (pending.seen.insert(ob).second) {
+      add_ref(ob, "call_init");
+      pending.obs.push_back(ob);
+      pending_livings[ob].push_back(living);
+      inits_deferred++;
+    }
+    return;
+  }
+  save_command_giver(living);
+  (void)apply(APPLY_INIT, ob, 0, ORIGIN_DRIVER);
+  restore_command_giver();
+}
+
+static void unlink_pending_living(object_t *ob, object_t *living) {
+  auto it = pending_livings.find(ob);
+  auto &livings = it->second;
+  livings.erase(std::find(livings.begin(), livings.end(), living));
+  if (livings.empty()) {
+    pending_livings.erase(it);
+  }
+}
+
+/*
+ * Run the init() calls left for living by "lazy init", for the objects that
+ * are still near it.
+ */
+static void run_pending_inits(object_t *living) {
+  auto it = pending_inits.find(living);
+  if (it == pending_inits.end()) {
+    return;
+  }
+  auto obs = std::move(it->second.obs);
+  pending_inits.erase(it);
+  for (auto ob : obs) {
+    unlink_pending_living(ob, living);
+  }
+
+  save_command_giver(living);
+  for (auto ob : obs) {
+    if (!(ob->flags & O_DESTRUCTED) && !(living->flags & O_DESTRUCTED) &&
+        (living->flags & O_ENABLE_COMMANDS) && is_near(ob, living)) {
+      inits_run++;
+      safe_apply(APPLY_INIT, ob, 0, ORIGIN_DRIVER);
+    } else {
+      inits_dropped++;
+    }
+    free_object(&ob, "run_pending_inits");
+  }
+  restore_command_giver();
+}
+
+void clear_pending_inits(object_t *living) {
+  auto it = pending_inits.find(living);
+  if (it == pending_inits.end()) {
+    return;
+  }
+  for (auto ob : it->second.obs) {
+    unlink_pending_living(ob, living);
+    inits_dropped++;
+    free_object(&ob, "clear_pending_inits");
+  }
+  pending_inits.erase(it);
 }
 
+void forget_pending_init(object_t *ob) {
+  auto it = pending_livings.find(ob);
+  if (it == pending_livings.end()) {
+    return;
+  }
+  auto livings = std::move(it->second);
+  pending_livings.erase(it);
+  for (auto living : livings) {
+    auto pending = pending_inits.find(living);
+    auto &obs = pending->second.obs;
+    obs.erase(std::find(obs.begin(), obs.end(), ob));
+    pending->second.seen.erase(ob);
+    if (obs.empty()) {
+      pending_inits.erase(pending);
+    }
+    inits_dropped++;
+    auto ref = ob;
+    free_object(&ref, "forget_pending_init");
+  }
+}
+
+#ifdef DEBUGMALLOC_EXTENSIONS
+void mark_pending_inits() {
+  for (auto &pending : pending_inits) {
+    for (auto ob : pending.second.obs) {
+      ob->extra_ref++;
+    }
+  }
+}
+#endif
+
 void setup_new_commands(object_t *dest, object_t *item) {
   object_t *next_ob, *ob;
 
@@ -164,9 +293,7 @@ void setup_new_commands(object_t *dest, object_t *item) {
    * the -o mode). It might be too slow, though :-(
    */
   if (item->flags & O_ENABLE_COMMANDS) {
-    save_command_giver(item);
-    (void)apply(APPLY_INIT, dest, 0, ORIGIN_DRIVER);
-    restore_command_giver();
+    call_init(dest, item);
     if (item->super != dest) {
       return;
     }
@@ -187,9 +314,7 @@ void setup_new_commands(object_t *dest, object_t *item) {
       error("An object was moved at call of " APPLY_INIT "()\n");
     }
     if (ob->flags & O_ENABLE_COMMANDS) {
-      save_command_giver(ob);
-      (void)apply(APPLY_INIT, item, 0, ORIGIN_DRIVER);
-      restore_command_giver();
+      call_init(item, ob);
       if (dest != item->super) {
         return;
       }
@@ -201,9 +326,7 @@ void setup_new_commands(object_t *dest, object_t *item) {
       error("An object was destructed at call of " APPLY_INIT "()\n");
     }
     if (item->flags & O_ENABLE_COMMANDS) {
-      save_command_giver(item);
-      (void)apply(APPLY_INIT, ob, 0, ORIGIN_DRIVER);
-      restore_command_giver();
+      call_init(ob, item);
       if (dest != item->super) {
         return;
       }
@@ -216,9 +339,7 @@ void setup_new_commands(object_t *dest, object_t *item) {
     error("The object to be moved was destructed at call of " APPLY_INIT "()\n");
   }
   if (dest->flags & O_ENABLE_COMMANDS) {
-    save_command_giver(dest);
-    (void)apply(APPLY_INIT, item, 0, ORIGIN_DRIVER);
-    restore_command_giver();
+    call_init(item, dest);
   }
 }
 
@@ -277,6 +398,7 @@ static void enable_commands(int enable, int toggle_action) {
       remove_sent(pp, current_object);
     }
 #endif
+    clear_pending_inits(current_object);
     current_object->flags &= ~O_ENABLE_COMMANDS;
     if (current_object == command_giver) {
       set_command_giver(0);
@@ -338,11 +460,21 @@ static int user_parser(char *buff) {
     }
   }
 
+  // Only the sentences that can match, in the order of command_giver->sent.
+  std::vector<sentence_t *> candidates;
+  verb_index_lookup(command_giver, buff, user_verb, &candidates);
+
   save_illegal_sentence_action = illegal_sentence_action;
   illegal_sentence_action = 0;
-  for (s = command_giver->sent; s; s = s->next) {
+  for (auto candidate : candidates) {
     svalue_t *ret;
 
+    // A verb returning 0 may have destructed the command giver.
+    if (!command_giver || (command_giver->flags & O_DESTRUCTED)) {
+      break;
+    }
+    s = candidate;
+
     if (s->flags & (V_NOSPACE | V_SHORT)) {
       if (strncmp(buff, s->verb, strlen(s->verb)) != 0) {
         continue;
@@ -482,6 +614,7 @@ int parse_command(char *str, object_t *ob) {
   }
 
   save_command_giver(ob);
+  run_pending_inits(ob);
   res = user_parser(str);
   restore_command_giver();
 
@@ -545,7 +678,24 @@ static void add_action(svalue_t *str, const char *cmd, int flag) {
   p->verb = make_shared_string(cmd);
   /* This is ok; adding to the top of the list doesn't harm anything */
   p->next = command_giver->sent;
+  p->prev = 0;
+  if (p->next) {
+    p->next->prev = p;
+  }
   command_giver->sent = p;
+  verb_index_add(command_giver, p);
+}
+
+static void unlink_sentence(object_t *ob, sentence_t *s) {
+  if (s->prev) {
+    s->prev->next = s->next;
+  } else {
+    ob->sent = s->next;
+  }
+  if (s->next) {
+    s->next->prev = s->prev;
+  }
+  verb_index_remove(ob, s);
 }
 
 /*
@@ -555,7 +705,7 @@ static void add_action(svalue_t *str, const char *cmd, int flag) {
  */
 static int remove_action(const char *act, const char *verb) {
   object_t *ob;
-  sentence_t **s;
+  sentence_t *s;
 
   if (command_giver) {
     ob = command_giver;
@@ -564,14 +714,11 @@ static int remove_action(const char *act, const char *verb) {
   }
 
   if (ob) {
-    for (s = &ob->sent; *s; s = &((*s)->next)) {
-      sentence_t *tmp;
-
-      if (((*s)->ob == current_object) && (!((*s)->flags & V_FUNCTION)) &&
-          !strcmp((*s)->function.s, act) && !strcmp((*s)->verb, verb)) {
-        tmp = *s;
-        *s = tmp->next;
-        free_sentence(tmp);
+    for (s = ob->sent; s; s = s->next) {
+      if ((s->ob == current_object) && (!(s->flags & V_FUNCTION)) && !strcmp(s->function.s, act) &&
+          !strcmp(s->verb, verb)) {
+        unlink_sentence(ob, s);
+        free_sentence(s);
         illegal_sentence_action = 1;
         illegal_sentence_ob = current_object;
         return 1;
@@ -587,31 +734,24 @@ static int remove_action(const char *act, const char *verb) {
  */
 #ifndef NO_ENVIRONMENT
 void remove_sent(object_t *ob, object_t *user) {
-  sentence_t **s;
-
   if (!(user->flags & O_ENABLE_COMMANDS)) {
     return;
   }
 
-  for (s = &user->sent; *s;) {
-    sentence_t *tmp;
-
-    if ((*s)->ob == ob) {
+  std::vector<sentence_t *> owned;
+  verb_index_owned(user, ob, &owned);
+  for (auto s : owned) {
 #ifdef DEBUG
-      if (!((*s)->flags & V_FUNCTION)) {
-        debug(add_action, "--Unlinking sentence %s (user: %s ob: %s)\n", (*s)->function.s,
-              user->obname, ob->obname);
-      }
+    if (!(s->flags & V_FUNCTION)) {
+      debug(add_action, "--Unlinking sentence %s (user: %s ob: %s)\n", s->function.s,
+            user->obname, ob->obname);
+    }
 #endif
 
-      tmp = *s;
-      *s = tmp->next;
-      free_sentence(tmp);
-      illegal_sentence_action = 2;
-      illegal_sentence_ob = ob;
-    } else {
-      s = &((*s)->next);
-    }
+    unlink_sentence(user, s);
+    free_sentence(s);
+    illegal_sentence_action = 2;
+    illegal_sentence_ob = ob;
   }
 }
 #endif
@@ -683,7 +823,10 @@ void f_command(void) {
 #endif
 
 #ifdef F_COMMANDS
-void f_commands(void) { push_refed_array(commands(current_object)); }
+void f_commands(void) {
+  run_pending_inits(current_object);
+  push_refed_array(commands(current_object));
+}
 #endif
 
 #ifdef F_DISABLE_COMMANDS
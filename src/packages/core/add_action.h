@@ -10,6 +10,13 @@ void stat_living_objects(outbuffer_t *);
 void remove_living_name(object_t *);
 object_t *find_living_object(const char *, int);
 void setup_new_commands(object_t *, object_t *);
+// Forget the init() calls "lazy init" left for a living.
+void clear_pending_inits(object_t *);
+// Forget the init() calls left in ob, when it moves or is destructed.
+void forget_pending_init(object_t *);
+#ifdef DEBUGMALLOC_EXTENSIONS
+void mark_pending_inits();
+#endif
 #ifndef NO_ENVIRONMENT
 void remove_sent(object_t *, object_t *);
 #endif
@@ -33,6 +40,12 @@ void remove_sent(object_t *, object_t *);
 #define setup_new_commands(x, y) \
   do {                           \
   } while (0)
+#define clear_pending_inits(x) \
+  do {                         \
+  } while (0)
+#define forget_pending_init(x) \
+  do {                         \
+  } while (0)
 #endif
 
 #endif /* ADD_ACTION_H */
@@ -77,11 +77,15 @@ void defer(function);
 object environment(void | object);
 object *all_inventory(object default: F__THIS_OBJECT);
 object *deep_inventory(object | object * | function, void | function default: F__THIS_OBJECT);
+int inventory_count(object, int, void | object);
+object *inventory_find(object, int, int, void | object);
 object first_inventory(object | string default: F__THIS_OBJECT);
 object next_inventory(object default: F__THIS_OBJECT);
 void say(string, void | object | object *);
 void tell_room(object | string, string | object | int | float, void | object | object *);
 object present(object | string, void | object);
+void set_present_ids(string * | int);
+string *query_present_ids(object default: F__THIS_OBJECT);
 void move_object(object | string);
 #endif
 
@@ -176,6 +180,9 @@ void replace_program(string);
 
 mixed regexp(string | string *, string, void | int);
 mixed *reg_assoc(string, string *, mixed *, mixed | void);
+int matcher_compile(string *, string * | void);
+int *matcher_match(int, string);
+void matcher_free(int);
 mixed *allocate(int, void | mixed);
 
 
@@ -195,12 +202,18 @@ int write_bytes(string, int, string);
 int file_size(string);
 string read_bytes(string, void | int, void | int);
 string read_file(string, void | int, void | int);
+int file_cursor_open(string);
+string file_cursor_read(int, int);
+int file_cursor_seek(int, int);
+int file_cursor_tell(int);
+void file_cursor_close(int);
 int cp(string, string);
 
 int link(string, string);
 int mkdir(string);
 int rm(string);
 int rmdir(string);
+void flush_valid_path_cache();
 
 /* the bit string functions */
 
@@ -220,6 +233,8 @@ string function_exists(string, void | object, void | int);
 object *objects(void | string | function);
 string query_host_name();
 int query_idle(object);
+int query_output_queued(object default:F__THIS_OBJECT);
+void set_output_watermarks(object, int, int, int);
 string query_ip_name(void | object);
 string query_ip_number(void | object);
 #ifndef NO_SNOOP
@@ -233,6 +248,7 @@ void set_hide(int);
 
 #ifndef NO_RESETS
 void set_reset(object, void | int);
+mapping reset_queue_status(object | void);
 #endif
 
 #ifndef NO_SHADOWS
@@ -286,8 +302,8 @@ object master();
 int memory_info(object | void);
 
 /* Runtime configs */
-mixed get_config(int);
-void set_config(int, mixed);
+mixed get_config(int | string);
+void set_config(int | string, mixed);
 
 #ifdef PRIVS
 /* privledge functions */
@@ -347,6 +363,7 @@ string origin();
 /* the infrequently used functions */
 
 int reclaim_objects();
+mapping reclaim_status();
 
 int set_eval_limit(int);
 int reset_eval_cost set_eval_limit(int default: 0);
@@ -160,6 +160,14 @@ void dumpstat(const char *tfn) {
 #endif
             /* ob->cpu */ 0);
   }
+
+  outbuffer_t out;
+  outbuf_zero(&out);
+  slab_status(&out, 1);
+  if (out.buffer) {
+    fprintf(f, "\n%s", out.buffer);
+    FREE_MSTR(out.buffer);
+  }
   fclose(f);
 }
 
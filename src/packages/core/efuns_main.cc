@@ -28,7 +28,9 @@
 #include "packages/core/dns.h"
 #include "packages/core/add_action.h"  // stat_living_objects
 #include "packages/core/file.h"
+#include "packages/core/file_cache.h"
 #include "packages/core/regexp.h"
+#include "packages/core/regexp_cache.h"
 #include "packages/core/sprintf.h"  // string_print_formatted
 #include "packages/core/outbuf.h"
 #include "packages/core/reclaim.h"
@@ -139,7 +141,7 @@ void f_bind(void) {
     error("Master object denied permission to bind() function pointer.\n");
   }
 
-  new_fp = reinterpret_cast<funptr_t *>(DMALLOC(sizeof(funptr_t), TAG_FUNP, "f_bind"));
+  new_fp = reinterpret_cast<funptr_t *>(SLAB_ALLOC(sizeof(funptr_t), TAG_FUNP, "f_bind"));
   *new_fp = *old_fp;
   new_fp->hdr.ref = 1;
   new_fp->hdr.owner = ob; /* one ref from being on stack */
@@ -168,6 +170,12 @@ static void print_cache_stats(outbuffer_t *ob) {
   outbuf_addv(ob, "cache hits:      %10lu\n", apply_cache_hits);
   outbuf_addv(ob, "cache size (bytes w/o overhead):  %10lu\n",
               apply_cache_items * sizeof(lookup_entry_s));
+  outbuf_add(ob, "\n");
+  print_file_cache_stats(ob);
+  outbuf_add(ob, "\n");
+  print_valid_path_cache_stats(ob);
+  outbuf_add(ob, "\n");
+  print_regexp_cache_stats(ob);
 }
 
 void f_cache_stats(void) {
@@ -1381,6 +1389,12 @@ void f_mud_status(void) {
     outbuf_addv(&ob, "Calls to add_message: %8" PRIu64 "   Packets: %8" PRIu64
                      "   Average packet size: %.2lf\n\n",
                 add_message_calls, inet_packets, static_cast<double>(inet_volume) / inet_packets);
+    outbuf_add(&ob, "Command scheduler statistics\n");
+    outbuf_add(&ob, "------------------------------\n");
+    outbuf_addv(&ob, "Commands: %8" PRIu64 "   Throttled: %8" PRIu64 "   Rounds cut short: %8" PRIu64
+                     "\nQueued users: %8zu   Most queued: %8" PRIu64 "\n\n",
+                user_commands, user_commands_throttled, command_slices_cut,
+                query_command_queue_depth(), command_queue_max_depth);
 
     stat_living_objects(&ob);
 
@@ -1395,6 +1409,9 @@ void f_mud_status(void) {
     tot += add_string_status(&ob, verbose);
     outbuf_add(&ob, "\n");
     tot += print_call_out_usage(&ob, verbose);
+    // Slab chunks hold blocks counted above, they don't add to the total.
+    outbuf_add(&ob, "\n");
+    slab_status(&ob, verbose);
   } else {
     /* !verbose */
     outbuf_addv(&ob, "Sentences:\t\t\t%8d %8d\n", tot_alloc_sentence,
@@ -1414,12 +1431,14 @@ void f_mud_status(void) {
     outbuf_addv(&ob, "Mappings:\t\t\t%8" PRIu64 " %8" PRIu64 "\n", num_mappings,
                 total_mapping_size);
     outbuf_addv(&ob, "Mappings(nodes):\t\t%8" PRIu64 "\n", total_mapping_nodes);
+    outbuf_addv(&ob, "Mappings(shared):\t\t%8" PRIu64 "\n", num_shared_mappings);
 
     outbuf_addv(&ob, "Interactives:\t\t\t%8d %8" PRIu64 "\n", users_num(true),
                 (uint64_t)(users_num(true)) * sizeof(interactive_t));
 
     tot = ObjectTable::instance().showStatus(&ob, verbose) + heart_beat_status(&ob, verbose) +
           add_string_status(&ob, verbose) + print_call_out_usage(&ob, verbose);
+    slab_status(&ob, verbose);
   }
 
   tot += total_prog_block_size + total_array_size + total_class_size + total_mapping_size +
@@ -1630,6 +1649,24 @@ void f_query_idle(void) {
 }
 #endif
 
+#ifdef F_QUERY_OUTPUT_QUEUED
+void f_query_output_queued(void) {
+  int i;
+
+  i = query_output_queued(sp->u.ob);
+  free_object(&sp->u.ob, "f_query_output_queued");
+  put_number(i);
+}
+#endif
+
+#ifdef F_SET_OUTPUT_WATERMARKS
+void f_set_output_watermarks(void) {
+  set_output_watermarks((sp - 3)->u.ob, (sp - 2)->u.number, (sp - 1)->u.number, sp->u.number);
+  sp -= 3;
+  free_object(&(sp--)->u.ob, "f_set_output_watermarks");
+}
+#endif
+
 #ifdef F_QUERY_IP_NAME
 void f_query_ip_name(void) {
   const char *tmp;
@@ -2388,9 +2425,19 @@ void f_set_hide(void) {
   }
   if ((sp--)->u.number) {
     num_hidden++;
+    if (!(current_object->flags & O_HIDDEN)) {
+#ifndef NO_ENVIRONMENT
+      add_deep_count(current_object->super, 0, 1);
+#endif
+    }
     current_object->flags |= O_HIDDEN;
   } else {
     num_hidden--;
+    if (current_object->flags & O_HIDDEN) {
+#ifndef NO_ENVIRONMENT
+      add_deep_count(current_object->super, 0, -1);
+#endif
+    }
     current_object->flags &= ~O_HIDDEN;
   }
 }
@@ -2584,7 +2631,7 @@ void f_stat(void) {
     *sp = const0;
     return;
   }
-  if (stat(path, &buf) != -1) {
+  if (file_cache_stat(path, &buf) != -1) {
     if (buf.st_mode & S_IFREG) { /* if a regular file */
       v = allocate_empty_array(3);
       v->item[0].type = T_NUMBER;
@@ -3207,6 +3254,10 @@ void f_dump_file_descriptors(void) {
 void f_reclaim_objects(void) { push_number(reclaim_objects(false)); }
 #endif
 
+#ifdef F_RECLAIM_STATUS
+void f_reclaim_status(void) { push_refed_mapping(reclaim_status()); }
+#endif
+
 #ifdef F_MEMORY_INFO
 void f_memory_info(void) {
   LPC_INT mem;
@@ -3267,17 +3318,31 @@ void f_set_reset(void) {
   if (st_num_arg == 2) {
     (sp - 1)->u.ob->next_reset =
         g_current_gametick + time_to_gametick(std::chrono::seconds(sp->u.number));
+    reset_queue_update((sp - 1)->u.ob);
     free_object(&(--sp)->u.ob, "f_set_reset:1");
     sp--;
   } else {
     sp->u.ob->next_reset =
         g_current_gametick + time_to_gametick(std::chrono::seconds(
                                  time_to_reset / 2 + random_number(time_to_reset / 2)));
+    reset_queue_update(sp->u.ob);
     free_object(&(sp--)->u.ob, "f_set_reset:2");
   }
 }
 #endif
 
+#ifdef F_RESET_QUEUE_STATUS
+void f_reset_queue_status(void) {
+  if (st_num_arg) {
+    auto m = reset_queue_status(sp->u.ob);
+    free_object(&(sp--)->u.ob, "f_reset_queue_status");
+    push_refed_mapping(m);
+  } else {
+    push_refed_mapping(reset_queue_status());
+  }
+}
+#endif
+
 #ifdef F_FLOATP
 void f_floatp(void) {
   if (sp->type == T_REAL) {
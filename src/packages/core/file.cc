@@ -5,6 +5,7 @@
 #include "base/package_api.h"
 
 #include "packages/core/file.h"
+#include "packages/core/file_cache.h"
 
 #include <iostream>
 #include <errno.h>
@@ -37,11 +38,13 @@
 #include <sys/mkdev.h>
 #endif
 #include <fcntl.h>
-#include <sstream>
 #include <unistd.h>
+#include <unordered_map>
 #include <zlib.h>
 
-#include "base/internal/strutils.h"
+#ifdef PACKAGE_UIDS
+#include "packages/uids/uids.h"
+#endif
 
 /*
  * Credits for some of the code below goes to Free Software Foundation
@@ -141,7 +144,7 @@ array_t *get_dir(const char *path, int flags) {
   array_t *v;
   int i, count = 0;
   DIR *dirp;
-  int namelen, do_match = 0;
+  int do_match = 0;
 
   struct dirent *de;
   struct stat st;
@@ -179,7 +182,7 @@ array_t *get_dir(const char *path, int flags) {
     }
   }
 
-  if (stat(temppath, &st) < 0) {
+  if (file_cache_stat(temppath, &st) < 0) {
     if (*p == '\0') {
       return 0;
     }
@@ -199,22 +202,34 @@ array_t *get_dir(const char *path, int flags) {
     encode_stat(&v->item[0], flags, p, &st);
     return v;
   }
-  if ((dirp = opendir(temppath)) == 0) {
-    return 0;
+
+  std::vector<std::string> names;
+  auto listing = file_cache_listdir(temppath);
+  if (listing == nullptr) {
+    if ((dirp = opendir(temppath)) == 0) {
+      return 0;
+    }
+    for (de = readdir(dirp); de; de = readdir(dirp)) {
+      names.push_back(de->d_name);
+    }
+    closedir(dirp);
+    listing = &names;
   }
+
   /*
-   * Count files
+   * Collect matching files, the listing may not survive the stat() calls
+   * below.
    */
-  for (de = readdir(dirp); de; de = readdir(dirp)) {
-    namelen = strlen(de->d_name);
-    if (!do_match && (strcmp(de->d_name, ".") == 0 || strcmp(de->d_name, "..") == 0)) {
+  std::vector<std::string> matched;
+  for (auto &name : *listing) {
+    if (!do_match && (name == "." || name == "..")) {
       continue;
     }
-    if (do_match && !match_string(regexppath, de->d_name)) {
+    if (do_match && !match_string(regexppath, const_cast<char *>(name.c_str()))) {
       continue;
     }
-    count++;
-    if (count >= max_array_size) {
+    matched.push_back(name);
+    if (matched.size() >= max_array_size) {
       break;
     }
   }
@@ -222,38 +237,27 @@ array_t *get_dir(const char *path, int flags) {
   /*
    * Make array and put files on it.
    */
+  count = matched.size();
   v = allocate_empty_array(count);
   if (count == 0) {
     /* This is the easy case :-) */
-    closedir(dirp);
     return v;
   }
-  rewinddir(dirp);
   endtemp = temppath + strlen(temppath);
 
   strcat(endtemp++, "/");
 
-  for (i = 0, de = readdir(dirp); i < count; de = readdir(dirp)) {
-    namelen = strlen(de->d_name);
-    if (!do_match && (strcmp(de->d_name, ".") == 0 || strcmp(de->d_name, "..") == 0)) {
-      continue;
-    }
-    if (do_match && !match_string(regexppath, de->d_name)) {
-      continue;
-    }
-    de->d_name[namelen] = '\0';
+  for (i = 0; i < count; i++) {
     if (flags == -1) {
       /*
        * We'll have to .... sigh.... stat() the file to get some add'tl
        * info.
        */
-      strcpy(endtemp, de->d_name);
-      stat(temppath, &st); /* We assume it works. */
+      strcpy(endtemp, matched[i].c_str());
+      file_cache_stat(temppath, &st); /* We assume it works. */
     }
-    encode_stat(&v->item[i], flags, de->d_name, &st);
-    i++;
+    encode_stat(&v->item[i], flags, const_cast<char *>(matched[i].c_str()), &st);
   }
-  closedir(dirp);
   /* Sort the names. */
   qsort((void *)v->item, count, sizeof v->item[0], (flags == -1) ? parrcmp : pstrcmp);
   return v;
@@ -309,6 +313,40 @@ int write_file(const char *file, const char *str, int flags) {
   return 1;
 }
 
+/* Copies "len" bytes of text into a new malloced string, dropping the '\r' of
+ * every "\r\n", and terminating the last line with '\n'.
+ */
+char *crlf_to_lf(const char *text, size_t len, const char *tag) {
+  const char *end = text + len;
+  auto is_cr_of_crlf = [end](const char *p) {
+    return *p == '\r' && (p + 1 == end || p[1] == '\n');
+  };
+
+  size_t result_len = 0;
+  for (const char *p = text; p < end; p++) {
+    if (!is_cr_of_crlf(p)) {
+      result_len++;
+    }
+  }
+  bool add_newline = len > 0 && end[-1] != '\n';
+  if (add_newline) {
+    result_len++;
+  }
+
+  char *result = new_string(result_len, tag);
+  char *out = result;
+  for (const char *p = text; p < end; p++) {
+    if (!is_cr_of_crlf(p)) {
+      *out++ = *p;
+    }
+  }
+  if (add_newline) {
+    *out++ = '\n';
+  }
+  *out = '\0';
+  return result;
+}
+
 /* Reads file, starting from line of "start", with maximum lines of "lines".
  * Returns a malloced_string.
  */
@@ -331,7 +369,7 @@ char *read_file(const char *file, int start, int lines) {
   /*
    * file doesn't exist, or is really a directory
    */
-  if (stat(real_file, &st) == -1 || (st.st_mode & S_IFDIR)) {
+  if (file_cache_stat(real_file, &st) == -1 || (st.st_mode & S_IFDIR)) {
     return 0;
   }
 
@@ -342,31 +380,42 @@ char *read_file(const char *file, int start, int lines) {
     return result;
   }
 
-  gzFile f = gzopen(real_file, "rb");
+  const char *buf;
+  int total_bytes_read;
 
-  if (f == nullptr) {
-    debug(file, "read_file: fail to open: %s.\n", file);
-    return 0;
-  }
+  // Compressed files are never served from cache, gzread() has to inflate them.
+  auto cached = file_cache_content(real_file);
+  if (cached && !(cached->size() >= 2 && (*cached)[0] == '\x1f' && (*cached)[1] == '\x8b')) {
+    buf = cached->data();
+    total_bytes_read = std::min(cached->size(), static_cast<size_t>(2 * read_file_max_size));
+  } else {
+    gzFile f = gzopen(real_file, "rb");
 
-  static char *theBuff = nullptr;
-  if (!theBuff) {
-    theBuff = reinterpret_cast<char *>(
-        DMALLOC(2 * read_file_max_size + 1, TAG_PERMANENT, "read_file: theBuff"));
-  }
+    if (f == nullptr) {
+      debug(file, "read_file: fail to open: %s.\n", file);
+      return 0;
+    }
 
-  int total_bytes_read = gzread(f, (void *)theBuff, 2 * read_file_max_size);
-  gzclose(f);
+    static char *theBuff = nullptr;
+    if (!theBuff) {
+      theBuff = reinterpret_cast<char *>(
+          DMALLOC(2 * read_file_max_size + 1, TAG_PERMANENT, "read_file: theBuff"));
+    }
+
+    total_bytes_read = gzread(f, (void *)theBuff, 2 * read_file_max_size);
+    gzclose(f);
+    buf = theBuff;
+  }
 
   if (total_bytes_read <= 0) {
     debug(file, "read_file: read error: %s.\n", file);
     return 0;
   }
-  theBuff[total_bytes_read] = '\0';
+  const char *buf_end = buf + total_bytes_read;
 
   // skip forward until the "start"-th line
-  char *ptr_start = theBuff;
-  while (start > 1 && ptr_start < theBuff + total_bytes_read) {
+  const char *ptr_start = buf;
+  while (start > 1 && ptr_start < buf_end) {
     if (*ptr_start == '\0') {
       debug(file, "read_file: file contains '\\0': %s.\n", file);
       return 0;
@@ -383,54 +432,53 @@ char *read_file(const char *file, int start, int lines) {
     return 0;
   }
 
-  char *ptr_end = nullptr;
+  const char *ptr_end = nullptr;
   // search forward for "lines" of '\n' for the end
   if (lines == 0) {
     ptr_end = ptr_start + read_file_max_size;
-    if (ptr_end > theBuff + total_bytes_read) {
-      ptr_end = theBuff + total_bytes_read + 1;
+    if (ptr_end > buf_end) {
+      ptr_end = buf_end;
     }
   } else {
     ptr_end = ptr_start;
-    while (lines > 0 && ptr_end < theBuff + total_bytes_read) {
+    while (lines > 0 && ptr_end < buf_end) {
       if (*ptr_end++ == '\n') {
         lines--;
       }
     }
     // not enough lines, directly go to the end.
     if (lines > 0) {
-      ptr_end = theBuff + total_bytes_read + 1;
+      ptr_end = buf_end;
     }
   }
 
-  *ptr_end = '\0';
+  // result stops at the first '\0'.
+  auto nul = reinterpret_cast<const char *>(memchr(ptr_start, '\0', ptr_end - ptr_start));
+  if (nul) {
+    ptr_end = nul;
+  }
+  size_t len = ptr_end - ptr_start;
   // result is too big.
-  if (strlen(ptr_start) > read_file_max_size) {
+  if (len > read_file_max_size) {
     debug(file, "read_file: result too big: %s.\n", file);
     return 0;
   }
 
-  bool found_crlf = strchr(ptr_start, '\r') != nullptr;
+  bool found_crlf = memchr(ptr_start, '\r', len) != nullptr;
   if (found_crlf) {
-    // Deal with CRLF.
-    std::istringstream input(ptr_start);
-    std::ostringstream output;
-    for (std::string line; std::getline(input, line);) {
-      if (ends_with(line, "\r")) {
-        line = line.substr(0, line.length() - 1);
-      }
-      output << line << std::endl;
-    }
-    return string_copy(output.str().c_str(), "read file: CRLF result");
+    return crlf_to_lf(ptr_start, len, "read file: CRLF result");
   }
-  return string_copy(ptr_start, "read_file: result");
+  char *result = new_string(len, "read_file: result");
+  memcpy(result, ptr_start, len);
+  result[len] = '\0';
+  return result;
 }
 
 char *read_bytes(const char *file, int start, int len, int *rlen) {
   const auto max_byte_transfer = CONFIG_INT(__MAX_BYTE_TRANSFER__);
 
   struct stat st;
-  FILE *fptr;
+  FILE *fptr = NULL;
   char *str;
   int size;
 
@@ -441,14 +489,19 @@ char *read_bytes(const char *file, int start, int len, int *rlen) {
   if (!file) {
     return 0;
   }
-  fptr = fopen(file, "rb");
-  if (fptr == NULL) {
-    return 0;
-  }
-  if (fstat(fileno(fptr), &st) == -1) {
-    fatal("Could not stat an open file.\n");
+  auto cached = file_cache_content(file);
+  if (cached) {
+    size = cached->size();
+  } else {
+    fptr = fopen(file, "rb");
+    if (fptr == NULL) {
+      return 0;
+    }
+    if (fstat(fileno(fptr), &st) == -1) {
+      fatal("Could not stat an open file.\n");
+    }
+    size = st.st_size;
   }
-  size = st.st_size;
   if (start < 0) {
     start = size + start;
   }
@@ -457,18 +510,33 @@ char *read_bytes(const char *file, int start, int len, int *rlen) {
     len = size;
   }
   if (len > max_byte_transfer) {
-    fclose(fptr);
+    if (fptr) {
+      fclose(fptr);
+    }
     error("Transfer exceeded maximum allowed number of bytes.\n");
     return 0;
   }
   if (start >= size) {
-    fclose(fptr);
+    if (fptr) {
+      fclose(fptr);
+    }
     return 0;
   }
   if ((start + len) > size) {
     len = (size - start);
   }
 
+  if (cached) {
+    if (start < 0 || len <= 0) {
+      return 0;
+    }
+    str = new_string(len, "read_bytes: str");
+    memcpy(str, cached->data() + start, len);
+    str[len] = '\0';
+    *rlen = len;
+    return str;
+  }
+
   if ((size = fseek(fptr, start, 0)) < 0) {
     fclose(fptr);
     return 0;
@@ -556,7 +624,7 @@ int file_size(const char *file) {
     return -1;
   }
 
-  if (stat(file, &st) == -1) {
+  if (file_cache_stat(file, &st) == -1) {
     ret = -1;
   } else if (S_IFDIR & st.st_mode) {
     ret = -2;
@@ -567,6 +635,83 @@ int file_size(const char *file) {
   return ret;
 }
 
+/*
+ * Cache of valid_read/valid_write decisions, turned on by the master through
+ * valid_path_cache_ttl().  Only plain allow/deny answers are remembered, keyed
+ * on the full path, the caller's euid (or name if it has none), the calling
+ * efun and read/write.
+ */
+namespace {
+struct valid_path_decision_t {
+  bool allowed;
+  long expire;
+};
+
+const size_t kMaxValidPathCacheSize = 65536;
+
+std::unordered_map<std::string, valid_path_decision_t> valid_path_cache;
+int valid_path_cache_ttl = 0;
+uint64_t valid_path_cache_lookups = 0;
+uint64_t valid_path_cache_hits = 0;
+
+std::string valid_path_cache_key(const char *path, object_t *call_object,
+                                 const char *const call_fun, int writeflg) {
+  std::string key(call_fun);
+  key += writeflg ? '\1' : '\0';
+#ifdef PACKAGE_UIDS
+  if (call_object->euid) {
+    key += call_object->euid->name;
+  } else
+#endif
+  {
+    key += '/';
+    key += call_object->obname;
+  }
+  key += '\0';
+  key += path;
+  return key;
+}
+
+void remember_valid_path(const std::string &key, bool allowed) {
+  auto now = get_current_time();
+  if (valid_path_cache.size() >= kMaxValidPathCacheSize) {
+    for (auto it = valid_path_cache.begin(); it != valid_path_cache.end();) {
+      if (it->second.expire <= now) {
+        it = valid_path_cache.erase(it);
+      } else {
+        ++it;
+      }
+    }
+    if (valid_path_cache.size() >= kMaxValidPathCacheSize) {
+      valid_path_cache.clear();
+    }
+  }
+  valid_path_cache[key] = {allowed, now + valid_path_cache_ttl};
+}
+}  // namespace
+
+void set_valid_path_cache_ttl(int ttl) {
+  valid_path_cache_ttl = ttl > 0 ? ttl : 0;
+  valid_path_cache.clear();
+}
+
+void flush_valid_path_cache() { valid_path_cache.clear(); }
+
+void print_valid_path_cache_stats(outbuffer_t *ob) {
+  outbuf_add(ob, "valid_read/valid_write cache information\n");
+  outbuf_add(ob, "-------------------------------\n");
+  if (!valid_path_cache_ttl) {
+    outbuf_add(ob, "disabled.\n");
+    return;
+  }
+  outbuf_addv(ob, "ttl (seconds):    %10d\n", valid_path_cache_ttl);
+  outbuf_addv(ob, "entries:          %10lu\n", valid_path_cache.size());
+  outbuf_addv(ob, "lookups:          %10" PRIu64 " (%% hits: %6.2f)\n", valid_path_cache_lookups,
+              valid_path_cache_lookups ? 100 * (static_cast<LPC_FLOAT>(valid_path_cache_hits) /
+                                                valid_path_cache_lookups)
+                                       : 0);
+}
+
 /*
  * Check that a path to a file is valid for read or write.
  * This is done by functions in the master object.
@@ -578,7 +723,7 @@ int file_size(const char *file) {
  */
 const char *check_valid_path(const char *path, object_t *call_object, const char *const call_fun,
                              int writeflg) {
-  svalue_t *v;
+  svalue_t *v = 0;
 
   if (!master_ob && !call_object) {
     // early startup, ignore security
@@ -593,21 +738,41 @@ const char *check_valid_path(const char *path, object_t *call_object, const char
     return 0;
   }
 
-  copy_and_push_string(path);
-  push_object(call_object);
-  push_constant_string(call_fun);
-  if (writeflg) {
-    v = apply_master_ob(APPLY_VALID_WRITE, 3);
-  } else {
-    v = apply_master_ob(APPLY_VALID_READ, 3);
+  std::string key;
+  bool cached = false;
+  if (valid_path_cache_ttl) {
+    key = valid_path_cache_key(path, call_object, call_fun, writeflg);
+    valid_path_cache_lookups++;
+    auto it = valid_path_cache.find(key);
+    if (it != valid_path_cache.end() && it->second.expire > get_current_time()) {
+      valid_path_cache_hits++;
+      if (!it->second.allowed) {
+        return 0;
+      }
+      cached = true;
+    }
   }
 
-  if (v == (svalue_t *)-1) {
-    v = 0;
-  }
+  if (!cached) {
+    copy_and_push_string(path);
+    push_object(call_object);
+    push_constant_string(call_fun);
+    if (writeflg) {
+      v = apply_master_ob(APPLY_VALID_WRITE, 3);
+    } else {
+      v = apply_master_ob(APPLY_VALID_READ, 3);
+    }
 
-  if (v && v->type == T_NUMBER && v->u.number == 0) {
-    return 0;
+    if (v == (svalue_t *)-1) {
+      v = 0;
+    }
+
+    if (v && v->type == T_NUMBER && valid_path_cache_ttl) {
+      remember_valid_path(key, v->u.number != 0);
+    }
+    if (v && v->type == T_NUMBER && v->u.number == 0) {
+      return 0;
+    }
   }
   if (v && v->type == T_STRING) {
     path = v->u.string;
@@ -1036,6 +1201,15 @@ void f_link(void) {
 }
 #endif /* F_LINK */
 
+#ifdef F_FLUSH_VALID_PATH_CACHE
+void f_flush_valid_path_cache(void) {
+  if (current_object != master_ob && current_object != simul_efun_ob) {
+    error("flush_valid_path_cache() may only be called by the master or simul_efun object.\n");
+  }
+  flush_valid_path_cache();
+}
+#endif
+
 #ifdef F_MKDIR
 void f_mkdir(void) {
   const char *path;
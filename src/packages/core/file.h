@@ -5,9 +5,13 @@
  */
 
 const char *check_valid_path(const char *, object_t *, const char *const, int);
+void set_valid_path_cache_ttl(int);
+void flush_valid_path_cache(void);
+void print_valid_path_cache_stats(outbuffer_t *);
 void dump_file_descriptors(outbuffer_t *);
 
 char *read_file(const char *, int, int);
+char *crlf_to_lf(const char *, size_t, const char *);
 char *read_bytes(const char *, int, int, int *);
 int write_file(const char *, const char *, int);
 int write_bytes(const char *, int, const char *, int);
@@ -18,6 +22,14 @@ int copy_file(const char *, const char *);
 int do_rename(const char *, const char *, int);
 int remove_file(const char *);
 
+/*
+ * file_cursor.cc
+ */
+void close_file_cursors(object_t *);
+#ifdef DEBUGMALLOC_EXTENSIONS
+void mark_file_cursors();
+#endif
+
 #ifdef DEBUGMALLOC_EXTENSIONS
 void mark_file_sv(void);
 #endif
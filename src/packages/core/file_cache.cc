@@ -0,0 +1,502 @@
+/*
+ * file_cache.cc
+ *
+ * Caches stat() results, directory listings and raw file content for the
+ * file efuns.  Every directory holding a cached path, and all of its parents,
+ * is watched with inotify.  Pending events are drained before each lookup, so
+ * changes made by the driver itself or by other processes are always seen
+ * before the next cached answer is handed out.
+ *
+ * The cache is off unless "file cache size" is set in the config file, and
+ * is always off on systems without inotify.
+ */
+
+#include "base/package_api.h"
+
+#include "packages/core/file_cache.h"
+
+#include <algorithm>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <iterator>
+#include <list>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <unordered_map>
+#ifdef HAVE_SYS_INOTIFY_H
+#include <sys/inotify.h>
+#endif
+
+namespace {
+
+struct file_cache_entry_t {
+  std::string path;
+
+  bool has_stat = false;
+  int stat_ret = 0;
+  int stat_errno = 0;
+  struct stat st;
+
+  bool has_content = false;
+  std::string content;
+
+  bool has_listing = false;
+  std::vector<std::string> listing;
+
+  // bytes accounted against "file cache size".
+  size_t charged = 0;
+};
+
+struct file_cache_stats_t {
+  uint64_t stat_lookups;
+  uint64_t stat_hits;
+  uint64_t content_lookups;
+  uint64_t content_hits;
+  uint64_t listing_lookups;
+  uint64_t listing_hits;
+  uint64_t invalidations;
+  uint64_t evictions;
+  uint64_t overflows;
+};
+
+file_cache_stats_t stats;
+
+// Most recently used entries are at the front.
+std::list<file_cache_entry_t> entries;
+std::unordered_map<std::string, std::list<file_cache_entry_t>::iterator> entry_index;
+size_t total_charged = 0;
+
+// -2: not initialized yet, -1: unavailable.
+int inotify_fd = -2;
+
+// A directory may be reachable through more than one name (symlinks), the
+// kernel hands out the same watch for all of them.
+std::unordered_map<int, std::vector<std::string>> watch_dirs;
+std::unordered_map<std::string, int> dir_watches;
+
+size_t cache_limit() { return CONFIG_INT(__RC_FILE_CACHE_SIZE__); }
+
+// Canonical form of a mudlib relative path: no leading, trailing or double
+// slashes, no "." components, "." for the root directory.
+std::string normalize(const char *path) {
+  std::string result;
+  const char *p = path;
+  while (*p) {
+    while (*p == '/') {
+      p++;
+    }
+    const char *end = p;
+    while (*end && *end != '/') {
+      end++;
+    }
+    if (end - p == 1 && *p == '.') {
+      p = end;
+      continue;
+    }
+    if (end != p) {
+      if (!result.empty()) {
+        result += '/';
+      }
+      result.append(p, end - p);
+    }
+    p = end;
+  }
+  if (result.empty()) {
+    result = ".";
+  }
+  return result;
+}
+
+std::string parent_dir(const std::string &path) {
+  auto pos = path.rfind('/');
+  if (pos == std::string::npos) {
+    return ".";
+  }
+  return path.substr(0, pos);
+}
+
+std::string join_path(const std::string &dir, const char *name) {
+  if (dir == ".") {
+    return name;
+  }
+  return dir + "/" + name;
+}
+
+bool in_tree(const std::string &path, const std::string &root) {
+  if (root == ".") {
+    return true;
+  }
+  return path.compare(0, root.size(), root) == 0 &&
+         (path.size() == root.size() || path[root.size()] == '/');
+}
+
+void erase_entry(std::list<file_cache_entry_t>::iterator it) {
+  total_charged -= it->charged;
+  entry_index.erase(it->path);
+  entries.erase(it);
+}
+
+void invalidate(const std::string &path) {
+  auto it = entry_index.find(path);
+  if (it != entry_index.end()) {
+    stats.invalidations++;
+    erase_entry(it->second);
+  }
+}
+
+void invalidate_tree(const std::string &root) {
+  for (auto it = entries.begin(); it != entries.end();) {
+    auto cur = it++;
+    if (in_tree(cur->path, root)) {
+      stats.invalidations++;
+      erase_entry(cur);
+    }
+  }
+}
+
+// Forget the watches registered under the names in this tree, the names no
+// longer refer to the watched directories.
+void forget_watches(const std::string &root) {
+#ifdef HAVE_SYS_INOTIFY_H
+  for (auto it = dir_watches.begin(); it != dir_watches.end();) {
+    if (!in_tree(it->first, root)) {
+      ++it;
+      continue;
+    }
+    auto pos = watch_dirs.find(it->second);
+    if (pos != watch_dirs.end()) {
+      auto &names = pos->second;
+      names.erase(std::remove(names.begin(), names.end(), it->first), names.end());
+      if (names.empty()) {
+        inotify_rm_watch(inotify_fd, pos->first);
+        watch_dirs.erase(pos);
+      }
+    }
+    it = dir_watches.erase(it);
+  }
+#endif
+}
+
+#ifdef HAVE_SYS_INOTIFY_H
+const uint32_t kWatchMask = IN_ATTRIB | IN_CLOSE_WRITE | IN_MODIFY | IN_CREATE | IN_DELETE |
+                            IN_DELETE_SELF | IN_MOVE_SELF | IN_MOVED_FROM | IN_MOVED_TO |
+                            IN_ONLYDIR;
+
+void handle_event(const struct inotify_event *event) {
+  if (event->mask & IN_Q_OVERFLOW) {
+    // Lost track of changes, start over.
+    stats.overflows++;
+    invalidate_tree(".");
+    return;
+  }
+
+  auto pos = watch_dirs.find(event->wd);
+  if (pos == watch_dirs.end()) {
+    return;
+  }
+  // copy, forget_watches() may modify the original.
+  auto names = pos->second;
+  for (auto &dir : names) {
+    if (event->mask & (IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED)) {
+      invalidate_tree(dir);
+      forget_watches(dir);
+      continue;
+    }
+    // Directory content changed, so did its listing and mtime.
+    if (event->len == 0 ||
+        (event->mask & (IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO))) {
+      invalidate(dir);
+    }
+    if (event->len > 0) {
+      auto child = join_path(dir, event->name);
+      if (event->mask & IN_ISDIR) {
+        invalidate_tree(child);
+        if (event->mask & (IN_MOVED_FROM | IN_DELETE)) {
+          forget_watches(child);
+        }
+      } else {
+        invalidate(child);
+      }
+    }
+  }
+}
+
+void drain_events() {
+  alignas(struct inotify_event) char buf[16 * 1024];
+  while (true) {
+    auto len = read(inotify_fd, buf, sizeof(buf));
+    if (len <= 0) {
+      break;
+    }
+    for (char *ptr = buf; ptr < buf + len;) {
+      auto event = reinterpret_cast<const struct inotify_event *>(ptr);
+      handle_event(event);
+      ptr += sizeof(struct inotify_event) + event->len;
+    }
+  }
+}
+#endif
+
+// Watch a directory and all its parents, so any change that can affect
+// a cached path below it is reported.
+bool watch_dir(const std::string &dir) {
+#ifdef HAVE_SYS_INOTIFY_H
+  if (dir_watches.find(dir) != dir_watches.end()) {
+    return true;
+  }
+  if (dir != "." && !watch_dir(parent_dir(dir))) {
+    return false;
+  }
+  auto wd = inotify_add_watch(inotify_fd, dir.c_str(), kWatchMask);
+  if (wd == -1) {
+    return false;
+  }
+  watch_dirs[wd].push_back(dir);
+  dir_watches[dir] = wd;
+  return true;
+#else
+  return false;
+#endif
+}
+
+// Checks whether the cache is in use, and brings it up to date.
+bool cache_enabled() {
+#ifdef HAVE_SYS_INOTIFY_H
+  if (cache_limit() == 0) {
+    return false;
+  }
+  if (inotify_fd == -2) {
+    inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotify_fd == -1) {
+      debug_message("file cache: inotify_init1 failed: %s, file cache disabled.\n",
+                    strerror(errno));
+    }
+  }
+  if (inotify_fd == -1) {
+    return false;
+  }
+  drain_events();
+  return true;
+#else
+  return false;
+#endif
+}
+
+file_cache_entry_t *find_entry(const std::string &path) {
+  auto it = entry_index.find(path);
+  if (it == entry_index.end()) {
+    return nullptr;
+  }
+  entries.splice(entries.begin(), entries, it->second);
+  return &*it->second;
+}
+
+file_cache_entry_t *find_or_add_entry(const std::string &path) {
+  auto entry = find_entry(path);
+  if (entry) {
+    return entry;
+  }
+  entries.emplace_front();
+  entries.front().path = path;
+  entry_index[path] = entries.begin();
+  return &entries.front();
+}
+
+// Recalculate memory used by the entry, then evict least recently used
+// entries until we are back under the limit.
+void charge_entry(file_cache_entry_t *entry) {
+  size_t charged = sizeof(file_cache_entry_t) + 2 * entry->path.size() + entry->content.capacity();
+  for (auto &name : entry->listing) {
+    charged += sizeof(std::string) + name.size();
+  }
+  total_charged = total_charged - entry->charged + charged;
+  entry->charged = charged;
+
+  while (total_charged > cache_limit() && &entries.back() != entry) {
+    stats.evictions++;
+    erase_entry(std::prev(entries.end()));
+  }
+}
+
+// Don't let a single file take over the cache.
+bool content_cacheable(int stat_ret, const struct stat &st) {
+  return stat_ret == 0 && S_ISREG(st.st_mode) && st.st_size <= cache_limit() / 4;
+}
+
+}  // namespace
+
+int file_cache_stat(const char *path, struct stat *st) {
+  if (!cache_enabled()) {
+    return stat(path, st);
+  }
+
+  stats.stat_lookups++;
+
+  auto key = normalize(path);
+  auto entry = find_entry(key);
+  if (entry && entry->has_stat) {
+    stats.stat_hits++;
+    *st = entry->st;
+    errno = entry->stat_errno;
+    return entry->stat_ret;
+  }
+
+  if (key != "." && !watch_dir(parent_dir(key))) {
+    return stat(path, st);
+  }
+  auto ret = stat(path, st);
+  auto saved_errno = ret == 0 ? 0 : errno;
+  if (ret == -1 && errno != ENOENT && errno != ENOTDIR) {
+    return ret;
+  }
+  // directory mtime changes with its content.
+  if (ret == 0 && S_ISDIR(st->st_mode) && !watch_dir(key)) {
+    return ret;
+  }
+
+  entry = find_or_add_entry(key);
+  entry->has_stat = true;
+  entry->stat_ret = ret;
+  entry->stat_errno = saved_errno;
+  entry->st = *st;
+  charge_entry(entry);
+
+  errno = saved_errno;
+  return ret;
+}
+
+const std::string *file_cache_content(const char *path) {
+  if (!cache_enabled()) {
+    return nullptr;
+  }
+
+  stats.content_lookups++;
+
+  auto key = normalize(path);
+  auto entry = find_entry(key);
+  if (entry && entry->has_content) {
+    stats.content_hits++;
+    return &entry->content;
+  }
+
+  if (entry && entry->has_stat && !content_cacheable(entry->stat_ret, entry->st)) {
+    return nullptr;
+  }
+
+  // Watch must be in place before reading, so that a concurrent
+  // modification is never missed.
+  if (!watch_dir(parent_dir(key))) {
+    return nullptr;
+  }
+
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd == -1) {
+    return nullptr;
+  }
+  struct stat st;
+  if (fstat(fd, &st) == -1) {
+    close(fd);
+    return nullptr;
+  }
+  if (!content_cacheable(0, st)) {
+    close(fd);
+    // Remember, so we don't have to open it again next time.
+    entry = find_or_add_entry(key);
+    entry->has_stat = true;
+    entry->stat_ret = 0;
+    entry->stat_errno = 0;
+    entry->st = st;
+    charge_entry(entry);
+    return nullptr;
+  }
+  std::string content(st.st_size, '\0');
+  size_t total = 0;
+  while (total < content.size()) {
+    auto len = read(fd, &content[total], content.size() - total);
+    if (len == -1 && errno == EINTR) {
+      continue;
+    }
+    if (len == -1) {
+      close(fd);
+      return nullptr;
+    }
+    if (len == 0) {
+      break;
+    }
+    total += len;
+  }
+  close(fd);
+  content.resize(total);
+
+  entry = find_or_add_entry(key);
+  entry->has_content = true;
+  entry->content.swap(content);
+  entry->has_stat = true;
+  entry->stat_ret = 0;
+  entry->stat_errno = 0;
+  entry->st = st;
+  charge_entry(entry);
+
+  return &entry->content;
+}
+
+const std::vector<std::string> *file_cache_listdir(const char *path) {
+  if (!cache_enabled()) {
+    return nullptr;
+  }
+
+  stats.listing_lookups++;
+
+  auto key = normalize(path);
+  auto entry = find_entry(key);
+  if (entry && entry->has_listing) {
+    stats.listing_hits++;
+    return &entry->listing;
+  }
+
+  if (!watch_dir(key)) {
+    return nullptr;
+  }
+  DIR *dirp = opendir(path);
+  if (dirp == nullptr) {
+    return nullptr;
+  }
+  std::vector<std::string> listing;
+  for (auto de = readdir(dirp); de; de = readdir(dirp)) {
+    listing.push_back(de->d_name);
+  }
+  closedir(dirp);
+
+  entry = find_or_add_entry(key);
+  entry->has_listing = true;
+  entry->listing.swap(listing);
+  charge_entry(entry);
+
+  return &entry->listing;
+}
+
+static LPC_FLOAT hit_rate(uint64_t hits, uint64_t lookups) {
+  return lookups ? 100 * (static_cast<LPC_FLOAT>(hits) / lookups) : 0;
+}
+
+void print_file_cache_stats(outbuffer_t *ob) {
+  outbuf_add(ob, "File cache information\n");
+  outbuf_add(ob, "-------------------------------\n");
+  if (!cache_enabled()) {
+    outbuf_add(ob, "disabled.\n");
+    return;
+  }
+  outbuf_addv(ob, "entries:          %10lu\n", entries.size());
+  outbuf_addv(ob, "watched dirs:     %10lu\n", dir_watches.size());
+  outbuf_addv(ob, "size (bytes):     %10lu / %lu\n", total_charged, cache_limit());
+  outbuf_addv(ob, "stat lookups:     %10" PRIu64 " (%% hits: %6.2f)\n", stats.stat_lookups,
+              hit_rate(stats.stat_hits, stats.stat_lookups));
+  outbuf_addv(ob, "content lookups:  %10" PRIu64 " (%% hits: %6.2f)\n", stats.content_lookups,
+              hit_rate(stats.content_hits, stats.content_lookups));
+  outbuf_addv(ob, "listing lookups:  %10" PRIu64 " (%% hits: %6.2f)\n", stats.listing_lookups,
+              hit_rate(stats.listing_hits, stats.listing_lookups));
+  outbuf_addv(ob, "invalidations:    %10" PRIu64 "\n", stats.invalidations);
+  outbuf_addv(ob, "evictions:        %10" PRIu64 "\n", stats.evictions);
+  outbuf_addv(ob, "event overflows:  %10" PRIu64 "\n", stats.overflows);
+}
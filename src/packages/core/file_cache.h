@@ -0,0 +1,32 @@
+/*
+ * file_cache.h
+ *
+ * Driver side cache of file metadata, directory listings and file content,
+ * used by the file efuns.  Enabled by "file cache size" in the runtime config,
+ * entries are invalidated through inotify.
+ */
+
+#ifndef PACKAGES_CORE_FILE_CACHE_H_
+#define PACKAGES_CORE_FILE_CACHE_H_
+
+#include <string>
+#include <vector>
+
+struct stat;
+
+// stat() through the cache, same return convention as stat().
+int file_cache_stat(const char *, struct stat *);
+
+// Raw content of a regular file, nullptr if cache is disabled or the file
+// can't be cached, caller should then read the file itself.
+// The returned pointer is only valid until the next file_cache_* call.
+const std::string *file_cache_content(const char *);
+
+// All names in a directory (including "." and ".."), nullptr if cache is
+// disabled or the directory can't be cached.
+// The returned pointer is only valid until the next file_cache_* call.
+const std::vector<std::string> *file_cache_listdir(const char *);
+
+void print_file_cache_stats(struct outbuffer_t *);
+
+#endif /* PACKAGES_CORE_FILE_CACHE_H_ */
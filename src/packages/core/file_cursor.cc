@@ -0,0 +1,227 @@
+/*
+ * file_cursor.cc
+ *
+ * Efuns to page through a file a few lines at a time.  A cursor keeps the
+ * file open, and remembers the offset of every kLineIndexInterval-th line it
+ * has passed, so going to a line only reads from the nearest remembered line
+ * instead of from the beginning of the file.
+ */
+
+#include "base/package_api.h"
+
+#include "packages/core/file.h"
+
+#include <algorithm>
+#include <string>
+#include <sys/stat.h>
+#include <vector>
+#include <zlib.h>
+
+namespace {
+
+const int kMaxFileCursors = 256;
+const int kLineIndexInterval = 256;
+
+struct file_cursor_t {
+  object_t *owner;
+  gzFile file;
+  // Line number of the next line to read, starting from 1.
+  int line;
+  // line_offsets[i] is the offset of line (i * kLineIndexInterval + 1).
+  std::vector<z_off_t> line_offsets;
+};
+
+file_cursor_t *file_cursors[kMaxFileCursors];
+int num_file_cursors;
+
+void close_cursor(int handle) {
+  auto cursor = file_cursors[handle];
+  gzclose(cursor->file);
+  free_object(&cursor->owner, "close_cursor");
+  delete cursor;
+  file_cursors[handle] = nullptr;
+  num_file_cursors--;
+}
+
+int find_free_cursor() {
+  for (int i = 0; i < kMaxFileCursors; i++) {
+    if (!file_cursors[i]) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+file_cursor_t *get_cursor(int handle) {
+  if (handle < 0 || handle >= kMaxFileCursors || !file_cursors[handle] ||
+      file_cursors[handle]->owner != current_object) {
+    error("Bad file cursor: %d.\n", handle);
+  }
+  return file_cursors[handle];
+}
+
+/* Read the next line, without its line ending, into "out" (if not null).
+ * Returns false at the end of file.
+ */
+bool next_line(file_cursor_t *cursor, std::string *out) {
+  auto line_index = cursor->line - 1;
+  if (line_index % kLineIndexInterval == 0 &&
+      cursor->line_offsets.size() == line_index / kLineIndexInterval) {
+    cursor->line_offsets.push_back(gztell(cursor->file));
+  }
+
+  char buf[4096];
+  bool found = false;
+  while (gzgets(cursor->file, buf, sizeof(buf))) {
+    found = true;
+    auto len = strlen(buf);
+    bool eol = len > 0 && buf[len - 1] == '\n';
+    if (out) {
+      out->append(buf, eol ? len - 1 : len);
+    }
+    if (eol) {
+      break;
+    }
+  }
+  if (!found) {
+    return false;
+  }
+  if (out && !out->empty() && out->back() == '\r') {
+    out->pop_back();
+  }
+  cursor->line++;
+  return true;
+}
+}  // namespace
+
+/* Called when ob is destructed, so its cursors don't keep it around. */
+void close_file_cursors(object_t *ob) {
+  for (int i = 0; num_file_cursors && i < kMaxFileCursors; i++) {
+    if (file_cursors[i] && file_cursors[i]->owner == ob) {
+      close_cursor(i);
+    }
+  }
+}
+
+#ifdef DEBUGMALLOC_EXTENSIONS
+void mark_file_cursors() {
+  for (int i = 0; i < kMaxFileCursors; i++) {
+    if (file_cursors[i]) {
+      file_cursors[i]->owner->extra_ref++;
+    }
+  }
+}
+#endif
+
+#ifdef F_FILE_CURSOR_OPEN
+void f_file_cursor_open(void) {
+  struct stat st;
+  int handle = -1;
+
+  auto path = check_valid_path(sp->u.string, current_object, "file_cursor_open", 0);
+  if (path && stat(path, &st) != -1 && !S_ISDIR(st.st_mode)) {
+    handle = find_free_cursor();
+    if (handle == -1) {
+      error("Too many open file cursors.\n");
+    }
+    gzFile f = gzopen(path, "rb");
+    if (f) {
+      auto cursor = new file_cursor_t;
+      cursor->owner = current_object;
+      add_ref(current_object, "file_cursor_open");
+      cursor->file = f;
+      cursor->line = 1;
+      file_cursors[handle] = cursor;
+      num_file_cursors++;
+    } else {
+      handle = -1;
+    }
+  }
+  free_string_svalue(sp);
+  put_number(handle);
+}
+#endif
+
+#ifdef F_FILE_CURSOR_READ
+void f_file_cursor_read(void) {
+  const auto read_file_max_size = CONFIG_INT(__MAX_READ_FILE_SIZE__);
+
+  auto lines = (sp--)->u.number;
+  auto cursor = get_cursor(sp->u.number);
+  if (lines < 0) {
+    error("Bad argument 2 to file_cursor_read(): negative number of lines.\n");
+  }
+
+  // Pick up anything appended since we last hit the end of file.
+  gzclearerr(cursor->file);
+
+  std::string result, line;
+  for (int i = 0; i < lines; i++) {
+    auto offset = gztell(cursor->file);
+    line.clear();
+    if (!next_line(cursor, &line)) {
+      break;
+    }
+    if (result.size() + line.size() + 1 > read_file_max_size) {
+      // Leave the line for the next read.
+      gzseek(cursor->file, offset, SEEK_SET);
+      cursor->line--;
+      if (i == 0) {
+        error("file_cursor_read(): line %d is longer than maximum read file size.\n",
+              cursor->line);
+      }
+      break;
+    }
+    result += line;
+    result += '\n';
+  }
+
+  if (result.empty()) {
+    put_number(0);
+  } else {
+    char *str = new_string(result.size(), "f_file_cursor_read");
+    memcpy(str, result.data(), result.size());
+    str[result.size()] = '\0';
+    put_malloced_string(str);
+  }
+}
+#endif
+
+#ifdef F_FILE_CURSOR_SEEK
+void f_file_cursor_seek(void) {
+  auto line = (sp--)->u.number;
+  auto cursor = get_cursor(sp->u.number);
+  if (line < 1) {
+    error("Bad argument 2 to file_cursor_seek(): lines start from 1.\n");
+  }
+
+  // Start from the closest remembered line, unless we are closer already.
+  int index = std::min((line - 1) / kLineIndexInterval,
+                       static_cast<LPC_INT>(cursor->line_offsets.size()) - 1);
+  int index_line = index * kLineIndexInterval + 1;
+  if (cursor->line > line || cursor->line < index_line) {
+    gzseek(cursor->file, cursor->line_offsets[index], SEEK_SET);
+    cursor->line = index_line;
+  }
+
+  gzclearerr(cursor->file);
+  while (cursor->line < line) {
+    if (!next_line(cursor, nullptr)) {
+      put_number(0);
+      return;
+    }
+  }
+  put_number(1);
+}
+#endif
+
+#ifdef F_FILE_CURSOR_TELL
+void f_file_cursor_tell(void) { put_number(get_cursor(sp->u.number)->line); }
+#endif
+
+#ifdef F_FILE_CURSOR_CLOSE
+void f_file_cursor_close(void) {
+  get_cursor(sp->u.number);
+  close_cursor((sp--)->u.number);
+}
+#endif
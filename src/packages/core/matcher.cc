@@ -0,0 +1,256 @@
+/*
+ * matcher.cc
+ *
+ * Efuns to test a string against many keywords and regular expressions in
+ * one pass.  All keywords are compiled into a single Aho-Corasick automaton,
+ * so scanning a string costs O(length + matches) no matter how many keywords
+ * there are.
+ *
+ * Regular expressions can't be merged that way with this engine, but most
+ * of them contain a literal that every match must include (see regliteral()).
+ * Those literals go into the automaton as well, and a regular expression is
+ * only run if its literal was seen.
+ */
+
+#include "base/package_api.h"
+
+#include "packages/core/matcher.h"
+#include "packages/core/regexp.h"
+
+#include <algorithm>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace {
+
+struct ac_node_t {
+  // Sorted by byte.
+  std::vector<std::pair<unsigned char, int>> next;
+  int fail = 0;
+  // Closest node on the fail chain (including this one) that ends a word,
+  // -1 if none.
+  int output = -1;
+  // Ids of the words ending here.
+  std::vector<int> words;
+};
+
+struct matcher_t {
+  object_t *owner;
+  int num_keywords;
+  std::vector<ac_node_t> nodes;
+  // Transitions from the root for every byte, the root is visited a lot.
+  int root_next[256];
+  std::vector<std::shared_ptr<regexp>> regexps;
+  // Regexps without a literal, run against every string.
+  std::vector<int> unfiltered;
+};
+
+std::unordered_map<LPC_INT, matcher_t *> matchers;
+LPC_INT next_matcher_handle = 1;
+
+int ac_child(const ac_node_t &node, unsigned char c) {
+  auto it = std::lower_bound(node.next.begin(), node.next.end(), std::make_pair(c, 0));
+  if (it != node.next.end() && it->first == c) {
+    return it->second;
+  }
+  return -1;
+}
+
+void ac_add(matcher_t *m, const char *word, size_t len, int id) {
+  int state = 0;
+  for (size_t i = 0; i < len; i++) {
+    auto c = static_cast<unsigned char>(word[i]);
+    auto next = ac_child(m->nodes[state], c);
+    if (next == -1) {
+      next = m->nodes.size();
+      auto &edges = m->nodes[state].next;
+      edges.insert(std::lower_bound(edges.begin(), edges.end(), std::make_pair(c, 0)),
+                   std::make_pair(c, next));
+      // may reallocate nodes, so no references across this.
+      m->nodes.emplace_back();
+    }
+    state = next;
+  }
+  m->nodes[state].words.push_back(id);
+}
+
+// Fill in fail and output links, breadth first so a node's fail target is
+// always done before the node itself.
+void ac_build(matcher_t *m) {
+  auto &nodes = m->nodes;
+  std::vector<int> queue;
+
+  std::fill(std::begin(m->root_next), std::end(m->root_next), 0);
+  for (auto &edge : nodes[0].next) {
+    m->root_next[edge.first] = edge.second;
+    nodes[edge.second].fail = 0;
+    queue.push_back(edge.second);
+  }
+
+  for (size_t i = 0; i < queue.size(); i++) {
+    auto state = queue[i];
+    auto &node = nodes[state];
+    node.output = node.words.empty() ? nodes[node.fail].output : state;
+    for (auto &edge : node.next) {
+      auto fail = node.fail;
+      int target;
+      while ((target = (fail ? ac_child(nodes[fail], edge.first) : m->root_next[edge.first])) ==
+                 -1) {
+        fail = nodes[fail].fail;
+      }
+      nodes[edge.second].fail = target;
+      queue.push_back(edge.second);
+    }
+  }
+}
+
+void free_matcher(LPC_INT handle) {
+  auto it = matchers.find(handle);
+  free_object(&it->second->owner, "free_matcher");
+  delete it->second;
+  matchers.erase(it);
+}
+
+matcher_t *get_matcher(LPC_INT handle) {
+  auto it = matchers.find(handle);
+  if (it == matchers.end() || it->second->owner != current_object) {
+    error("Bad matcher: %" LPC_INT_FMTSTR_P ".\n", handle);
+  }
+  return it->second;
+}
+}  // namespace
+
+/* Called when ob is destructed, so its matchers don't keep it around. */
+void free_matchers(object_t *ob) {
+  if (matchers.empty()) {
+    return;
+  }
+  std::vector<LPC_INT> owned;
+  for (auto &pair : matchers) {
+    if (pair.second->owner == ob) {
+      owned.push_back(pair.first);
+    }
+  }
+  for (auto handle : owned) {
+    free_matcher(handle);
+  }
+}
+
+#ifdef DEBUGMALLOC_EXTENSIONS
+void mark_matchers() {
+  for (auto &pair : matchers) {
+    pair.second->owner->extra_ref++;
+  }
+}
+#endif
+
+#ifdef F_MATCHER_COMPILE
+void f_matcher_compile(void) {
+  auto keywords = (sp - st_num_arg + 1)->u.arr;
+  auto patterns = st_num_arg == 2 ? sp->u.arr : nullptr;
+
+  for (int i = 0; i < keywords->size; i++) {
+    if (keywords->item[i].type != T_STRING || !SVALUE_STRLEN(&keywords->item[i])) {
+      error("Bad argument 1 to matcher_compile(): keywords must be non-empty strings.\n");
+    }
+  }
+
+  auto m = new matcher_t;
+  m->num_keywords = keywords->size;
+  m->nodes.emplace_back();
+  for (int i = 0; i < keywords->size; i++) {
+    auto sv = &keywords->item[i];
+    ac_add(m, sv->u.string, SVALUE_STRLEN(sv), i);
+  }
+
+  if (patterns) {
+    regexp_user = EFUN_REGEXP;
+    for (int i = 0; i < patterns->size; i++) {
+      std::shared_ptr<regexp> reg;
+      if (patterns->item[i].type != T_STRING) {
+        delete m;
+        error("Bad argument 2 to matcher_compile(): patterns must be strings.\n");
+      }
+      if (!(reg = efun_regcomp(patterns->item[i].u.string))) {
+        delete m;
+        error(regexp_error);
+      }
+      int len;
+      auto literal = regliteral(reg.get(), &len);
+      if (literal) {
+        ac_add(m, literal, len, m->num_keywords + i);
+      } else {
+        m->unfiltered.push_back(i);
+      }
+      m->regexps.push_back(reg);
+    }
+  }
+  ac_build(m);
+
+  m->owner = current_object;
+  add_ref(current_object, "matcher_compile");
+  matchers[next_matcher_handle] = m;
+
+  pop_n_elems(st_num_arg);
+  push_number(next_matcher_handle++);
+}
+#endif
+
+#ifdef F_MATCHER_MATCH
+void f_matcher_match(void) {
+  auto str = sp->u.string;
+  auto len = SVALUE_STRLEN(sp);
+  auto m = get_matcher((sp - 1)->u.number);
+  auto num_regexps = m->regexps.size();
+
+  // hit[i] for keyword i, or the literal of regexp i - num_keywords.
+  std::vector<char> hit(m->num_keywords + num_regexps);
+  int state = 0;
+  for (size_t i = 0; i < len; i++) {
+    auto c = static_cast<unsigned char>(str[i]);
+    int next = 0;
+    while (state && (next = ac_child(m->nodes[state], c)) == -1) {
+      state = m->nodes[state].fail;
+    }
+    state = state ? next : m->root_next[c];
+    for (auto out = m->nodes[state].output; out != -1;
+         out = m->nodes[m->nodes[out].fail].output) {
+      for (auto id : m->nodes[out].words) {
+        hit[id] = 1;
+      }
+    }
+  }
+
+  // Confirm regexps whose literal was found, and run the ones without one.
+  regexp_user = EFUN_REGEXP;
+  for (auto i : m->unfiltered) {
+    hit[m->num_keywords + i] = 1;
+  }
+  for (size_t i = 0; i < num_regexps; i++) {
+    if (hit[m->num_keywords + i]) {
+      hit[m->num_keywords + i] = regexec(m->regexps[i].get(), str);
+    }
+  }
+
+  auto ret = allocate_empty_array(std::count(hit.begin(), hit.end(), 1));
+  int n = 0;
+  for (size_t i = 0; i < hit.size(); i++) {
+    if (hit[i]) {
+      ret->item[n].type = T_NUMBER;
+      ret->item[n].subtype = 0;
+      ret->item[n++].u.number = i;
+    }
+  }
+
+  free_string_svalue(sp--);
+  put_array(ret);
+}
+#endif
+
+#ifdef F_MATCHER_FREE
+void f_matcher_free(void) {
+  get_matcher(sp->u.number);
+  free_matcher((sp--)->u.number);
+}
+#endif
@@ -0,0 +1,12 @@
+#ifndef PACKAGES_CORE_MATCHER_H_
+#define PACKAGES_CORE_MATCHER_H_
+
+/*
+ * matcher.cc
+ */
+void free_matchers(object_t *);
+#ifdef DEBUGMALLOC_EXTENSIONS
+void mark_matchers();
+#endif
+
+#endif
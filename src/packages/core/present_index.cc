@@ -0,0 +1,258 @@
+/*
+ * present_index.cc
+ *
+ * present("sword", room) used to call id() in every object of the room
+ * until one agreed.  Objects that call set_present_ids() instead answer
+ * from the list they registered, and every container holding such objects
+ * keeps them indexed by id.  As long as every object in a container
+ * registered its ids, present() is a single lookup; otherwise it still
+ * walks the inventory, asking id() only in the objects that registered
+ * nothing.
+ *
+ * Objects are numbered as they enter a container, which gives the order
+ * of env->contains (newest first) for "sword 2".
+ */
+
+#include "base/package_api.h"
+
+#include "packages/core/present_index.h"
+
+#ifndef NO_ENVIRONMENT
+
+#include <algorithm>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+struct ids_t {
+  std::vector<const char *> ids; /* shared strings, each one referenced */
+  uint64_t seq;                  /* when it entered its environment */
+};
+
+struct room_t {
+  /* keyed by the shared string, so the pointer will do */
+  std::unordered_map<const char *, std::vector<object_t *>> by_id;
+  int indexed;   /* objects in here that registered ids */
+  int unindexed; /* and the ones that didn't */
+};
+
+std::unordered_map<object_t *, ids_t> registered;
+std::unordered_map<object_t *, room_t> rooms;
+uint64_t next_seq;
+
+void add_to_room(room_t *room, object_t *item) {
+  auto &ids = registered[item];
+  ids.seq = ++next_seq;
+  room->indexed++;
+  for (auto id : ids.ids) {
+    room->by_id[id].push_back(item);
+  }
+}
+
+void remove_from_room(room_t *room, object_t *item) {
+  room->indexed--;
+  for (auto id : registered[item].ids) {
+    auto it = room->by_id.find(id);
+    auto &obs = it->second;
+    obs.erase(std::find(obs.begin(), obs.end(), item));
+    if (obs.empty()) {
+      room->by_id.erase(it);
+    }
+  }
+}
+
+// Index env from scratch, numbering its inventory oldest first.
+void rebuild(object_t *env) {
+  std::vector<object_t *> inv;
+  room_t room{};
+
+  rooms.erase(env);
+  for (auto ob = env->contains; ob; ob = ob->next_inv) {
+    inv.push_back(ob);
+  }
+  for (auto it = inv.rbegin(); it != inv.rend(); ++it) {
+    if ((*it)->flags & O_PRESENT_IDS) {
+      add_to_room(&room, *it);
+    } else {
+      room.unindexed++;
+    }
+  }
+  if (room.indexed) {
+    rooms.emplace(env, std::move(room));
+  }
+}
+
+void unregister(object_t *ob) {
+  if (!(ob->flags & O_PRESENT_IDS)) {
+    return;
+  }
+  for (auto id : registered[ob].ids) {
+    free_string(id);
+  }
+  registered.erase(ob);
+  ob->flags &= ~O_PRESENT_IDS;
+}
+}  // namespace
+
+void present_index_enter(object_t *item, object_t *dest) {
+  if (rooms.empty() && !(item->flags & O_PRESENT_IDS)) {
+    return;
+  }
+  auto it = rooms.find(dest);
+  if (it == rooms.end()) {
+    if (item->flags & O_PRESENT_IDS) {
+      rebuild(dest);
+    }
+    return;
+  }
+  if (item->flags & O_PRESENT_IDS) {
+    add_to_room(&it->second, item);
+  } else {
+    it->second.unindexed++;
+  }
+}
+
+void present_index_leave(object_t *item, object_t *from) {
+  if (rooms.empty()) {
+    return;
+  }
+  auto it = rooms.find(from);
+  if (it == rooms.end()) {
+    return;
+  }
+  if (item->flags & O_PRESENT_IDS) {
+    remove_from_room(&it->second, item);
+    if (!it->second.indexed) {
+      rooms.erase(it);
+    }
+  } else {
+    it->second.unindexed--;
+  }
+}
+
+void present_index_forget(object_t *ob) {
+  rooms.erase(ob);
+  unregister(ob);
+}
+
+int present_index_id(object_t *ob, const char *name) {
+  if (!(ob->flags & O_PRESENT_IDS)) {
+    return -1;
+  }
+  auto id = findstring(name);
+  if (!id) {
+    return 0;
+  }
+  auto &ids = registered[ob].ids;
+  return std::find(ids.begin(), ids.end(), id) != ids.end();
+}
+
+object_t *present_index_lookup(object_t *env, const char *name, int count, bool *complete) {
+  *complete = false;
+  auto room = rooms.find(env);
+  if (room == rooms.end() || room->second.unindexed) {
+    return nullptr;
+  }
+  *complete = true;
+  auto id = findstring(name);
+  if (!id) {
+    return nullptr;
+  }
+  auto found = room->second.by_id.find(id);
+  if (found == room->second.by_id.end()) {
+    return nullptr;
+  }
+  auto &obs = found->second;
+  auto newer = [](object_t *a, object_t *b) { return registered[a].seq > registered[b].seq; };
+  if (count <= 1) {
+    return *std::min_element(obs.begin(), obs.end(), newer);
+  }
+  if (static_cast<size_t>(count) > obs.size()) {
+    return nullptr;
+  }
+  std::vector<object_t *> sorted(obs);
+  std::nth_element(sorted.begin(), sorted.begin() + count - 1, sorted.end(), newer);
+  return sorted[count - 1];
+}
+
+#ifdef DEBUGMALLOC_EXTENSIONS
+void mark_present_ids() {
+  for (auto &entry : registered) {
+    for (auto id : entry.second.ids) {
+      EXTRA_REF(BLOCK(id))++;
+    }
+  }
+}
+#endif
+
+#ifdef F_SET_PRESENT_IDS
+void f_set_present_ids(void) {
+  auto ob = current_object;
+  auto env = ob->super;
+  array_t *arr = sp->type == T_ARRAY ? sp->u.arr : nullptr;
+
+  if (arr) {
+    for (int i = 0; i < arr->size; i++) {
+      if (arr->item[i].type != T_STRING) {
+        error("Bad argument 1 to set_present_ids(), ids must be strings\n");
+      }
+    }
+  } else if (sp->u.number) {
+    error("Bad argument 1 to set_present_ids()\n");
+  }
+  if (ob->flags & O_DESTRUCTED) {
+    pop_stack();
+    return;
+  }
+
+  if (env) {
+    present_index_leave(ob, env);
+  }
+  unregister(ob);
+  if (arr) {
+    auto &ids = registered[ob].ids;
+    for (int i = 0; i < arr->size; i++) {
+      auto id = make_shared_string(arr->item[i].u.string);
+      if (std::find(ids.begin(), ids.end(), id) != ids.end()) {
+        free_string(id);
+      } else {
+        ids.push_back(id);
+      }
+    }
+    ob->flags |= O_PRESENT_IDS;
+  }
+  if (env) {
+    if (ob->flags & O_PRESENT_IDS) {
+      rebuild(env);
+    } else {
+      present_index_enter(ob, env);
+    }
+  }
+  pop_stack();
+}
+#endif
+
+#ifdef F_QUERY_PRESENT_IDS
+void f_query_present_ids(void) {
+  auto ob = sp->u.ob;
+  array_t *arr = nullptr;
+
+  if (ob->flags & O_PRESENT_IDS) {
+    auto &ids = registered[ob].ids;
+    arr = allocate_empty_array(ids.size());
+    for (size_t i = 0; i < ids.size(); i++) {
+      arr->item[i].type = T_STRING;
+      arr->item[i].subtype = STRING_SHARED;
+      arr->item[i].u.string = ref_string(ids[i]);
+    }
+  }
+  free_object(&sp->u.ob, "f_query_present_ids");
+  if (arr) {
+    put_array(arr);
+  } else {
+    *sp = const0;
+  }
+}
+#endif
+
+#endif /* ! NO_ENVIRONMENT */
@@ -0,0 +1,34 @@
+/*
+ * present_index.h
+ *
+ * Ids that objects registered with set_present_ids(), indexed per
+ * container, so present() can find them without calling id() in each
+ * object of the inventory.
+ */
+
+#ifndef PACKAGES_CORE_PRESENT_INDEX_H_
+#define PACKAGES_CORE_PRESENT_INDEX_H_
+
+#ifndef NO_ENVIRONMENT
+// Keep the index of a container in step with its inventory.
+void present_index_enter(struct object_t *item, struct object_t *dest);
+void present_index_leave(struct object_t *item, struct object_t *from);
+// ob is being destructed, drop its ids and the index of its inventory.
+void present_index_forget(struct object_t *ob);
+
+// 1 if ob registered name as one of its ids, 0 if it registered other ids,
+// -1 if it registered none and id() has to be asked.
+int present_index_id(struct object_t *ob, const char *name);
+
+// The count-th object in env->contains that registered name, or nullptr.
+// *complete is set when every object in there registered its ids, so the
+// answer stands without asking id() in any of them.
+struct object_t *present_index_lookup(struct object_t *env, const char *name, int count,
+                                      bool *complete);
+
+#ifdef DEBUGMALLOC_EXTENSIONS
+void mark_present_ids();
+#endif
+#endif
+
+#endif /* PACKAGES_CORE_PRESENT_INDEX_H_ */
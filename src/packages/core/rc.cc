@@ -25,6 +25,11 @@ int get_config_item(svalue_t *res, svalue_t *arg) {
 
 #ifdef F_GET_CONFIG
 void f_get_config(void) {
+  if (sp->type == T_STRING) {
+    auto num = config_int_index(sp->u.string);
+    free_string_svalue(sp);
+    put_number(num);
+  }
   if (!get_config_item(sp, sp)) {
     error("Bad argument to get_config()\n");
   }
@@ -33,6 +38,13 @@ void f_get_config(void) {
 
 #ifdef F_SET_CONFIG
 void f_set_config() {
+  if ((sp - 1)->type == T_STRING) {
+    auto num = config_int_index((sp - 1)->u.string);
+    free_string_svalue(sp - 1);
+    (sp - 1)->type = T_NUMBER;
+    (sp - 1)->subtype = 0;
+    (sp - 1)->u.number = num;
+  }
   auto num = (sp - 1)->u.number;
   auto value = sp;
 
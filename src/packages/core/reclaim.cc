@@ -9,6 +9,7 @@
 
 #include "packages/core/reclaim.h"
 
+#include <chrono>
 #include <functional>
 
 #include "packages/core/call_out.h"
@@ -25,6 +26,7 @@ static void check_svalue(svalue_t *v) {
 
   nested++;
   if (nested > MAX_RECURSION) {
+    nested--;
     return;
   }
   switch (v->type) {
@@ -86,6 +88,12 @@ static void gc_mapping(mapping_t *m) {
     while ((elt = *prev)) {
       if (elt->values[0].type == T_OBJECT) {
         if (elt->values[0].u.ob->flags & O_DESTRUCTED) {
+          if (m->share_next) {
+            /* the copies sharing the table keep their own key */
+            unshare_mapping(m);
+            gc_mapping(m);
+            return;
+          }
           free_object(&elt->values[0].u.ob, "gc_mapping");
           elt->values[0].u.ob = 0;
           /* found one, do a map_delete() */
@@ -109,24 +117,144 @@ static void gc_mapping(mapping_t *m) {
   } while (j--);
 }
 
+namespace {
+struct reclaim_stats_t {
+  uint64_t passes;
+  uint64_t skipped;
+  uint64_t cleaned;
+  // The pass in progress, or the last one.
+  uint64_t pass_objects;
+  uint64_t pass_cleaned;
+  uint64_t pass_slices;
+  uint64_t pass_usec;
+  uint64_t pass_max_slice_usec;
+} reclaim_stats;
+
+// Next object the incremental pass looks at, 0 when there is no pass going.
+object_t *cursor;
+bool in_pass;
+
+void schedule_next_pass() {
+  add_gametick_event(std::chrono::seconds(30 + random_number(30)),
+                     tick_event::callback_type(std::bind(reclaim_objects, true)));
+}
+
+void scan_object(object_t *ob) {
+  if (ob->prog) {
+    for (int i = 0; i < ob->prog->num_variables_total; i++) {
+      check_svalue(&ob->variables[i]);
+    }
+  }
+  reclaim_stats.pass_objects++;
+}
+
+void start_pass() {
+  reclaim_stats.pass_objects = 0;
+  reclaim_stats.pass_cleaned = 0;
+  reclaim_stats.pass_slices = 0;
+  reclaim_stats.pass_usec = 0;
+  reclaim_stats.pass_max_slice_usec = 0;
+}
+
+void end_slice(std::chrono::steady_clock::time_point start) {
+  auto usec =
+      std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start)
+          .count();
+  reclaim_stats.pass_cleaned += cleaned;
+  reclaim_stats.cleaned += cleaned;
+  reclaim_stats.pass_slices++;
+  reclaim_stats.pass_usec += usec;
+  if (usec > reclaim_stats.pass_max_slice_usec) {
+    reclaim_stats.pass_max_slice_usec = usec;
+  }
+}
+
+/*
+ * One gametick's share of an incremental pass: carry on from the cursor
+ * until "reclaim budget msec" is used up.  Once no destructed object is
+ * left there is nothing more to find, so the pass ends early.
+ */
+void reclaim_slice() {
+  auto budget = std::chrono::milliseconds(CONFIG_INT(__RC_RECLAIM_BUDGET_MSEC__));
+  auto start = std::chrono::steady_clock::now();
+
+  cleaned = nested = 0;
+  while (cursor && tot_destructed_object) {
+    auto ob = cursor;
+    cursor = ob->next_all;
+    scan_object(ob);
+    if (std::chrono::steady_clock::now() - start >= budget) {
+      break;
+    }
+  }
+  end_slice(start);
+
+  if (cursor && tot_destructed_object) {
+    add_gametick_event(gametick_to_time(1), tick_event::callback_type(reclaim_slice));
+    return;
+  }
+  cursor = nullptr;
+  in_pass = false;
+  reclaim_stats.passes++;
+  schedule_next_pass();
+}
+}  // namespace
+
 int reclaim_objects(bool is_auto) {
   if (is_auto) {
-    add_gametick_event(std::chrono::seconds(30 + random_number(30)),
-                       tick_event::callback_type(std::bind(reclaim_objects, true)));
+    // Without destructed objects around there is nothing to reclaim.
+    if (!tot_destructed_object) {
+      reclaim_stats.skipped++;
+      schedule_next_pass();
+      return 0;
+    }
+    if (CONFIG_INT(__RC_RECLAIM_BUDGET_MSEC__) > 0) {
+      reclaim_call_outs();
+      start_pass();
+      in_pass = true;
+      cursor = obj_list;
+      reclaim_slice();
+      return 0;
+    }
+    schedule_next_pass();
   }
-  int i;
   object_t *ob;
 
   reclaim_call_outs();
 
+  auto start = std::chrono::steady_clock::now();
+  if (!in_pass) {
+    start_pass();
+  }
   cleaned = nested = 0;
   for (ob = obj_list; ob; ob = ob->next_all) {
-    if (ob->prog) {
-      for (i = 0; i < ob->prog->num_variables_total; i++) {
-        check_svalue(&ob->variables[i]);
-      }
-    }
+    scan_object(ob);
+  }
+  end_slice(start);
+  if (!in_pass) {
+    reclaim_stats.passes++;
   }
 
   return cleaned;
 }
+
+void reclaim_object_removed(object_t *ob) {
+  if (ob == cursor) {
+    cursor = ob->next_all;
+  }
+}
+
+mapping_t *reclaim_status() {
+  auto m = allocate_mapping(10);
+  add_mapping_pair(m, "passes", reclaim_stats.passes);
+  add_mapping_pair(m, "skipped passes", reclaim_stats.skipped);
+  add_mapping_pair(m, "cleaned", reclaim_stats.cleaned);
+  add_mapping_pair(m, "destructed", tot_destructed_object);
+  add_mapping_pair(m, "in progress", in_pass);
+  add_mapping_pair(m, "pass objects", reclaim_stats.pass_objects);
+  add_mapping_pair(m, "pass cleaned", reclaim_stats.pass_cleaned);
+  add_mapping_pair(m, "pass slices", reclaim_stats.pass_slices);
+  add_mapping_pair(m, "pass usec", reclaim_stats.pass_usec);
+  add_mapping_pair(m, "pass max slice usec", reclaim_stats.pass_max_slice_usec);
+  return m;
+}
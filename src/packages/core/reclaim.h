@@ -5,5 +5,10 @@
  * reclaim.c
  */
 int reclaim_objects(bool);
+// Called before an object leaves obj_list, so an incremental pass can step
+// past it.
+void reclaim_object_removed(struct object_t *);
+// Mapping for the reclaim_status() efun.
+struct mapping_t *reclaim_status();
 
 #endif
@@ -55,7 +55,10 @@
 
 #include "base/package_api.h"
 
+#include <vector>
+
 #include "packages/core/regexp.h"
+#include "packages/core/regexp_cache.h"
 
 #include "packages/core/ed.h"
 
@@ -1407,18 +1410,56 @@ char *regsub(regexp *prog, char *source, char *dest, int n) {
   return dst;
 }
 
-int match_single_regexp(const char *str, const char *pattern) {
-  struct regexp *reg;
-  int ret;
+/*
+ - regliteral - longest literal string any match of prog must contain
+ *
+ * Like regmust, but computed for every r.e. with a single top-level
+ * alternative instead of only the expensive ones.  Returns NULL if there is
+ * no such string.
+ */
+const char *regliteral(regexp *prog, int *len) {
+  auto scan = prog->program + 1; /* First BRANCH. */
+  const char *longest = nullptr;
+
+  *len = 0;
+  if (OP(regnext(scan)) != END) {
+    return nullptr;
+  }
+  for (scan = OPERAND(scan); scan != nullptr; scan = regnext(scan)) {
+    int tlen;
+    if (OP(scan) == EXACTLY && (tlen = strlen(OPERAND(scan))) > *len) {
+      longest = OPERAND(scan);
+      *len = tlen;
+    }
+  }
+  return longest;
+}
+
+/*
+ * Compile a pattern for the efuns, going through the regexp cache.
+ * Returns nullptr and sets regexp_error if the pattern is bad.
+ */
+std::shared_ptr<regexp> efun_regcomp(const char *pattern) {
+  auto cached = regexp_cache_find(REGEXP_CACHE_V8, pattern);
+  if (cached) {
+    return std::static_pointer_cast<regexp>(cached);
+  }
+  auto reg = regcomp((unsigned char *)pattern, 0);
+  if (!reg) {
+    return nullptr;
+  }
+  std::shared_ptr<regexp> result(reg, [](regexp *r) { FREE(r); });
+  regexp_cache_add(REGEXP_CACHE_V8, pattern, result, sizeof(regexp) + regsize);
+  return result;
+}
 
+int match_single_regexp(const char *str, const char *pattern) {
   regexp_user = EFUN_REGEXP;
-  reg = regcomp((unsigned char *)pattern, 0);
+  auto reg = efun_regcomp(pattern);
   if (!reg) {
     error(regexp_error);
   }
-  ret = regexec(reg, str);
-  FREE(reg);
-  return ret;
+  return regexec(reg.get(), str);
 }
 
 #ifdef F_REG_ASSOC
@@ -1452,7 +1493,7 @@ array_t *reg_assoc(svalue_t *str, array_t *pat, array_t *tok, svalue_t *def) {
   ret = allocate_empty_array(2);
 
   if (size) {
-    struct regexp **rgpp;
+    std::vector<std::shared_ptr<regexp>> rgpp(size);
     struct reg_match {
       int tok_i;
       const char *begin, *end;
@@ -1464,14 +1505,8 @@ array_t *reg_assoc(svalue_t *str, array_t *pat, array_t *tok, svalue_t *def) {
     struct regexp *tmpreg;
     const char *laststart, *currstart;
 
-    rgpp = reinterpret_cast<struct regexp **>(
-        DCALLOC(size, sizeof(struct regexp *), TAG_TEMPORARY, "reg_assoc : rgpp"));
     for (i = 0; i < size; i++) {
-      if (!(rgpp[i] = regcomp((unsigned char *)pat->item[i].u.string, 0))) {
-        while (i--) {
-          FREE((char *)rgpp[i]);
-        }
-        FREE((char *)rgpp);
+      if (!(rgpp[i] = efun_regcomp(pat->item[i].u.string))) {
         free_empty_array(ret);
         error(regexp_error);
       }
@@ -1487,7 +1522,7 @@ array_t *reg_assoc(svalue_t *str, array_t *pat, array_t *tok, svalue_t *def) {
       regindex = -1;
 
       for (i = 0; i < size; i++) {
-        if (regexec(tmpreg = rgpp[i], tmp)) {
+        if (regexec(tmpreg = rgpp[i].get(), tmp)) {
           currstart = tmpreg->startp[0];
           if (tmp == currstart) {
             regindex = i;
@@ -1510,7 +1545,7 @@ array_t *reg_assoc(svalue_t *str, array_t *pat, array_t *tok, svalue_t *def) {
           rmph = rmp = reinterpret_cast<struct reg_match *>(
               DMALLOC(sizeof(struct reg_match), TAG_TEMPORARY, "reg_assoc : rmp"));
         }
-        tmpreg = rgpp[regindex];
+        tmpreg = rgpp[regindex].get();
         rmp->begin = tmpreg->startp[0];
         rmp->end = tmp = tmpreg->endp[0];
         rmp->tok_i = regindex;
@@ -1569,10 +1604,6 @@ array_t *reg_assoc(svalue_t *str, array_t *pat, array_t *tok, svalue_t *def) {
     sv1->subtype = STRING_MALLOC;
     sv1->u.string = string_copy(tmp, "reg_assoc");
     assign_svalue_no_free(sv2, def);
-    for (i = 0; i < size; i++) {
-      FREE((char *)rgpp[i]);
-    }
-    FREE((char *)rgpp);
 
     while ((rmp = rmph)) {
       rmph = rmp->next;
@@ -1595,7 +1626,6 @@ array_t *reg_assoc(svalue_t *str, array_t *pat, array_t *tok, svalue_t *def) {
 #endif
 
 array_t *match_regexp(array_t *v, const char *pattern, int flag) {
-  struct regexp *reg;
   char *res;
   int num_match, size, match = !(flag & 2);
   array_t *ret;
@@ -1605,7 +1635,7 @@ array_t *match_regexp(array_t *v, const char *pattern, int flag) {
   if (!(size = v->size)) {
     return &the_null_array;
   }
-  reg = regcomp((unsigned char *)pattern, 0);
+  auto reg = efun_regcomp(pattern);
   if (!reg) {
     error(regexp_error);
   }
@@ -1613,7 +1643,7 @@ array_t *match_regexp(array_t *v, const char *pattern, int flag) {
   sv1 = v->item + size;
   num_match = 0;
   while (size--) {
-    if (!((--sv1)->type == T_STRING) || (regexec(reg, sv1->u.string) != match)) {
+    if (!((--sv1)->type == T_STRING) || (regexec(reg.get(), sv1->u.string) != match)) {
       res[size] = 0;
     } else {
       res[size] = 1;
@@ -1644,6 +1674,5 @@ array_t *match_regexp(array_t *v, const char *pattern, int flag) {
     }
   }
   FREE(res);
-  FREE((char *)reg);
   return ret;
 }
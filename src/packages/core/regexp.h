@@ -8,6 +8,8 @@
  * not the System V one.
  */
 
+#include <memory>
+
 #define EFUN_REGEXP 1
 #define ED_REGEXP 2
 
@@ -30,7 +32,11 @@ void regdump(regexp *);
 regexp *regcomp(unsigned char *, int);
 int regexec(regexp *, const char *);
 char *regsub(regexp *, char *, char *, int);
+const char *regliteral(regexp *, int *);
 
+// Compile a pattern for the efuns, through the regexp cache.  Returns
+// nullptr and sets regexp_error if the pattern is bad.
+std::shared_ptr<regexp> efun_regcomp(const char *);
 int match_single_regexp(const char *, const char *);
 array_t *match_regexp(array_t *, const char *, int);
 
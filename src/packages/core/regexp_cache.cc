@@ -0,0 +1,114 @@
+/*
+ * regexp_cache.cc
+ *
+ * Compiling a pattern usually costs more than matching it against a short
+ * string, and mudlibs tend to use the same few patterns over and over, so
+ * compiled programs are kept in a LRU list of "regexp cache size" entries.
+ * Setting it to 0 compiles every pattern on each call.
+ */
+
+#include "base/package_api.h"
+
+#include "packages/core/regexp_cache.h"
+
+#include <list>
+#include <unordered_map>
+
+namespace {
+
+struct regexp_cache_entry_t {
+  std::string key;
+  std::shared_ptr<void> program;
+  size_t size;
+};
+
+struct regexp_cache_stats_t {
+  uint64_t lookups;
+  uint64_t hits;
+  uint64_t evictions;
+};
+
+// Most recently used first.
+std::list<regexp_cache_entry_t> entries;
+std::unordered_map<std::string, std::list<regexp_cache_entry_t>::iterator> entry_index;
+size_t total_size;
+regexp_cache_stats_t stats;
+
+size_t cache_limit() { return CONFIG_INT(__RC_REGEXP_CACHE_SIZE__); }
+
+std::string make_key(regexp_cache_kind_t kind, const char *pattern) {
+  std::string key(1, static_cast<char>(kind));
+  key += pattern;
+  return key;
+}
+
+void evict_last() {
+  auto &entry = entries.back();
+  total_size -= entry.size;
+  entry_index.erase(entry.key);
+  entries.pop_back();
+  stats.evictions++;
+}
+
+LPC_FLOAT hit_rate(uint64_t hits, uint64_t lookups) {
+  return lookups ? 100 * (static_cast<LPC_FLOAT>(hits) / lookups) : 0;
+}
+}  // namespace
+
+std::shared_ptr<void> regexp_cache_find(regexp_cache_kind_t kind, const char *pattern) {
+  if (!cache_limit()) {
+    return nullptr;
+  }
+  stats.lookups++;
+  auto it = entry_index.find(make_key(kind, pattern));
+  if (it == entry_index.end()) {
+    return nullptr;
+  }
+  stats.hits++;
+  entries.splice(entries.begin(), entries, it->second);
+  return it->second->program;
+}
+
+void regexp_cache_add(regexp_cache_kind_t kind, const char *pattern,
+                      std::shared_ptr<void> program, size_t size) {
+  // The limit may have been lowered at runtime.
+  while (!entries.empty() && entries.size() >= cache_limit()) {
+    evict_last();
+  }
+  if (!cache_limit()) {
+    return;
+  }
+
+  auto key = make_key(kind, pattern);
+  auto it = entry_index.find(key);
+  if (it != entry_index.end()) {
+    total_size -= it->second->size;
+    entries.erase(it->second);
+  }
+  entries.push_front({key, std::move(program), size});
+  entry_index[key] = entries.begin();
+  total_size += size;
+}
+
+void regexp_cache_foreach(regexp_cache_kind_t kind,
+                          const std::function<void(const std::string &, size_t)> &fn) {
+  for (auto &entry : entries) {
+    if (entry.key[0] == static_cast<char>(kind)) {
+      fn(entry.key.substr(1), entry.size);
+    }
+  }
+}
+
+void print_regexp_cache_stats(outbuffer_t *ob) {
+  outbuf_add(ob, "Regexp cache information\n");
+  outbuf_add(ob, "-------------------------------\n");
+  if (!cache_limit()) {
+    outbuf_add(ob, "disabled.\n");
+    return;
+  }
+  outbuf_addv(ob, "entries:          %10lu / %lu\n", entries.size(), cache_limit());
+  outbuf_addv(ob, "size (bytes):     %10lu\n", total_size);
+  outbuf_addv(ob, "lookups:          %10" PRIu64 " (%% hits: %6.2f)\n", stats.lookups,
+              hit_rate(stats.hits, stats.lookups));
+  outbuf_addv(ob, "evictions:        %10" PRIu64 "\n", stats.evictions);
+}
@@ -0,0 +1,34 @@
+/*
+ * regexp_cache.h
+ *
+ * LRU cache of compiled patterns, shared by regexp()/reg_assoc() and the
+ * pcre_* efuns.  Sized by "regexp cache size" in the runtime config.
+ */
+
+#ifndef PACKAGES_CORE_REGEXP_CACHE_H_
+#define PACKAGES_CORE_REGEXP_CACHE_H_
+
+#include <functional>
+#include <memory>
+#include <string>
+
+// The same pattern compiles to a different program for each engine.
+enum regexp_cache_kind_t { REGEXP_CACHE_V8, REGEXP_CACHE_PCRE };
+
+// Cached program compiled from "pattern", nullptr if there is none.  The
+// program is kept alive by the returned pointer, even if it gets evicted
+// while still in use.
+std::shared_ptr<void> regexp_cache_find(regexp_cache_kind_t, const char *pattern);
+
+// Remember a freshly compiled program, "size" is its size in bytes.
+void regexp_cache_add(regexp_cache_kind_t, const char *pattern, std::shared_ptr<void> program,
+                      size_t size);
+
+// Calls fn(pattern, size) for every cached program of the given kind, most
+// recently used first.
+void regexp_cache_foreach(regexp_cache_kind_t,
+                          const std::function<void(const std::string &, size_t)> &fn);
+
+void print_regexp_cache_stats(struct outbuffer_t *);
+
+#endif /* PACKAGES_CORE_REGEXP_CACHE_H_ */
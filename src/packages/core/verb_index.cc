@@ -0,0 +1,188 @@
+/*
+ * verb_index.cc
+ *
+ * Rooms full of items can give a living hundreds of sentences, most of
+ * which have nothing to do with the command being parsed.  Each living
+ * with sentences keeps them indexed three ways:
+ *
+ *   - by verb, for plain verbs.  Verbs are shared strings and the command
+ *     verb is looked up with findstring(), so the pointer is the key.
+ *   - in a trie, for V_SHORT and V_NOSPACE verbs, which match any command
+ *     they are a prefix of.
+ *   - in a list, for the "" verb, which matches every command.
+ *
+ * Sentences are numbered as they are added, which keeps the order of
+ * ob->sent (newest first) when the matches are merged.
+ *
+ * They are also grouped by the object that added them, so remove_sent()
+ * only touches the sentences it removes; moving past an object that gave
+ * the living no actions costs a single lookup.
+ */
+
+#include "base/package_api.h"
+
+#include "packages/core/verb_index.h"
+#include "packages/core/outbuf.h"
+
+#ifndef NO_ADD_ACTION
+
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <unordered_map>
+
+struct verb_trie_t {
+  std::vector<sentence_t *> sentences;
+  std::map<char, std::unique_ptr<verb_trie_t>> children;
+};
+
+struct verb_index_t {
+  std::unordered_map<const char *, std::vector<sentence_t *>> verbs;
+  verb_trie_t prefixes;
+  std::vector<sentence_t *> any;
+  std::unordered_map<object_t *, std::vector<sentence_t *>> owners;
+  size_t size = 0;
+};
+
+namespace {
+
+uint64_t next_seq;
+
+struct verb_index_stats_t {
+  uint64_t lookups;
+  uint64_t sentences;
+  uint64_t candidates;
+};
+verb_index_stats_t stats;
+
+bool is_prefix_verb(sentence_t *sent) { return sent->flags & (V_NOSPACE | V_SHORT); }
+
+void erase_sentence(std::vector<sentence_t *> *list, sentence_t *sent) {
+  list->erase(std::remove(list->begin(), list->end(), sent), list->end());
+}
+}  // namespace
+
+void verb_index_add(object_t *ob, sentence_t *sent) {
+  if (!ob->verb_index) {
+    ob->verb_index = new verb_index_t;
+  }
+  auto index = ob->verb_index;
+
+  sent->seq = ++next_seq;
+  index->size++;
+  index->owners[sent->ob].push_back(sent);
+  if (is_prefix_verb(sent)) {
+    auto node = &index->prefixes;
+    for (auto p = sent->verb; *p; p++) {
+      auto &child = node->children[*p];
+      if (!child) {
+        child.reset(new verb_trie_t);
+      }
+      node = child.get();
+    }
+    node->sentences.push_back(sent);
+  } else if (!sent->verb[0]) {
+    index->any.push_back(sent);
+  } else {
+    index->verbs[sent->verb].push_back(sent);
+  }
+}
+
+void verb_index_remove(object_t *ob, sentence_t *sent) {
+  auto index = ob->verb_index;
+  if (!index) {
+    return;
+  }
+
+  auto owner = index->owners.find(sent->ob);
+  if (owner != index->owners.end()) {
+    erase_sentence(&owner->second, sent);
+    if (owner->second.empty()) {
+      index->owners.erase(owner);
+    }
+  }
+  if (is_prefix_verb(sent)) {
+    auto node = &index->prefixes;
+    for (auto p = sent->verb; *p && node; p++) {
+      auto child = node->children.find(*p);
+      node = child == node->children.end() ? nullptr : child->second.get();
+    }
+    if (node) {
+      erase_sentence(&node->sentences, sent);
+    }
+  } else if (!sent->verb[0]) {
+    erase_sentence(&index->any, sent);
+  } else {
+    auto bucket = index->verbs.find(sent->verb);
+    if (bucket != index->verbs.end()) {
+      erase_sentence(&bucket->second, sent);
+      if (bucket->second.empty()) {
+        index->verbs.erase(bucket);
+      }
+    }
+  }
+  if (!--index->size) {
+    verb_index_free(ob);
+  }
+}
+
+void verb_index_free(object_t *ob) {
+  delete ob->verb_index;
+  ob->verb_index = nullptr;
+}
+
+void verb_index_owned(object_t *ob, object_t *owner, std::vector<sentence_t *> *out) {
+  auto index = ob->verb_index;
+  if (!index) {
+    return;
+  }
+  auto bucket = index->owners.find(owner);
+  if (bucket != index->owners.end()) {
+    *out = bucket->second;
+  }
+}
+
+void verb_index_lookup(object_t *ob, const char *buff, const char *user_verb,
+                       std::vector<sentence_t *> *out) {
+  auto index = ob->verb_index;
+  if (!index) {
+    return;
+  }
+
+  out->insert(out->end(), index->any.begin(), index->any.end());
+  auto bucket = index->verbs.find(user_verb);
+  if (bucket != index->verbs.end()) {
+    out->insert(out->end(), bucket->second.begin(), bucket->second.end());
+  }
+  auto node = &index->prefixes;
+  for (auto p = buff;; p++) {
+    out->insert(out->end(), node->sentences.begin(), node->sentences.end());
+    if (!*p) {
+      break;
+    }
+    auto child = node->children.find(*p);
+    if (child == node->children.end()) {
+      break;
+    }
+    node = child->second.get();
+  }
+
+  std::sort(out->begin(), out->end(),
+            [](sentence_t *a, sentence_t *b) { return a->seq > b->seq; });
+
+  stats.lookups++;
+  stats.sentences += index->size;
+  stats.candidates += out->size();
+}
+
+void print_verb_index_stats(outbuffer_t *out) {
+  auto lookups = std::max<uint64_t>(stats.lookups, 1);
+  outbuf_add(out, "Verb index:\n");
+  outbuf_add(out, "-----------------------------\n");
+  outbuf_addv(out,
+              "%" PRIu64 " commands parsed, average sentences: %4.2f, average scanned: %4.2f\n\n",
+              stats.lookups, static_cast<double>(stats.sentences) / lookups,
+              static_cast<double>(stats.candidates) / lookups);
+}
+
+#endif /* ! NO_ADD_ACTION */
@@ -0,0 +1,31 @@
+/*
+ * verb_index.h
+ *
+ * Per-living index of add_action() sentences, so a command only looks at
+ * the sentences whose verb can match it instead of the whole list.
+ */
+
+#ifndef PACKAGES_CORE_VERB_INDEX_H_
+#define PACKAGES_CORE_VERB_INDEX_H_
+
+#include <vector>
+
+#ifndef NO_ADD_ACTION
+// Keep the index of ob in step with ob->sent.
+void verb_index_add(struct object_t *ob, struct sentence_t *sent);
+void verb_index_remove(struct object_t *ob, struct sentence_t *sent);
+void verb_index_free(struct object_t *ob);
+
+// Sentences of ob that were added by owner.
+void verb_index_owned(struct object_t *ob, struct object_t *owner,
+                      std::vector<struct sentence_t *> *out);
+
+// Sentences of ob that may match the command buff, in ob->sent order.
+// user_verb is the first word of buff as a shared string, if there is one.
+void verb_index_lookup(struct object_t *ob, const char *buff, const char *user_verb,
+                       std::vector<struct sentence_t *> *out);
+
+void print_verb_index_stats(struct outbuffer_t *);
+#endif
+
+#endif /* PACKAGES_CORE_VERB_INDEX_H_ */
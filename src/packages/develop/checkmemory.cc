@@ -7,9 +7,12 @@
 
 #include "base/package_api.h"
 
+#include "packages/core/add_action.h"
 #include "packages/core/file.h"
+#include "packages/core/matcher.h"
 #include "packages/core/call_out.h"
 #include "packages/core/outbuf.h"
+#include "packages/core/present_index.h"
 #ifdef PACKAGE_PARSER
 #include "packages/parser/parser.h"
 #endif
@@ -607,9 +610,10 @@ void check_all_blocks(int flag) {
     if (blocks[TAG_MAPPING & 0xff] != num_mappings)
       outbuf_addv(&out, "WARNING: num_mappings is: %" PRIu64 " should be: %" PRIu64 "\n",
                   num_mappings, blocks[TAG_MAPPING & 0xff]);
-    if (blocks[TAG_MAP_TBL & 0xff] != num_mappings)
-      outbuf_addv(&out, "WARNING: %" PRIu64 " tables for %" PRIu64 " mappings\n",
-                  blocks[TAG_MAP_TBL & 0xff], num_mappings);
+    if (blocks[TAG_MAP_TBL & 0xff] != num_mappings - num_shared_mappings)
+      outbuf_addv(&out, "WARNING: %" PRIu64 " tables for %" PRIu64 " mappings (%" PRIu64
+                  " shared)\n",
+                  blocks[TAG_MAP_TBL & 0xff], num_mappings, num_shared_mappings);
     if (blocks[TAG_INTERACTIVE & 0xff] != users_num(true))
       outbuf_addv(&out, "WATNING: num_user is: %" PRIu64 " should be: %" PRIu64 "\n",
                   users_num(true), blocks[TAG_INTERACTIVE & 0xff]);
@@ -687,11 +691,19 @@ void check_all_blocks(int flag) {
     parser_mark_verbs();
 #endif
     mark_file_sv();
+    mark_matchers();
     mark_all_defines();
     mark_free_sentences();
     mark_iptable();
     mark_stack();
     mark_command_giver_stack();
+    mark_file_cursors();
+#ifndef NO_ADD_ACTION
+    mark_pending_inits();
+#endif
+#ifndef NO_ENVIRONMENT
+    mark_present_ids();
+#endif
     mark_call_outs();
     mark_simuls();
     mark_mapping_node_blocks();
@@ -764,6 +776,9 @@ void check_all_blocks(int flag) {
             break;
           case TAG_MAPPING:
             map = NODET_TO_PTR(entry, mapping_t *);
+            if (!mapping_owns_table(map)) {
+              break;
+            }
             DO_MARK(map->table, TAG_MAP_TBL);
 
             i = map->table_size;
@@ -664,7 +664,11 @@ void f_range(int code) {
         return;
       }
 
-      if (to >= len - 1) {
+      if (to == from || from == len - 1) {
+        sp->type = T_STRING;
+        sp->subtype = STRING_CONSTANT;
+        sp->u.string = short_string(res + from, 1);
+      } else if (to >= len - 1) {
         put_malloced_string(string_copy(res + from, "f_range"));
       } else {
         char *tmp;
@@ -773,6 +777,10 @@ void f_extract_range(int code) {
         sp->type = T_STRING;
         sp->subtype = STRING_CONSTANT;
         sp->u.string = "";
+      } else if (from == len - 1) {
+        sp->type = T_STRING;
+        sp->subtype = STRING_CONSTANT;
+        sp->u.string = short_string(res + from, 1);
       } else {
         put_malloced_string(string_copy(res + from, "f_extract_range"));
       }
@@ -56,7 +56,6 @@
  *           return value of function pointe fun or function fun in object ob.
  */
 // TODO
-// study pattern
 // extra options when matching, greedy, lazy, possesive, etc.
 // match_all ? see previous
 // store reg->error & reg->erroffset before error(..)
@@ -65,6 +64,8 @@
 
 #include "pcre.h"
 
+#include "packages/core/regexp_cache.h"
+
 // Prototype declarations
 static void pcre_free_memory(pcre_t *p);
 static pcre *pcre_local_compile(pcre_t *p);
@@ -76,13 +77,7 @@ static array_t *pcre_match(array_t *v, svalue_t *pattern, int flag);
 static array_t *pcre_assoc(svalue_t *str, array_t *pat, array_t *tok, svalue_t *def);
 static char *pcre_get_replace(pcre_t *run, array_t *replacements);
 static array_t *pcre_get_substrings(pcre_t *run);
-// Caching functions
-static int pcre_cache_pattern(struct pcre_cache_t *table, pcre *cpat, svalue_t *pattern);
-static pcre *pcre_get_cached_pattern(struct pcre_cache_t *table, svalue_t *pattern);
 static mapping_t *pcre_get_cache();
-int pcrecachesize = 0;
-// Globals
-struct pcre_cache_t pcre_cache = {{0}};
 
 // efuns
 void f_pcre_version(void) {
@@ -149,7 +144,7 @@ void f_pcre_extract(void) {
   pcre_t *run;
   array_t *ret;
 
-  run = (pcre_t *)DCALLOC(1, sizeof(pcre_t), TAG_TEMPORARY, "f_pcre_extract : run");
+  run = new pcre_t();
   assign_svalue_no_free(&run->pattern, sp);
   run->subject = (sp - 1)->u.string;
   run->s_length = SVALUE_STRLEN(sp - 1);
@@ -192,7 +187,7 @@ void f_pcre_replace(void) {
 
   char *ret;
 
-  run = (pcre_t *)DCALLOC(1, sizeof(pcre_t), TAG_TEMPORARY, "f_pcre_replace: run");
+  run = new pcre_t();
 
   run->ovector = NULL;
   run->ovecsize = 0;
@@ -253,7 +248,7 @@ void f_pcre_replace_callback(void) {
 
   arg = sp - num_arg + 1;
 
-  run = (pcre_t *)DCALLOC(1, sizeof(pcre_t), TAG_TEMPORARY, "f_pcre_replace: run");
+  run = new pcre_t();
   run->ovector = NULL;
   run->ovecsize = 0;
   run->subject = arg->u.string;
@@ -335,10 +330,54 @@ void f_pcre_cache(void) {
   }
 }
 
+pcre_program_t::~pcre_program_t() {
+  if (extra) {
+#ifdef PCRE_STUDY_JIT_COMPILE
+    pcre_free_study(extra);
+#else
+    pcre_free(extra);
+#endif
+  }
+  pcre_free(re);
+}
+
 // Internal functions utilized by the efuns
+
+// Compile (and study) p->pattern, or take it from the regexp cache.
 static pcre *pcre_local_compile(pcre_t *p) {
-  p->re = pcre_compile(p->pattern.u.string, 0, &p->error, &p->erroffset, NULL);
+  auto cached = regexp_cache_find(REGEXP_CACHE_PCRE, p->pattern.u.string);
+  if (cached) {
+    p->program = std::static_pointer_cast<pcre_program_t>(cached);
+  } else {
+    pcre *re = pcre_compile(p->pattern.u.string, 0, &p->error, &p->erroffset, NULL);
+    if (re == NULL) {
+      return NULL;
+    }
+
+    p->program = std::make_shared<pcre_program_t>();
+    p->program->re = re;
+
+    // Studying is worth it since the program is reused.  Errors here only
+    // mean we match without the extra data.
+    const char *study_error;
+    int options = 0;
+#ifdef PCRE_STUDY_JIT_COMPILE
+    options |= PCRE_STUDY_JIT_COMPILE;
+#endif
+    p->program->extra = pcre_study(re, options, &study_error);
 
+    size_t size = 0, jit_size = 0;
+    pcre_fullinfo(re, NULL, PCRE_INFO_SIZE, &size);
+#ifdef PCRE_INFO_JITSIZE
+    if (p->program->extra) {
+      pcre_fullinfo(re, p->program->extra, PCRE_INFO_JITSIZE, &jit_size);
+    }
+#endif
+    regexp_cache_add(REGEXP_CACHE_PCRE, p->pattern.u.string, p->program, size + jit_size);
+  }
+
+  p->re = p->program->re;
+  p->extra = p->program->extra;
   return p->re;
 }
 
@@ -353,7 +392,7 @@ static int pcre_local_exec(pcre_t *p) {
   p->ovector = (int *)DCALLOC(size + 1, sizeof(int), TAG_TEMPORARY,
                               "pcre_local_exec");  // too much, but who cares
   p->ovecsize = size;
-  p->rc = pcre_exec(p->re, NULL, p->subject, p->s_length, 0,
+  p->rc = pcre_exec(p->re, p->extra, p->subject, p->s_length, 0,
 #ifndef USE_ICONV
                     PCRE_NO_UTF8_CHECK,
 #else
@@ -365,22 +404,10 @@ static int pcre_local_exec(pcre_t *p) {
 }
 
 static int pcre_magic(pcre_t *p) {
-  p->re = pcre_get_cached_pattern(&pcre_cache, &p->pattern);
-
-  if (p->re == NULL) {
-    pcre_local_compile(p);
-    pcre_cache_pattern(&pcre_cache, p->re, &p->pattern);
-  }
-
-  if (p->re == NULL) {
+  if (pcre_local_compile(p) == NULL) {
     return -1;
   }
 
-  /* Add support for studied patterns here */
-  // if(p->study && !found)
-  // {
-
-  // }
   pcre_local_exec(p);
 
   return 1;
@@ -392,7 +419,7 @@ static int pcre_match_single(svalue_t *str, svalue_t *pattern) {
   pcre_t *run;
   int ret;
 
-  run = (pcre_t *)DCALLOC(1, sizeof(pcre_t), TAG_TEMPORARY, "pcre_match_single : run");
+  run = new pcre_t();
   run->ovector = NULL;
   run->ovecsize = 0;
   assign_svalue_no_free(&run->pattern, pattern);
@@ -423,23 +450,17 @@ static array_t *pcre_match(array_t *v, svalue_t *pattern, int flag) {
     return &the_null_array;
   }
 
-  run = (pcre_t *)DCALLOC(1, sizeof(pcre_t), TAG_TEMPORARY, "pcre_match : run");
+  run = new pcre_t();
   run->ovector = NULL;
   run->ovecsize = 0;
   assign_svalue_no_free(&run->pattern, pattern);
 
-  run->re = pcre_get_cached_pattern(&pcre_cache, &run->pattern);
-
-  if (run->re == NULL) {
-    if (pcre_local_compile(run) == NULL) {
-      const char *rerror = run->error;
-      int offset = run->erroffset;
+  if (pcre_local_compile(run) == NULL) {
+    const char *rerror = run->error;
+    int offset = run->erroffset;
 
-      pcre_free_memory(run);
-      error("PCRE compilation failed at offset %d: %s\n", offset, rerror);
-    } else {
-      pcre_cache_pattern(&pcre_cache, run->re, &run->pattern);
-    }
+    pcre_free_memory(run);
+    error("PCRE compilation failed at offset %d: %s\n", offset, rerror);
   }
 
   res = (char *)DMALLOC(size, TAG_TEMPORARY, "prcre_match: res");
@@ -534,27 +555,22 @@ static array_t *pcre_assoc(svalue_t *str, array_t *pat, array_t *tok, svalue_t *
     rgpp = (pcre_t **)DCALLOC(size, sizeof(pcre_t *), TAG_TEMPORARY, "pcre_assoc : rgpp");
 
     for (i = 0; i < size; i++) {
-      rgpp[i] = (pcre_t *)DCALLOC(1, sizeof(pcre_t), TAG_TEMPORARY, "pcre_assoc : rgpp[i]");
+      rgpp[i] = new pcre_t();
       rgpp[i]->ovector = NULL;
       rgpp[i]->ovecsize = 0;
       assign_svalue_no_free(&rgpp[i]->pattern, &pat->item[i]);
-      rgpp[i]->re = pcre_get_cached_pattern(&pcre_cache, &rgpp[i]->pattern);
+      if (pcre_local_compile(rgpp[i]) == NULL) {
+        const char *rerror = rgpp[i]->error;
+        int offset = rgpp[i]->erroffset;
 
-      if (rgpp[i]->re == NULL) {
-        if (pcre_local_compile(rgpp[i]) == NULL) {
-          const char *rerror = rgpp[i]->error;
-          int offset = rgpp[i]->erroffset;
-
-          while (i--) {
-            pcre_free_memory(rgpp[i]);
-          }
-
-          FREE(rgpp);
-          free_empty_array(ret);
-          error("PCRE compilation failed at offset %d: %s\n", offset, rerror);
-        } else {
-          pcre_cache_pattern(&pcre_cache, rgpp[i]->re, &rgpp[i]->pattern);
+        pcre_free_memory(rgpp[i]);
+        while (i--) {
+          pcre_free_memory(rgpp[i]);
         }
+
+        FREE(rgpp);
+        free_empty_array(ret);
+        error("PCRE compilation failed at offset %d: %s\n", offset, rerror);
       }
     }
 
@@ -785,132 +801,19 @@ static void pcre_free_memory(pcre_t *p) {
   if (p->ovector) {
     FREE(p->ovector);
   }
-  FREE(p);
-}
-
-// Caching functions, add new ones at the front of the bucket so we find them
-// faster
-static int pcre_cache_pattern(struct pcre_cache_t *table, pcre *cpat,
-                              svalue_t *pattern)  // don't keep pointers to
-                                                  // strings that will get freed
-                                                  // elsewhere!
-{
-  unsigned int bucket = svalue_to_int(pattern) % PCRE_CACHE_SIZE;
-  int sz;
-  struct pcre_cache_bucket_t *tmp;
-  struct pcre_cache_bucket_t *node;
-  int full;
-
-  tmp = table->buckets[bucket];
-
-  // Calculate size of compiled pattern
-  pcre_fullinfo(cpat, NULL, PCRE_INFO_SIZE, &sz);
-
-  full = (pcrecachesize > 2 * PCRE_CACHE_SIZE);
-  while (tmp) {
-    if (pattern->u.string == tmp->pattern.u.string) {
-      break;
-    }
-
-    tmp = tmp->next;
-  }
-
-  if (tmp) {
-    // does this even make sense? same pattern will always compile the same way?
-    pcre_free(tmp->compiled_pattern);
-    node = tmp;
-  } else {
-    node = (struct pcre_cache_bucket_t *)DCALLOC(1, sizeof(struct pcre_cache_bucket_t),
-                                                 TAG_TEMPORARY, "pcre_cache_pattern : node");
-    node->pattern.type = T_NUMBER;  // so we don't free invalids
-    if (node == NULL) {
-      return -1;
-    }
-    if (!full) {
-      pcrecachesize++;
-    } else {
-      if ((tmp = table->buckets[bucket])) {
-        while (tmp->next) {
-          tmp = tmp->next;
-        }
-        if (tmp == table->buckets[bucket]) {  // if the hash version works, most
-                                              // of the time
-          pcre_free(tmp->compiled_pattern);
-          FREE(tmp);
-          table->buckets[bucket] = NULL;
-        } else {
-          struct pcre_cache_bucket_t *tmp2;
-          tmp2 = table->buckets[bucket];
-          while (tmp2->next != tmp) {
-            tmp2 = tmp2->next;  // shouldn't get here often
-          }
-          pcre_free(tmp->compiled_pattern);
-          FREE(tmp);
-          tmp2->next = NULL;
-        }
-      }
-    }
-    node->next = table->buckets[bucket];
-    table->buckets[bucket] = node;
-  }
-
-  assign_svalue(&node->pattern, pattern);
-  node->compiled_pattern = cpat;
-  node->size = sz;
-
-  return 0;
-}
-
-static pcre *pcre_get_cached_pattern(struct pcre_cache_t *table, svalue_t *pattern) {
-  unsigned int bucket = svalue_to_int(pattern) % PCRE_CACHE_SIZE;
-  struct pcre_cache_bucket_t *node;
-  struct pcre_cache_bucket_t *lnode = NULL;
-  node = table->buckets[bucket];
-
-  while (node) {
-    if (pattern->u.string == node->pattern.u.string) {
-      if (node != table->buckets[bucket]) {
-        // not at the front, move it there, so the most used pattern is fastest
-        lnode->next = node->next;
-        node->next = table->buckets[bucket];
-        table->buckets[bucket] = node;
-      }
-      return node->compiled_pattern;
-    }
-    lnode = node;
-    node = node->next;
-  }
-  return NULL;
+  delete p;
 }
 
 static mapping_t *pcre_get_cache() {
-  int size = 0, i;
+  int size = 0;
   mapping_t *ret;
-  struct pcre_cache_bucket_t *node;
-
-  // Calculate size for mapping
-  for (i = 0; i < PCRE_CACHE_SIZE; i++) {
-    if (pcre_cache.buckets[i] != NULL) {
-      node = pcre_cache.buckets[i];
 
-      while (node) {
-        node = node->next;
-        size++;
-      }
-    }
-  }
+  regexp_cache_foreach(REGEXP_CACHE_PCRE, [&](const std::string &, size_t) { size++; });
 
   ret = allocate_mapping(size);
 
-  for (i = 0; i < PCRE_CACHE_SIZE; i++) {
-    if (pcre_cache.buckets[i] != NULL) {
-      node = pcre_cache.buckets[i];
-
-      while (node) {
-        add_mapping_pair(ret, node->pattern.u.string, node->size);
-        node = node->next;
-      }
-    }
-  }
+  regexp_cache_foreach(REGEXP_CACHE_PCRE, [&](const std::string &pattern, size_t sz) {
+    add_mapping_pair(ret, pattern.c_str(), sz);
+  });
   return ret;
 }
@@ -12,12 +12,22 @@ The maximum number of capturing groups is:
 #ifndef PACKAGS_PCRE_H
 #define PACKAGS_PCRE_H
 
-#define PCRE_CACHE_SIZE 256
-
+#include <memory>
 #include <pcre.h>
 
+// A compiled pattern as kept in the regexp cache.
+struct pcre_program_t {
+  pcre *re;
+  pcre_extra *extra;  // study (and JIT) data, may be NULL
+
+  ~pcre_program_t();
+};
+
 typedef struct {
   pcre *re;
+  pcre_extra *extra;
+  // Keeps re and extra alive.
+  std::shared_ptr<pcre_program_t> program;
   const char *error;
   svalue_t pattern;
   const char *subject;
@@ -33,15 +43,4 @@ typedef struct {
   /* EXTRA */
 } pcre_t;
 
-struct pcre_cache_bucket_t {
-  pcre *compiled_pattern;  // value1
-  svalue_t pattern;        // key
-  int size;                // size in bytes
-  struct pcre_cache_bucket_t *next;
-};
-
-struct pcre_cache_t {
-  struct pcre_cache_bucket_t *buckets[PCRE_CACHE_SIZE];
-};
-
 #endif
@@ -87,6 +87,18 @@ struct telnet_t {
 #if defined(HAVE_ZLIB)
 	/* zlib (mccp2) compression */
 	z_stream *z;
+	/* non-zero if output is only compressed by telnet_flush() */
+	int z_deferred;
+	/* output held back while z_deferred, not compressed yet */
+	char *z_pending;
+	size_t z_pending_len;
+	size_t z_pending_size;
+	/* output of telnet_deflate_pending() that hasn't been sent yet */
+	char *z_out;
+	size_t z_out_len;
+	size_t z_out_size;
+	/* deflate() error in telnet_deflate_pending(), telnet_flush() reports it */
+	int z_error;
 #endif
 	/* RFC1143 option negotiation states */
 	struct telnet_rfc1143_t *q;
@@ -201,6 +213,36 @@ telnet_error_t _init_zlib(telnet_t *telnet, int deflate, int err_fatal) {
 }
 #endif /* defined(HAVE_ZLIB) */
 
+#if defined(HAVE_ZLIB)
+/* append bytes to a growing buffer, returns 0 if out of memory */
+static int _append(char **buffer, size_t *len, size_t *size,
+		const char *data, size_t n) {
+	if (*len + n > *size) {
+		size_t new_size = *size ? *size : 1024;
+		char *new_buffer;
+
+		while (new_size < *len + n)
+			new_size *= 2;
+		if ((new_buffer = (char *)realloc(*buffer, new_size)) == 0)
+			return 0;
+		*buffer = new_buffer;
+		*size = new_size;
+	}
+	memcpy(*buffer + *len, data, n);
+	*len += n;
+	return 1;
+}
+
+/* drop a buffer that has grown large, once it is empty again */
+static void _shrink(char **buffer, size_t *size) {
+	if (*size > 16384) {
+		free(*buffer);
+		*buffer = 0;
+		*size = 0;
+	}
+}
+#endif /* defined(HAVE_ZLIB) */
+
 /* push bytes out, compressing them first if need be */
 static void _send(telnet_t *telnet, const char *buffer,
 		size_t size) {
@@ -212,16 +254,26 @@ static void _send(telnet_t *telnet, const char *buffer,
 		char deflate_buffer[1024];
 		int rs;
 
+		/* hold the output back for telnet_flush() if asked to */
+		if (telnet->z_deferred && _append(&telnet->z_pending,
+				&telnet->z_pending_len, &telnet->z_pending_size,
+				buffer, size)) {
+			return;
+		}
+
 		/* initialize z state */
 		telnet->z->next_in = (unsigned char *)buffer;
 		telnet->z->avail_in = (unsigned int)size;
-		telnet->z->next_out = (unsigned char *)deflate_buffer;
-		telnet->z->avail_out = sizeof(deflate_buffer);
 
 		/* deflate until buffer exhausted and all output is produced */
-		while (telnet->z->avail_in > 0 || telnet->z->avail_out == 0) {
-			/* compress */
-			if ((rs = deflate(telnet->z, Z_SYNC_FLUSH)) != Z_OK) {
+		do {
+			/* prepare output buffer for this run */
+			telnet->z->next_out = (unsigned char *)deflate_buffer;
+			telnet->z->avail_out = sizeof(deflate_buffer);
+
+			/* compress; Z_BUF_ERROR only means there was nothing left to do */
+			rs = deflate(telnet->z, Z_SYNC_FLUSH);
+			if (rs != Z_OK && rs != Z_BUF_ERROR) {
 				_error(telnet, __LINE__, __func__, TELNET_ECOMPRESS, 1,
 						"deflate() failed: %s", zError(rs));
 				deflateEnd(telnet->z);
@@ -234,12 +286,9 @@ static void _send(telnet_t *telnet, const char *buffer,
 			ev.type = TELNET_EV_SEND;
 			ev.data.buffer = deflate_buffer;
 			ev.data.size = sizeof(deflate_buffer) - telnet->z->avail_out;
-			telnet->eh(telnet, &ev, telnet->ud);
-
-			/* prepare output buffer for next run */
-			telnet->z->next_out = (unsigned char *)deflate_buffer;
-			telnet->z->avail_out = sizeof(deflate_buffer);
-		}
+			if (ev.data.size != 0)
+				telnet->eh(telnet, &ev, telnet->ud);
+		} while (telnet->z->avail_in > 0 || telnet->z->avail_out == 0);
 
 		/* do not continue with remaining code */
 		return;
@@ -909,6 +958,10 @@ void telnet_free(telnet_t *telnet) {
 	}
 
 #if defined(HAVE_ZLIB)
+	/* free held back output */
+	free(telnet->z_pending);
+	free(telnet->z_out);
+
 	/* free zlib box */
 	if (telnet->z != 0) {
 		if (telnet->flags & TELNET_PFLAG_DEFLATE)
@@ -1397,6 +1450,117 @@ void telnet_send_text(telnet_t *telnet, const char *buffer,
 	}
 }
 
+/* send already escaped text */
+void telnet_send_escaped(telnet_t *telnet, const char *buffer,
+		size_t size) {
+	_send(telnet, buffer, size);
+}
+
+/* check if output is compressed */
+int telnet_is_deflating(telnet_t *telnet) {
+#if defined(HAVE_ZLIB)
+	return telnet->z != 0 && (telnet->flags & TELNET_PFLAG_DEFLATE) != 0;
+#else
+	return 0;
+#endif
+}
+
+/* choose whether compressed output is flushed on every send */
+void telnet_defer_flush(telnet_t *telnet, int defer) {
+#if defined(HAVE_ZLIB)
+	if (!defer)
+		telnet_flush(telnet);
+	telnet->z_deferred = defer;
+#endif
+}
+
+/* compress output held back by telnet_defer_flush(), without sending it */
+void telnet_deflate_pending(telnet_t *telnet) {
+#if defined(HAVE_ZLIB)
+	int rs;
+
+	if (!telnet_is_deflating(telnet) || telnet->z_pending_len == 0 ||
+			telnet->z_error != 0)
+		return;
+
+	telnet->z->next_in = (unsigned char *)telnet->z_pending;
+	telnet->z->avail_in = (unsigned int)telnet->z_pending_len;
+
+	do {
+		/* make room for at least another 1k of output */
+		if (telnet->z_out_size - telnet->z_out_len < 1024) {
+			size_t size = telnet->z_out_size ? telnet->z_out_size * 2 :
+					telnet->z_pending_len / 2 + 1024;
+			char *out = (char *)realloc(telnet->z_out, size);
+			if (out == 0) {
+				telnet->z_error = Z_MEM_ERROR;
+				break;
+			}
+			telnet->z_out = out;
+			telnet->z_out_size = size;
+		}
+		telnet->z->next_out = (unsigned char *)telnet->z_out + telnet->z_out_len;
+		telnet->z->avail_out = (unsigned int)(telnet->z_out_size - telnet->z_out_len);
+
+		rs = deflate(telnet->z, Z_SYNC_FLUSH);
+		if (rs != Z_OK && rs != Z_BUF_ERROR) {
+			telnet->z_error = rs;
+			break;
+		}
+		telnet->z_out_len = telnet->z_out_size - telnet->z->avail_out;
+	} while (telnet->z->avail_in > 0 || telnet->z->avail_out == 0);
+
+	telnet->z_pending_len = 0;
+	_shrink(&telnet->z_pending, &telnet->z_pending_size);
+#endif
+}
+
+/* send compressed output held back by telnet_defer_flush() */
+void telnet_flush(telnet_t *telnet) {
+#if defined(HAVE_ZLIB)
+	telnet_event_t ev;
+
+	if (!telnet_is_deflating(telnet))
+		return;
+
+	telnet_deflate_pending(telnet);
+
+	if (telnet->z_error != 0) {
+		_error(telnet, __LINE__, __func__, TELNET_ECOMPRESS, 1,
+				"deflate() failed: %s", zError(telnet->z_error));
+		deflateEnd(telnet->z);
+		free(telnet->z);
+		telnet->z = 0;
+		telnet->z_error = 0;
+		telnet->z_out_len = 0;
+		return;
+	}
+
+	if (telnet->z_out_len != 0) {
+		ev.type = TELNET_EV_SEND;
+		ev.data.buffer = telnet->z_out;
+		ev.data.size = telnet->z_out_len;
+		telnet->z_out_len = 0;
+		telnet->eh(telnet, &ev, telnet->ud);
+		_shrink(&telnet->z_out, &telnet->z_out_size);
+	}
+#endif
+}
+
+/* number of bytes held back by telnet_defer_flush() */
+size_t telnet_pending(telnet_t *telnet) {
+#if defined(HAVE_ZLIB)
+	return telnet_is_deflating(telnet) ? telnet->z_pending_len : 0;
+#else
+	return 0;
+#endif
+}
+
+/* check if we are transmitting in BINARY mode */
+int telnet_is_transmit_binary(telnet_t *telnet) {
+	return (telnet->flags & TELNET_FLAG_TRANSMIT_BINARY) != 0;
+}
+
 /* send subnegotiation header */
 void telnet_begin_sb(telnet_t *telnet, unsigned char telopt) {
 	unsigned char sb[3];
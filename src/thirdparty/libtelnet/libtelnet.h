@@ -453,6 +453,70 @@ extern void telnet_send(telnet_t *telnet,
 extern void telnet_send_text(telnet_t *telnet,
 		const char *buffer, size_t size);
 
+/*!
+ * Send bytes that are already escaped and translated the way
+ * telnet_send_text() would, compressing them if MCCP is active.
+ *
+ * \param telnet Telnet state tracker object.
+ * \param buffer Buffer of bytes to send.
+ * \param size   Number of bytes to send.
+ */
+extern void telnet_send_escaped(telnet_t *telnet,
+		const char *buffer, size_t size);
+
+/*!
+ * Check whether outgoing data is currently compressed.
+ *
+ * \param telnet Telnet state tracker object.
+ * \return 1 if compressing, 0 otherwise.
+ */
+extern int telnet_is_deflating(telnet_t *telnet);
+
+/*!
+ * Check whether we are transmitting in BINARY mode, in which case
+ * telnet_send_text() doesn't translate line endings.
+ *
+ * \param telnet Telnet state tracker object.
+ * \return 1 if in BINARY mode, 0 otherwise.
+ */
+extern int telnet_is_transmit_binary(telnet_t *telnet);
+
+/*!
+ * Choose whether compressed output is flushed to the event handler
+ * on every send (the default), or held back uncompressed until
+ * telnet_flush().  Has no effect on uncompressed output.
+ *
+ * \param telnet Telnet state tracker object.
+ * \param defer  Non-zero to hold compressed output back.
+ */
+extern void telnet_defer_flush(telnet_t *telnet, int defer);
+
+/*!
+ * Compress output held back by telnet_defer_flush(), but leave sending
+ * it to telnet_flush().  Only touches this telnet object and does not
+ * call the event handler, so different telnet objects can be
+ * compressed on different threads at the same time.
+ *
+ * \param telnet Telnet state tracker object.
+ */
+extern void telnet_deflate_pending(telnet_t *telnet);
+
+/*!
+ * Compress and send output held back by telnet_defer_flush().
+ *
+ * \param telnet Telnet state tracker object.
+ */
+extern void telnet_flush(telnet_t *telnet);
+
+/*!
+ * Number of bytes held back by telnet_defer_flush() that haven't been
+ * compressed yet, 0 if not compressing.
+ *
+ * \param telnet Telnet state tracker object.
+ * \return Number of pending bytes.
+ */
+extern size_t telnet_pending(telnet_t *telnet);
+
 /*!
  * \brief Begin a sub-negotiation command.
  *
@@ -3,6 +3,15 @@
 #include "vm/internal/base/machine.h"
 
 #include <stdlib.h>  // for qsort
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "base/internal/hash.h"
+#include "base/internal/worker_pool.h"
+#include "include/inventory.h"
 
 #ifdef PACKAGE_MUDLIB_STATS
 #include "packages/mudlib_stats/mudlib_stats.h"
@@ -20,7 +29,6 @@
 static int builtin_sort_array_cmp_fwd(const void * /*vp1*/, const void * /*vp2*/);
 static int builtin_sort_array_cmp_rev(const void * /*vp1*/, const void * /*vp2*/);
 static int sort_array_cmp(const void * /*vp1*/, const void * /*vp2*/);
-static long alist_cmp(svalue_t * /*p1*/, svalue_t * /*p2*/);
 /*
  * Make an empty array for everyone to use, never to be deallocated.
  * It is cheaper to reuse it, than to use MALLOC() and allocate.
@@ -148,7 +156,7 @@ static void dealloc_empty_array(array_t *p) {
   num_arrays--;
   total_array_size -= sizeof(array_t) + sizeof(svalue_t) * (p->size - 1);
 
-  FREE((char *)p);
+  FREE_ARRAY(p, p->size);
 }
 
 void dealloc_array(array_t *p) {
@@ -176,9 +184,9 @@ void free_empty_array(array_t *p) {
   dealloc_empty_array(p);
 }
 
-/* Finish setting up an array allocated with ALLOC_ARRAY, resizing it to
-   size n */
-static array_t *fix_array(array_t *p, unsigned int n) {
+/* Finish setting up an array allocated with ALLOC_ARRAY(alloced), resizing
+   it to size n */
+static array_t *fix_array(array_t *p, unsigned int alloced, unsigned int n) {
   if (n) {
     num_arrays++;
     total_array_size += sizeof(array_t) + sizeof(svalue_t) * (n - 1);
@@ -188,10 +196,10 @@ static array_t *fix_array(array_t *p, unsigned int n) {
     ms_setup_stats(p);
     //      if(n>65535)
     //          fatal("big array2");
-    return RESIZE_ARRAY(p, n);
+    return RESIZE_ARRAY(p, alloced, n);
   }
   if (p != &the_null_array) {
-    FREE(p);
+    FREE_ARRAY(p, alloced);
   }
   return &the_null_array;
 }
@@ -201,7 +209,7 @@ array_t *resize_array(array_t *p, unsigned int n) {
   total_array_size += (int)((int)n - (int)p->size) * int(sizeof(svalue_t));
   if (n) {
     ms_remove_stats(p);
-    p = RESIZE_ARRAY(p, n);
+    p = RESIZE_ARRAY(p, p->size, n);
     //    if(n>65535)
     //              fatal("big array3");
 
@@ -212,20 +220,37 @@ array_t *resize_array(array_t *p, unsigned int n) {
     ms_setup_stats(p);
   } else {
     if (p != &the_null_array) {
-      FREE(p);
+      FREE_ARRAY(p, p->size);
     }
     return &the_null_array;
   }
   return p;
 }
 
+/*
+ * One piece of an exploded string.  Most of them are words, and the ones of
+ * at most one character need no allocation at all.
+ */
+static void explode_piece(svalue_t *sv, const char *beg, int sz) {
+  char *buff;
+
+  sv->type = T_STRING;
+  if ((sv->u.string = short_string(beg, sz))) {
+    sv->subtype = STRING_CONSTANT;
+    return;
+  }
+  sv->subtype = STRING_MALLOC;
+  sv->u.string = buff = new_string(sz, "explode_string: buff");
+  memcpy(buff, beg, sz);
+  buff[sz] = '\0';
+}
+
 array_t *explode_string(const char *str, int slen, const char *del, int len) {
   auto max_array_size = CONFIG_INT(__MAX_ARRAY_SIZE__);
 
   const char *p, *beg, *lastdel = 0;
   int num, j, limit;
   array_t *ret;
-  char *buff, *tmp;
   int sz;
 
   if (!slen) {
@@ -242,11 +267,7 @@ array_t *explode_string(const char *str, int slen, const char *del, int len) {
     }
     ret = int_allocate_empty_array(slen);
     for (j = 0; j < slen; j++) {
-      ret->item[j].type = T_STRING;
-      ret->item[j].subtype = STRING_MALLOC;
-      ret->item[j].u.string = tmp = new_string(1, "explode_string: tmp");
-      tmp[0] = str[j];
-      tmp[1] = '\0';
+      explode_piece(&ret->item[j], str + j, 1);
     }
     return ret;
   }
@@ -302,13 +323,7 @@ array_t *explode_string(const char *str, int slen, const char *del, int len) {
     for (p = str, beg = str, num = 0; *p && (num < limit);) {
       if (*p == delimeter) {
         DEBUG_CHECK(num >= ret->size, "Index out of bounds in explode!\n");
-        sz = p - beg;
-        ret->item[num].type = T_STRING;
-        ret->item[num].subtype = STRING_MALLOC;
-        ret->item[num].u.string = buff = new_string(sz, "explode_string: buff");
-
-        strncpy(buff, beg, sz);
-        buff[sz] = '\0';
+        explode_piece(&ret->item[num], beg, p - beg);
         num++;
         beg = ++p;
       } else {
@@ -317,15 +332,11 @@ array_t *explode_string(const char *str, int slen, const char *del, int len) {
     }
 
     if (CONFIG_INT(__RC_REVERSIBLE_EXPLODE_STRING__)) {
-      ret->item[num].type = T_STRING;
-      ret->item[num].subtype = STRING_MALLOC;
-      ret->item[num].u.string = string_copy(beg, "explode_string: last, len == 1");
+      explode_piece(&ret->item[num], beg, strlen(beg));
     } else {
       /* Copy last occurence, if there was not a 'del' at the end. */
       if (*beg != '\0' && num != limit) {
-        ret->item[num].type = T_STRING;
-        ret->item[num].subtype = STRING_MALLOC;
-        ret->item[num].u.string = string_copy(beg, "explode_string: last, len == 1");
+        explode_piece(&ret->item[num], beg, strlen(beg));
       }
     }
     return ret;
@@ -381,12 +392,7 @@ array_t *explode_string(const char *str, int slen, const char *del, int len) {
         fatal("Index out of bounds in explode!\n");
       }
 
-      ret->item[num].type = T_STRING;
-      ret->item[num].subtype = STRING_MALLOC;
-      ret->item[num].u.string = buff = new_string(p - beg, "explode_string: buff");
-
-      strncpy(buff, beg, p - beg);
-      buff[p - beg] = '\0';
+      explode_piece(&ret->item[num], beg, p - beg);
       num++;
       beg = p + len;
       p = beg;
@@ -397,14 +403,10 @@ array_t *explode_string(const char *str, int slen, const char *del, int len) {
 
   /* Copy last occurence, if there was not a 'del' at the end. */
   if (CONFIG_INT(__RC_REVERSIBLE_EXPLODE_STRING__)) {
-    ret->item[num].type = T_STRING;
-    ret->item[num].subtype = STRING_MALLOC;
-    ret->item[num].u.string = string_copy(beg, "explode_string: last, len != 1");
+    explode_piece(&ret->item[num], beg, strlen(beg));
   } else {
     if (*beg != '\0' && num != limit) {
-      ret->item[num].type = T_STRING;
-      ret->item[num].subtype = STRING_MALLOC;
-      ret->item[num].u.string = string_copy(beg, "explode_string: last, len != 1");
+      explode_piece(&ret->item[num], beg, strlen(beg));
     }
   }
   return ret;
@@ -757,6 +759,26 @@ typedef struct unique_list_s {
 
 static unique_list_t *g_u_list = 0;
 
+namespace {
+/* Agrees with sameval(): 0.0 and -0.0 are the same mark. */
+struct sameval_hash_t {
+  size_t operator()(svalue_t *sv) const {
+    switch (sv->type) {
+      case T_STRING:
+        return whashstr(sv->u.string);
+      case T_REAL:
+        return sv->u.real == 0 ? 0 : std::hash<LPC_FLOAT>()(sv->u.real);
+      default:
+        return std::hash<LPC_INT>()(sv->u.number);
+    }
+  }
+};
+
+struct sameval_equal_t {
+  bool operator()(svalue_t *p1, svalue_t *p2) const { return sameval(p1, p2); }
+};
+}  // namespace
+
 static void unique_array_error_handler(void) {
   unique_list_t *unlist = g_u_list;
   unique_t *uptr = unlist->head, *nptr;
@@ -781,6 +803,7 @@ void f_unique_array(void) {
   unique_t **head, *uptr, *nptr;
   funptr_t *fptr = 0;
   const char *func;
+  std::unordered_map<svalue_t *, unique_t *, sameval_hash_t, sameval_equal_t> marks;
 
   size = (v = (sp - num_arg + 1)->u.arr)->size;
   if (!size) {
@@ -829,17 +852,13 @@ void f_unique_array(void) {
     }
 
     if (sv && !sameval(sv, skipval)) {
-      uptr = *head;
-      while (uptr) {
-        if (sameval(sv, &uptr->mark)) {
-          uptr->indices =
-              RESIZE(uptr->indices, uptr->count + 1, int, TAG_TEMPORARY, "f_unique_array:2");
-          uptr->indices[uptr->count++] = i;
-          break;
-        }
-        uptr = uptr->next;
-      }
-      if (!uptr) {
+      auto it = marks.find(sv);
+      if (it != marks.end()) {
+        uptr = it->second;
+        uptr->indices =
+            RESIZE(uptr->indices, uptr->count + 1, int, TAG_TEMPORARY, "f_unique_array:2");
+        uptr->indices[uptr->count++] = i;
+      } else {
         numkeys++;
         uptr = reinterpret_cast<unique_t *>(
             DMALLOC(sizeof(unique_t), TAG_TEMPORARY, "f_unique_array:3"));
@@ -850,6 +869,7 @@ void f_unique_array(void) {
         uptr->next = *head;
         assign_svalue_no_free(&uptr->mark, sv);
         *head = uptr;
+        marks.emplace(&uptr->mark, uptr);
       }
     }
   }
@@ -1128,7 +1148,180 @@ void map_string(svalue_t *arg, int num_arg) {
 #ifdef F_SORT_ARRAY
 static function_to_call_t *sort_array_ftc;
 
+/*
+ * Arrays of only ints, only floats or only strings don't need the generic
+ * comparator.  Their items are turned into keys that sort on their own:
+ * ints and floats become 64 bit keys for a radix sort, strings keep their
+ * first 8 bytes and their length next to them so most comparisons never
+ * reach memcmp().  The items are only moved once, at the end.  Big arrays
+ * are sorted in slices spread over the worker pool and merged.
+ */
+namespace {
+const size_t kParallelSortMin = 8192;
+const size_t kRadixSortMin = 256;
+
+struct num_key_t {
+  uint64_t key;
+  uint32_t idx;
+};
+
+struct str_key_t {
+  uint64_t prefix; /* first 8 bytes, big endian, zero padded */
+  const char *str;
+  uint32_t len;
+  uint32_t idx;
+};
+
+bool operator<(const num_key_t &a, const num_key_t &b) { return a.key < b.key; }
+
+/* the same order as strcmp(), strings can't contain 0 bytes */
+bool operator<(const str_key_t &a, const str_key_t &b) {
+  if (a.prefix != b.prefix) {
+    return a.prefix < b.prefix;
+  }
+  if (a.len <= 8 || b.len <= 8) {
+    return a.len < b.len;
+  }
+  auto c = memcmp(a.str + 8, b.str + 8, std::min(a.len, b.len) - 8);
+  return c ? c < 0 : a.len < b.len;
+}
+
+void radix_sort(num_key_t *keys, size_t n) {
+  if (n < kRadixSortMin) {
+    std::sort(keys, keys + n);
+    return;
+  }
+  std::vector<num_key_t> tmp(n);
+  std::vector<size_t> counts(8 * 256);
+  num_key_t *from = keys, *to = tmp.data();
+
+  for (size_t i = 0; i < n; i++) {
+    for (int b = 0; b < 8; b++) {
+      counts[b * 256 + ((keys[i].key >> (b * 8)) & 0xff)]++;
+    }
+  }
+  for (int b = 0; b < 8; b++) {
+    size_t *count = &counts[b * 256];
+    /* every key has the same byte here */
+    if (count[(keys[0].key >> (b * 8)) & 0xff] == n) {
+      continue;
+    }
+    size_t pos = 0;
+    for (int d = 0; d < 256; d++) {
+      auto c = count[d];
+      count[d] = pos;
+      pos += c;
+    }
+    for (size_t i = 0; i < n; i++) {
+      to[count[(from[i].key >> (b * 8)) & 0xff]++] = from[i];
+    }
+    std::swap(from, to);
+  }
+  if (from != keys) {
+    std::copy(from, from + n, keys);
+  }
+}
+
+void sort_str_keys(str_key_t *keys, size_t n) { std::sort(keys, keys + n); }
+
+template <class T>
+void sort_keys(std::vector<T> &keys, void (*sort_slice)(T *, size_t)) {
+  size_t n = keys.size();
+  size_t parts = n >= kParallelSortMin ? worker_pool_size() : 1;
+
+  if (parts < 2) {
+    sort_slice(keys.data(), n);
+    return;
+  }
+  std::vector<size_t> bounds(parts + 1);
+  for (size_t i = 0; i <= parts; i++) {
+    bounds[i] = n * i / parts;
+  }
+  worker_pool_run(parts, [&](size_t i) {
+    sort_slice(keys.data() + bounds[i], bounds[i + 1] - bounds[i]);
+  });
+
+  /* merge neighbouring slices until one is left */
+  std::vector<T> tmp(n);
+  for (size_t width = 1; width < parts; width *= 2) {
+    worker_pool_run((parts + 2 * width - 1) / (2 * width), [&](size_t pair) {
+      auto lo = bounds[std::min(2 * pair * width, parts)];
+      auto mid = bounds[std::min((2 * pair + 1) * width, parts)];
+      auto hi = bounds[std::min((2 * pair + 2) * width, parts)];
+      std::merge(keys.data() + lo, keys.data() + mid, keys.data() + mid, keys.data() + hi,
+                 tmp.data() + lo);
+    });
+    keys.swap(tmp);
+  }
+}
+
+template <class T>
+void reorder_items(array_t *arr, const std::vector<T> &keys, int dir) {
+  size_t n = keys.size();
+  std::vector<svalue_t> items(arr->item, arr->item + n);
+
+  for (size_t i = 0; i < n; i++) {
+    arr->item[dir < 0 ? n - 1 - i : i] = items[keys[i].idx];
+  }
+}
+
+/* Returns 0 if the items don't all have one of the types handled here. */
+int sort_homogeneous(array_t *arr, int dir) {
+  size_t n = arr->size;
+  auto type = arr->item[0].type;
+
+  if (type != T_NUMBER && type != T_REAL && type != T_STRING) {
+    return 0;
+  }
+  for (size_t i = 1; i < n; i++) {
+    if (arr->item[i].type != type) {
+      return 0;
+    }
+  }
+
+  if (type == T_STRING) {
+    std::vector<str_key_t> keys(n);
+    for (size_t i = 0; i < n; i++) {
+      auto &k = keys[i];
+      k.str = arr->item[i].u.string;
+      k.len = SVALUE_STRLEN(&arr->item[i]);
+      k.idx = i;
+      k.prefix = 0;
+      for (uint32_t j = 0; j < 8; j++) {
+        k.prefix <<= 8;
+        if (j < k.len) {
+          k.prefix |= static_cast<unsigned char>(k.str[j]);
+        }
+      }
+    }
+    sort_keys(keys, sort_str_keys);
+    reorder_items(arr, keys, dir);
+    return 1;
+  }
+
+  std::vector<num_key_t> keys(n);
+  for (size_t i = 0; i < n; i++) {
+    uint64_t bits;
+    if (type == T_NUMBER) {
+      bits = static_cast<uint64_t>(arr->item[i].u.number) ^ (1ULL << 63);
+    } else {
+      /* flip negative floats entirely, so they order as unsigned ints */
+      memcpy(&bits, &arr->item[i].u.real, sizeof(bits));
+      bits = (bits & (1ULL << 63)) ? ~bits : bits | (1ULL << 63);
+    }
+    keys[i].key = bits;
+    keys[i].idx = i;
+  }
+  sort_keys(keys, radix_sort);
+  reorder_items(arr, keys, dir);
+  return 1;
+}
+}  // namespace
+
 array_t *builtin_sort_array(array_t *inlist, int dir) {
+  if (inlist->size < 2 || sort_homogeneous(inlist, dir)) {
+    return inlist;
+  }
   qsort(reinterpret_cast<char *>(inlist->item), inlist->size, sizeof(inlist->item),
         (dir < 0) ? builtin_sort_array_cmp_rev : builtin_sort_array_cmp_fwd);
 
@@ -1299,6 +1492,16 @@ static int deep_inventory_count(object_t *ob) {
   return cnt;
 }
 
+/* The objects deep_inventory_count() would find, without the walk when none are hidden */
+static int deep_inventory_size(object_t *ob) {
+#ifdef F_SET_HIDE
+  if (ob->deep_hidden) {
+    return deep_inventory_count(ob);
+  }
+#endif
+  return ob->deep_count;
+}
+
 static void deep_inventory_collect(object_t *ob, array_t *inv, int *i, int max, funptr_t *fp) {
   object_t *cur, *next;
   svalue_t *fp_result;
@@ -1362,7 +1565,7 @@ array_t *deep_inventory(object_t *ob, int take_top, funptr_t *fp) {
    * count visible objects in an object's inventory, and in their
    * inventory, etc
    */
-  i = deep_inventory_count(ob);
+  i = deep_inventory_size(ob);
   if (take_top) {
     i++;
   }
@@ -1434,7 +1637,7 @@ array_t *deep_inventory_array(array_t *arr, int take_top, funptr_t *fp) {
   i = 0;
   for (c = 0; c < arr->size; c++) {
     if (arr->item[c].type == T_OBJECT) {
-      i += deep_inventory_count(arr->item[c].u.ob);
+      i += deep_inventory_size(arr->item[c].u.ob);
       if (take_top) {
         i++;
       }
@@ -1495,123 +1698,228 @@ array_t *deep_inventory_array(array_t *arr, int take_top, funptr_t *fp) {
   sp--;  // get dinv of the stack but don't free it
   return dinv;
 }
+
+/*
+ * inventory_count() and inventory_find()
+ *
+ * Count or pick out the objects of an inventory that pass a filter, see
+ * include/inventory.h, without building the whole deep_inventory() first.
+ * An unfiltered deep count is the number every object keeps of what it
+ * contains.
+ */
+namespace {
+struct inventory_filter_t {
+  int flags;
+  program_t *prog;
+  bool see_hidden;
+};
+
+/* valid_hide() is asked up front, so no LPC code runs during the walk. */
+inventory_filter_t make_inventory_filter(object_t *ob, int flags, svalue_t *prog) {
+  inventory_filter_t f{flags, prog && prog->type == T_OBJECT ? prog->u.ob->prog : nullptr, true};
+#ifdef F_SET_HIDE
+  if (ob->deep_hidden) {
+    f.see_hidden = valid_hide(current_object);
+  }
 #endif
+  return f;
+}
 
-static long alist_cmp(svalue_t *p1, svalue_t *p2) {
-  long d;
+bool inventory_match(object_t *ob, const inventory_filter_t &f) {
+#ifndef NO_ADD_ACTION
+  if ((f.flags & INV_LIVING) && !(ob->flags & O_ENABLE_COMMANDS)) {
+    return false;
+  }
+#else
+  if (f.flags & INV_LIVING) {
+    return false;
+  }
+#endif
+  if ((f.flags & INV_INTERACTIVE) && !ob->interactive) {
+    return false;
+  }
+  return !f.prog || ob->prog == f.prog;
+}
 
-  if ((d = p1->u.number - p2->u.number)) {
-    if (d == LONG_MIN) {
-      d = p1->u.number > p2->u.number;
+/* Calls fn for every match, in deep_inventory() order, until it returns false. */
+template <typename F>
+bool inventory_walk(object_t *ob, const inventory_filter_t &f, F &fn) {
+  for (auto cur = ob->contains; cur; cur = cur->next_inv) {
+#ifdef F_SET_HIDE
+    if ((cur->flags & O_HIDDEN) && !f.see_hidden) {
+      continue;
+    }
+#endif
+    if (inventory_match(cur, f) && !fn(cur)) {
+      return false;
+    }
+    if ((f.flags & INV_DEEP) && cur->contains && !inventory_walk(cur, f, fn)) {
+      return false;
     }
-    return d;
   }
-  if ((d = p1->type - p2->type)) {
-    return d;
+  return true;
+}
+}  // namespace
+
+#ifdef F_INVENTORY_COUNT
+void f_inventory_count(void) {
+  int num_arg = st_num_arg;
+  svalue_t *arg = sp - num_arg + 1;
+  object_t *ob = arg[0].u.ob;
+  auto f = make_inventory_filter(ob, arg[1].u.number, num_arg > 2 ? arg + 2 : nullptr);
+  LPC_INT count = 0;
+
+  if (f.flags == INV_DEEP && !f.prog && f.see_hidden) {
+    count = ob->deep_count;
+  } else {
+    auto counter = [&count](object_t *) {
+      count++;
+      return true;
+    };
+    inventory_walk(ob, f, counter);
   }
-  return 0;
+  pop_n_elems(num_arg);
+  push_number(count);
 }
+#endif
 
-static svalue_t *alist_sort(array_t *inlist) {
-  long size, j, curix, parix, child1, child2, flag;
-  svalue_t *sv_tab, *tmp, *table, *sv_ptr, val;
-  char *str;
-
-  if (!(size = inlist->size)) {
-    return (svalue_t *)NULL;
-  }
-  if ((flag = (inlist->ref > 1))) {
-    sv_tab = reinterpret_cast<svalue_t *>(
-        DCALLOC(size, sizeof(svalue_t), TAG_TEMPORARY, "alist_sort: sv_tab"));
-    sv_ptr = inlist->item;
-    for (j = 0; j < size; j++) {
-      if (((tmp = (sv_ptr + j))->type == T_OBJECT) && (tmp->u.ob->flags & O_DESTRUCTED)) {
-        free_object(&tmp->u.ob, "alist_sort");
-        sv_tab[j] = *tmp = const0u;
-      } else if ((tmp->type == T_STRING) && !(tmp->subtype == STRING_SHARED)) {
-        sv_tab[j].u.string = make_shared_string(tmp->u.string);
-        (tmp = sv_tab + j)->subtype = STRING_SHARED;
-        tmp->type = T_STRING;
-      } else {
-        assign_svalue_no_free(sv_tab + j, tmp);
-      }
+#ifdef F_INVENTORY_FIND
+void f_inventory_find(void) {
+  auto max_array_size = CONFIG_INT(__MAX_ARRAY_SIZE__);
+  int num_arg = st_num_arg;
+  svalue_t *arg = sp - num_arg + 1;
+  object_t *ob = arg[0].u.ob;
+  auto f = make_inventory_filter(ob, arg[1].u.number, num_arg > 3 ? arg + 3 : nullptr);
+  LPC_INT max = arg[2].u.number;
+  std::vector<object_t *> found;
+  array_t *vec;
+
+  if (max <= 0 || max > max_array_size) {
+    max = max_array_size;
+  }
+  auto collect = [&found, max](object_t *cur) {
+    found.push_back(cur);
+    return static_cast<LPC_INT>(found.size()) < max;
+  };
+  inventory_walk(ob, f, collect);
+
+  vec = allocate_empty_array(found.size());
+  for (size_t i = 0; i < found.size(); i++) {
+    vec->item[i].type = T_OBJECT;
+    vec->item[i].u.ob = found[i];
+    add_ref(found[i], "inventory_find");
+  }
+  pop_n_elems(num_arg);
+  push_refed_array(vec);
+}
+#endif
+#endif
 
-      if ((curix = j)) {
-        val = *tmp;
+namespace {
+/*
+ * Below this many items a plain scan is fastest, and up to kSetSortMax a
+ * binary search in a sorted copy still beats building a hash table.
+ */
+const int kSetScanMax = 16;
+const int kSetSortMax = 512;
 
-        do {
-          parix = (curix - 1) >> 1;
-          if (alist_cmp(sv_tab + parix, sv_tab + curix) > 0) {
-            sv_tab[curix] = sv_tab[parix];
-            sv_tab[parix] = val;
-          }
-        } while ((curix = parix));
-      }
+/*
+ * Membership for the array operators: the same type and either the same
+ * string or the same bits, so 1 and 1.0 are different elements.
+ */
+struct set_equal_t {
+  bool operator()(const svalue_t *p1, const svalue_t *p2) const {
+    if (p1->type != p2->type) {
+      return false;
     }
-  } else {
-    sv_tab = inlist->item;
-    for (j = 0; j < size; j++) {
-      if (((tmp = (sv_tab + j))->type == T_OBJECT) && (tmp->u.ob->flags & O_DESTRUCTED)) {
-        free_object(&tmp->u.ob, "alist_sort");
-        *tmp = const0u;
-      } else if ((tmp->type == T_STRING) && !(tmp->subtype == STRING_SHARED)) {
-        str = make_shared_string(tmp->u.string);
-        free_string_svalue(tmp);
-        tmp->u.string = str;
-        tmp->subtype = STRING_SHARED;
-      }
-
-      if ((curix = j)) {
-        val = *tmp;
+    if (p1->type == T_STRING) {
+      return p1->u.string == p2->u.string ||
+             (!SVALUE_STRLEN_DIFFERS(p1, p2) && !strcmp(p1->u.string, p2->u.string));
+    }
+    return p1->u.number == p2->u.number;
+  }
+};
 
-        do {
-          parix = (curix - 1) >> 1;
-          if (alist_cmp(sv_tab + parix, sv_tab + curix) > 0) {
-            sv_tab[curix] = sv_tab[parix];
-            sv_tab[parix] = val;
-          }
-        } while ((curix = parix));
-      }
+struct set_hash_t {
+  size_t operator()(const svalue_t *sv) const {
+    if (sv->type == T_STRING) {
+      return whashstr(sv->u.string);
     }
+    return std::hash<LPC_INT>()(sv->u.number) ^ sv->type;
   }
+};
 
-  table = reinterpret_cast<svalue_t *>(
-      DCALLOC(size, sizeof(svalue_t), TAG_TEMPORARY, "alist_sort: table"));
+/*
+ * Sort key for the binary search: strings go by their hash, so a lookup
+ * only compares numbers until it lands on a candidate.
+ */
+struct set_key_t {
+  int type;
+  LPC_INT bits;
+  const svalue_t *sv;
 
-  for (j = 0; j < size; j++) {
-    table[j] = sv_tab[0];
+  explicit set_key_t(const svalue_t *v)
+      : type(v->type), bits(v->type == T_STRING ? whashstr(v->u.string) : v->u.number), sv(v) {}
 
-    for (curix = 0;;) {
-      child1 = (curix << 1) + 1;
-      child2 = child1 + 1;
+  bool operator<(const set_key_t &other) const {
+    return type < other.type || (type == other.type && bits < other.bits);
+  }
+};
 
-      if (child2 < size && sv_tab[child2].type != T_INVALID &&
-          (sv_tab[child1].type == T_INVALID || alist_cmp(sv_tab + child1, sv_tab + child2) > 0)) {
-        child1 = child2;
+/* The elements of an array, looked up by value. */
+class svalue_set_t {
+ public:
+  svalue_set_t(const svalue_t *items, int n) : items_(items), n_(n) {
+    if (n > kSetSortMax) {
+      table_.reserve(n);
+      for (int i = 0; i < n; i++) {
+        table_.insert(items + i);
       }
-      if (child1 < size && sv_tab[child1].type != T_INVALID) {
-        sv_tab[curix] = sv_tab[child1];
-        curix = child1;
-      } else {
-        break;
+    } else if (n > kSetScanMax) {
+      sorted_.reserve(n);
+      for (int i = 0; i < n; i++) {
+        sorted_.emplace_back(items + i);
       }
+      std::sort(sorted_.begin(), sorted_.end());
     }
-
-    sv_tab[curix].type = T_INVALID;
   }
 
-  if (flag) {
-    FREE((char *)sv_tab);
+  bool contains(const svalue_t *sv) const {
+    if (n_ > kSetSortMax) {
+      return table_.count(sv) != 0;
+    }
+    if (n_ > kSetScanMax) {
+      set_key_t key(sv);
+      for (auto it = std::lower_bound(sorted_.begin(), sorted_.end(), key);
+           it != sorted_.end() && !(key < *it); ++it) {
+        if (set_equal_t()(it->sv, sv)) {
+          return true;
+        }
+      }
+      return false;
+    }
+    for (int i = 0; i < n_; i++) {
+      if (set_equal_t()(items_ + i, sv)) {
+        return true;
+      }
+    }
+    return false;
   }
-  return table;
-}
+
+ private:
+  const svalue_t *items_;
+  int n_;
+  std::vector<set_key_t> sorted_;
+  std::unordered_set<const svalue_t *, set_hash_t, set_equal_t> table_;
+};
+}  // namespace
 
 array_t *subtract_array(array_t *minuend, array_t *subtrahend) {
   array_t *difference;
-  svalue_t *source, *dest, *svt;
-  long i, size, o, d, l, h, msize;
+  svalue_t *dest;
+  int i, msize;
 
-  if (!(size = subtrahend->size)) {
+  if (!subtrahend->size) {
     subtrahend->ref--;
     return minuend->ref > 1 ? (minuend->ref--, copy_array(minuend)) : minuend;
   }
@@ -1619,66 +1927,28 @@ array_t *subtract_array(array_t *minuend, array_t *subtrahend) {
     free_array(subtrahend);
     return &the_null_array;
   }
-  svt = alist_sort(subtrahend);
+  check_for_destr(minuend);
+  check_for_destr(subtrahend);
   difference = ALLOC_ARRAY(msize);
-  for (source = minuend->item, dest = difference->item, i = msize; i--; source++) {
-    l = 0;
-    o = (h = size - 1) >> 1;
-
-    if ((source->type == T_OBJECT) && (source->u.ob->flags & O_DESTRUCTED)) {
-      free_object(&source->u.ob, "subtract_array");
-      *source = const0u;
-    } else if ((source->type == T_STRING) && !(source->subtype == STRING_SHARED)) {
-      svalue_t stmp = {T_STRING, STRING_SHARED};
-
-      if (!(stmp.u.string = findstring(source->u.string))) {
-        assign_svalue_no_free(dest++, source);
-        continue;
-      }
-      while ((d = alist_cmp(&stmp, svt + o))) {
-        if (d < 0) {
-          h = o - 1;
-        } else {
-          l = o + 1;
-        }
-        if (l > h) {
-          assign_svalue_no_free(dest++, source);
-          break;
-        }
-        o = (l + h) >> 1;
-      }
-      continue;
-    }
+  dest = difference->item;
+  {
+    svalue_set_t set(subtrahend->item, subtrahend->size);
 
-    while ((d = alist_cmp(source, svt + o))) {
-      if (d < 0) {
-        h = o - 1;
-      } else {
-        l = o + 1;
+    for (i = 0; i < msize; i++) {
+      if (!set.contains(minuend->item + i)) {
+        assign_svalue_no_free(dest++, minuend->item + i);
       }
-      if (l > h) {
-        assign_svalue_no_free(dest++, source);
-        break;
-      }
-      o = (l + h) >> 1;
     }
   }
-  i = size;
-  while (i--) {
-    free_svalue(svt + i, "subtract_array");
-  }
-  FREE((char *)svt);
-  free_empty_array(subtrahend);
+  free_array(subtrahend);
   free_array(minuend);
-  msize = dest - difference->item;
-  return fix_array(difference, msize);
+  return fix_array(difference, msize, dest - difference->item);
 }
 
+/* The items of a2 that are also in a1, in the order of a2. */
 array_t *intersect_array(array_t *a1, array_t *a2) {
   array_t *a3;
-  long d, l, j, i, a1s = a1->size, a2s = a2->size, flag;
-  svalue_t *svt_1, *ntab, *sv_tab, *sv_ptr, val, *tmp;
-  long curix, parix, child1, child2;
+  int j, l, a1s = a1->size, a2s = a2->size;
 
   if (!a1s || !a2s) {
     free_array(a1);
@@ -1686,139 +1956,31 @@ array_t *intersect_array(array_t *a1, array_t *a2) {
     return &the_null_array;
   }
 
-  svt_1 = alist_sort(a1);
-  if ((flag = (a2->ref > 1))) {
-    sv_tab = reinterpret_cast<svalue_t *>(
-        DCALLOC(a2s, sizeof(svalue_t), TAG_TEMPORARY, "intersect_array: sv2_tab"));
-    sv_ptr = a2->item;
-    for (j = 0; j < a2s; j++) {
-      if (((tmp = (sv_ptr + j))->type == T_OBJECT) && (tmp->u.ob->flags & O_DESTRUCTED)) {
-        free_object(&tmp->u.ob, "intersect_array");
-        sv_tab[j] = *tmp = const0u;
-      } else if ((tmp->type == T_STRING) && !(tmp->subtype == STRING_SHARED)) {
-        sv_tab[j].u.string = make_shared_string(tmp->u.string);
-        (tmp = sv_tab + j)->subtype = STRING_SHARED;
-        tmp->type = T_STRING;
-      } else {
-        assign_svalue_no_free(sv_tab + j, tmp);
-      }
-
-      if ((curix = j)) {
-        val = *tmp;
-
-        do {
-          parix = (curix - 1) >> 1;
-          if (alist_cmp(sv_tab + parix, sv_tab + curix) > 0) {
-            sv_tab[curix] = sv_tab[parix];
-            sv_tab[parix] = val;
-          }
-        } while ((curix = parix));
-      }
-    }
-  } else {
-    char *str;
-
-    sv_tab = a2->item;
-    for (j = 0; j < a2s; j++) {
-      if (((tmp = (sv_tab + j))->type == T_OBJECT) && (tmp->u.ob->flags & O_DESTRUCTED)) {
-        free_object(&tmp->u.ob, "alist_sort");
-        *tmp = const0u;
-      } else if ((tmp->type == T_STRING) && !(tmp->subtype == STRING_SHARED)) {
-        str = make_shared_string(tmp->u.string);
-        free_string_svalue(tmp);
-        tmp->u.string = str;
-        tmp->subtype = STRING_SHARED;
-      }
-
-      if ((curix = j)) {
-        val = *tmp;
-
-        do {
-          parix = (curix - 1) >> 1;
-          if (alist_cmp(sv_tab + parix, sv_tab + curix) > 0) {
-            sv_tab[curix] = sv_tab[parix];
-            sv_tab[parix] = val;
-          }
-        } while ((curix = parix));
-      }
-    }
-  }
-
+  check_for_destr(a1);
+  check_for_destr(a2);
   a3 = ALLOC_ARRAY(a2s);
-  ntab = a3->item;
-
-  l = i = 0;
-
-  for (j = 0; j < a2s; j++) {
-    val = sv_tab[0];
-
-    while ((d = alist_cmp(&val, &svt_1[i])) > 0) {
-      if (++i >= a1s) {
-        goto settle_business;
-      }
-    }
-
-    if (!d) {
-      ntab[l++] = val;
-    } else {
-      free_svalue(&val, "intersect_array");
-    }
+  l = 0;
+  {
+    svalue_set_t set(a1->item, a1s);
 
-    for (curix = 0;;) {
-      child1 = (curix << 1) + 1;
-      child2 = child1 + 1;
-
-      if (child2 < a2s && sv_tab[child2].type != T_INVALID &&
-          (sv_tab[child1].type == T_INVALID || alist_cmp(sv_tab + child1, sv_tab + child2) > 0)) {
-        child1 = child2;
-      }
-
-      if (child1 < a2s && sv_tab[child1].type != T_INVALID) {
-        sv_tab[curix] = sv_tab[child1];
-        curix = child1;
-      } else {
-        break;
+    for (j = 0; j < a2s; j++) {
+      if (set.contains(a2->item + j)) {
+        assign_svalue_no_free(a3->item + l++, a2->item + j);
       }
     }
-
-    sv_tab[curix].type = T_INVALID;
-  }
-
-settle_business:
-
-  curix = a2s;
-  while (curix--) {
-    if (sv_tab[curix].type != T_INVALID) {
-      free_svalue(sv_tab + curix, "intersect_array:2");
-    }
-  }
-
-  i = a1s;
-  while (i--) {
-    free_svalue(svt_1 + i, "intersect_array");
   }
-  FREE((char *)svt_1);
-
-  free_empty_array(a1);
-
-  if (flag) {
-    a2->ref--;
-    FREE((char *)sv_tab);
-  } else {
-    dealloc_empty_array(a2);
-  }
-
-  return fix_array(a3, l);
+  free_array(a1);
+  free_array(a2);
+  return fix_array(a3, a2s, l);
 }
 
+/* a1 followed by the items of a2 that are not in a1. */
 array_t *union_array(array_t *a1, array_t *a2) {
   auto max_array_size = CONFIG_INT(__MAX_ARRAY_SIZE__);
 
   int a1s = a1->size, a2s = a2->size;
-  long d, l, j, i, cnt, flag;
+  long d, l, j;
   array_t *a3; /* destination */
-  svalue_t *svt_1, *ntab, *sv_tab, *tmp, *sv_ptr, val;
-  long curix, parix, child1, child2;
 
   if (a1s == 0) {
     a1->ref--;
@@ -1834,128 +1996,23 @@ array_t *union_array(array_t *a1, array_t *a2) {
   if (d < 0 || d > max_array_size) {
     error("result of array union could be greater than maximum array size.\n");
   }
+  check_for_destr(a1);
+  check_for_destr(a2);
   a3 = int_allocate_empty_array(d);
-  tmp = a1->item;
-  ntab = a3->item;
-  l = cnt = a1s;
-  while (cnt--) {
-    assign_svalue_no_free(ntab + cnt, tmp + cnt);
-  }
-
-  svt_1 = alist_sort(a1);
-  if ((flag = (a2->ref > 1))) {
-    sv_tab = reinterpret_cast<svalue_t *>(
-        DCALLOC(a2s, sizeof(svalue_t), TAG_TEMPORARY, "union_array: sv2_tab"));
-    sv_ptr = a2->item;
-    for (j = 0; j < a2s; j++) {
-      if (((tmp = (sv_ptr + j))->type == T_OBJECT) && (tmp->u.ob->flags & O_DESTRUCTED)) {
-        free_object(&tmp->u.ob, "union_array");
-        sv_tab[j] = *tmp = const0u;
-      } else if ((tmp->type == T_STRING) && !(tmp->subtype == STRING_SHARED)) {
-        sv_tab[j].u.string = make_shared_string(tmp->u.string);
-        (tmp = sv_tab + j)->subtype = STRING_SHARED;
-        tmp->type = T_STRING;
-      } else {
-        assign_svalue_no_free(sv_tab + j, tmp);
-      }
-
-      if ((curix = j)) {
-        val = *tmp;
-
-        do {
-          parix = (curix - 1) >> 1;
-          if (alist_cmp(sv_tab + parix, sv_tab + curix) > 0) {
-            sv_tab[curix] = sv_tab[parix];
-            sv_tab[parix] = val;
-          }
-        } while ((curix = parix));
-      }
-    }
-  } else {
-    char *str;
-
-    sv_tab = a2->item;
-    for (j = 0; j < a2s; j++) {
-      if (((tmp = (sv_tab + j))->type == T_OBJECT) && (tmp->u.ob->flags & O_DESTRUCTED)) {
-        free_object(&tmp->u.ob, "union_array");
-        *tmp = const0u;
-      } else if ((tmp->type == T_STRING) && !(tmp->subtype == STRING_SHARED)) {
-        str = make_shared_string(tmp->u.string);
-        free_string_svalue(tmp);
-        tmp->u.string = str;
-        tmp->subtype = STRING_SHARED;
-      }
-
-      if ((curix = j)) {
-        val = *tmp;
-
-        do {
-          parix = (curix - 1) >> 1;
-          if (alist_cmp(sv_tab + parix, sv_tab + curix) > 0) {
-            sv_tab[curix] = sv_tab[parix];
-            sv_tab[parix] = val;
-          }
-        } while ((curix = parix));
-      }
-    }
+  for (l = 0; l < a1s; l++) {
+    assign_svalue_no_free(a3->item + l, a1->item + l);
   }
+  {
+    svalue_set_t set(a1->item, a1s);
 
-  i = 0;
-
-  for (j = 0; j < a2s; j++) {
-    val = sv_tab[0];
-
-    while (i < a1s && (d = alist_cmp(&val, &svt_1[i])) > 0) {
-      i++;
-    }
-
-    if (d) {
-      ntab[l++] = val;
-    } else {
-      free_svalue(&val, "union_array");
-    }
-
-    for (curix = 0;;) {
-      child1 = (curix << 1) + 1;
-      child2 = child1 + 1;
-
-      if (child2 < a2s && sv_tab[child2].type != T_INVALID &&
-          (sv_tab[child1].type == T_INVALID || alist_cmp(sv_tab + child1, sv_tab + child2) > 0)) {
-        child1 = child2;
-      }
-
-      if (child1 < a2s && sv_tab[child1].type != T_INVALID) {
-        sv_tab[curix] = sv_tab[child1];
-        curix = child1;
-      } else {
-        break;
+    for (j = 0; j < a2s; j++) {
+      if (!set.contains(a2->item + j)) {
+        assign_svalue_no_free(a3->item + l++, a2->item + j);
       }
     }
-
-    sv_tab[curix].type = T_INVALID;
-  }
-
-  curix = a2s;
-  while (curix--) {
-    if (sv_tab[curix].type != T_INVALID) {
-      free_svalue(sv_tab + curix, "union_array:2");
-    }
-  }
-
-  i = a1s;
-  while (i--) {
-    free_svalue(svt_1 + i, "union_array");
-  }
-  FREE((char *)svt_1);
-
-  free_empty_array(a1);
-
-  if (flag) {
-    a2->ref--;
-    FREE((char *)sv_tab);
-  } else {
-    dealloc_empty_array(a2);
   }
+  free_array(a1);
+  free_array(a2);
   a3 = resize_array(a3, l);
   a3->ref = 1;
 
@@ -62,12 +62,11 @@ array_t *union_array(array_t *, array_t *);
 array_t *copy_array(array_t *p);
 array_t *resize_array(array_t *p, unsigned int n);
 
-#define ALLOC_ARRAY(nelem)                                                            \
-  (array_t *) DCALLOC(sizeof(array_t) + sizeof(svalue_t) * (nelem - 1), 1, TAG_ARRAY, \
-                      "ALLOC_"                                                        \
-                      "ARRAY")
-#define RESIZE_ARRAY(vec, nelem) \
-  (array_t *)                    \
-      DREALLOC(vec, sizeof(array_t) + sizeof(svalue_t) * (nelem - 1), TAG_ARRAY, "RESIZE_ARRAY")
+#define ARRAY_BYTES(nelem) (sizeof(array_t) + sizeof(svalue_t) * ((nelem)-1))
+#define ALLOC_ARRAY(nelem) (array_t *) SLAB_CALLOC(ARRAY_BYTES(nelem), TAG_ARRAY, "ALLOC_ARRAY")
+#define RESIZE_ARRAY(vec, old_nelem, nelem) \
+  (array_t *)                                \
+      SLAB_REALLOC(vec, ARRAY_BYTES(old_nelem), ARRAY_BYTES(nelem), TAG_ARRAY, "RESIZE_ARRAY")
+#define FREE_ARRAY(vec, nelem) SLAB_FREE(vec, ARRAY_BYTES(nelem))
 
 #endif
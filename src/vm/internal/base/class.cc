@@ -2,6 +2,9 @@
 
 #include "vm/internal/base/machine.h"
 
+// A class with no members still gets room for one.
+#define CLASS_BYTES(n) ARRAY_BYTES((n) ? (n) : 1)
+
 void dealloc_class(array_t *p) {
   int i;
 
@@ -11,7 +14,7 @@ void dealloc_class(array_t *p) {
   for (i = p->size; i--;) {
     free_svalue(&p->item[i], "dealloc_class");
   }
-  FREE((char *)p);
+  SLAB_FREE(p, CLASS_BYTES(p->size));
 }
 
 void free_class(array_t *p) {
@@ -32,8 +35,7 @@ array_t *allocate_class(class_def_t *cld, int has_values) {
   num_classes++;
   total_class_size += sizeof(array_t) + sizeof(svalue_t) * (n - 1);
 
-  p = reinterpret_cast<array_t *>(
-      DMALLOC(sizeof(array_t) + sizeof(svalue_t) * (n - 1), TAG_CLASS, "allocate_class"));
+  p = reinterpret_cast<array_t *>(SLAB_ALLOC(ARRAY_BYTES(n), TAG_CLASS, "allocate_class"));
   n = cld->size;
   p->ref = 1;
   p->size = n;
@@ -55,8 +57,7 @@ array_t *allocate_class_by_size(int size) {
   num_classes++;
   total_class_size += sizeof(array_t) + sizeof(svalue_t) * (size - 1);
 
-  p = reinterpret_cast<array_t *>(
-      DMALLOC(sizeof(array_t) + sizeof(svalue_t) * (size - 1), TAG_CLASS, "allocate_class"));
+  p = reinterpret_cast<array_t *>(SLAB_ALLOC(CLASS_BYTES(size), TAG_CLASS, "allocate_class"));
   p->ref = 1;
   p->size = size;
 
@@ -73,8 +74,7 @@ array_t *allocate_empty_class_by_size(int size) {
   num_classes++;
   total_class_size += sizeof(array_t) + sizeof(svalue_t) * (size - 1);
 
-  p = reinterpret_cast<array_t *>(
-      DMALLOC(sizeof(array_t) + sizeof(svalue_t) * (size - 1), TAG_CLASS, "allocate_class"));
+  p = reinterpret_cast<array_t *>(SLAB_ALLOC(CLASS_BYTES(size), TAG_CLASS, "allocate_class"));
   p->ref = 1;
   p->size = size;
 
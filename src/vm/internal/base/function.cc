@@ -36,7 +36,7 @@ void dealloc_funp(funptr_t *fp) {
     }
   }
 
-  FREE(fp);
+  SLAB_FREE(fp, sizeof(funptr_t));
 }
 
 void free_funp(funptr_t *fp) {
@@ -95,7 +95,7 @@ int merge_arg_lists(int num_arg, array_t *arr, int start) {
 funptr_t *make_efun_funp(int opcode, svalue_t *args) {
   funptr_t *fp;
 
-  fp = reinterpret_cast<funptr_t *>(DMALLOC(sizeof(funptr_t), TAG_FUNP, "make_efun_funp"));
+  fp = reinterpret_cast<funptr_t *>(SLAB_ALLOC(sizeof(funptr_t), TAG_FUNP, "make_efun_funp"));
   fp->hdr.owner = current_object;
   add_ref(current_object, "make_efun_funp");
   fp->hdr.type = FP_EFUN;
@@ -123,8 +123,7 @@ funptr_t *make_lfun_funp(int index, svalue_t *args) {
         "replace_program()\n");
   }
 
-  fp = reinterpret_cast<funptr_t *>(
-      DMALLOC(sizeof(funptr_hdr_t) + sizeof(local_ptr_t), TAG_FUNP, "make_lfun_funp"));
+  fp = reinterpret_cast<funptr_t *>(SLAB_ALLOC(sizeof(funptr_t), TAG_FUNP, "make_lfun_funp"));
   fp->hdr.owner = current_object;
   add_ref(current_object, "make_lfun_funp");
   fp->hdr.type = FP_LOCAL | FP_NOT_BINDABLE;
@@ -153,8 +152,7 @@ funptr_t *make_lfun_funp(int index, svalue_t *args) {
 funptr_t *make_simul_funp(int index, svalue_t *args) {
   funptr_t *fp;
 
-  fp = reinterpret_cast<funptr_t *>(
-      DMALLOC(sizeof(funptr_hdr_t) + sizeof(simul_ptr_t), TAG_FUNP, "make_simul_funp"));
+  fp = reinterpret_cast<funptr_t *>(SLAB_ALLOC(sizeof(funptr_t), TAG_FUNP, "make_simul_funp"));
   fp->hdr.owner = current_object;
   add_ref(current_object, "make_simul_funp");
   fp->hdr.type = FP_SIMUL;
@@ -182,8 +180,7 @@ funptr_t *make_functional_funp(short num_arg, short num_local, short len, svalue
         "replace_program()\n");
   }
 
-  fp = reinterpret_cast<funptr_t *>(
-      DMALLOC(sizeof(funptr_hdr_t) + sizeof(functional_t), TAG_FUNP, "make_functional_funp"));
+  fp = reinterpret_cast<funptr_t *>(SLAB_ALLOC(sizeof(funptr_t), TAG_FUNP, "make_functional_funp"));
   fp->hdr.owner = current_object;
   add_ref(current_object, "make_functional_funp");
   fp->hdr.type = FP_FUNCTIONAL + flag;
@@ -133,12 +133,12 @@ void kill_ref(ref_t *ref) {
     ref->prev = ref;  // so it doesn't get set to the global list above
     ref->next = ref;
   } else {
-    FREE(ref);
+    SLAB_FREE(ref, sizeof(ref_t));
   }
 }
 
 ref_t *make_ref(void) {
-  ref_t *ref = reinterpret_cast<ref_t *>(DMALLOC(sizeof(ref_t), TAG_TEMPORARY, "make_ref"));
+  ref_t *ref = reinterpret_cast<ref_t *>(SLAB_ALLOC(sizeof(ref_t), TAG_TEMPORARY, "make_ref"));
   ref->next = global_ref_list;
   ref->prev = NULL;
   if (ref->next) {
@@ -361,7 +361,7 @@ void free_string_svalue(svalue_t *v) {
         CHECK_STRING_STATS;
       } else {
         SUB_NEW_STRING(size, sizeof(malloc_block_t));
-        FREE(MSTR_BLOCK(str));
+        free_mstr_block(MSTR_BLOCK(str));
         CHECK_STRING_STATS;
       }
     } else {
@@ -2550,7 +2550,13 @@ void eval_instruction(char *p) {
           /* mapping */
           if ((sp - 2)->subtype--) {
             svalue_t *key = (sp - 2)->u.lvalue++;
-            svalue_t *value = find_in_mapping((sp - 4)->u.map, key);
+            svalue_t *value;
+
+            /* a ref writes straight into the node */
+            if (sp->type == T_REF && (sp - 4)->u.map->share_next) {
+              unshare_mapping((sp - 4)->u.map);
+            }
+            value = find_in_mapping((sp - 4)->u.map, key);
 
             assign_svalue((sp - 1)->u.lvalue, key);
             if (sp->type == T_REF) {
@@ -2599,7 +2605,7 @@ void eval_instruction(char *p) {
 #endif
         if (sp->type == T_REF) {
           if (!(--sp->u.ref->ref) && sp->u.ref->lvalue == 0) {
-            FREE(sp->u.ref);
+            SLAB_FREE(sp->u.ref, sizeof(ref_t));
           }
         }
         if ((sp - 1)->type == T_LVALUE) {
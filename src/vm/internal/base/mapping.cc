@@ -95,6 +95,26 @@ int growMap(mapping_t *m) {
   return 1;
 }
 
+/*
+ * A mapping copied with share_mapping() keeps using the hash table and nodes
+ * of the one it was copied from, until one of them is about to change.
+ * share_next links all the mappings on one table into a ring; it is 0 for a
+ * mapping that has its table to itself.  Everything that changes a table
+ * calls unshare_mapping() first, which gives the mapping a table of its own.
+ */
+static void unlink_shared(mapping_t *m) {
+  mapping_t *prev = m->share_next;
+
+  while (prev->share_next != m) {
+    prev = prev->share_next;
+  }
+  prev->share_next = m->share_next;
+  if (prev->share_next == prev) {
+    prev->share_next = 0;
+  }
+  m->share_next = 0;
+}
+
 /*
   mapTraverse: iterate over the mapping, calling function 'func(elt, extra)'
   for each element 'elt'.  This is an attempt to encapsulate some of the
@@ -125,6 +145,17 @@ mapping_t *mapTraverse(mapping_t *m, int (*func)(mapping_t *, mapping_node_t *,
 void dealloc_mapping(mapping_t *m) {
   debug(mapping, "mapping.c: actual free of %p\n", (void *)m);
   num_mappings--;
+  if (m->share_next) {
+    /* the others keep the table */
+    unlink_shared(m);
+    num_shared_mappings--;
+    total_mapping_size -= sizeof(mapping_t);
+#ifdef PACKAGE_MUDLIB_STATS
+    add_array_size(&m->stats, -(MAP_COUNT(m) << 1));
+#endif
+    SLAB_FREE(m, sizeof(mapping_t));
+    return;
+  }
   {
     int j = m->table_size, c = MAP_COUNT(m);
     mapping_node_t *elt, *nelt, **a = m->table;
@@ -149,7 +180,7 @@ void dealloc_mapping(mapping_t *m) {
   }
 
   debug(mapping, ("in free_mapping: after table\n"));
-  FREE((char *)m);
+  SLAB_FREE(m, sizeof(mapping_t));
   debug(mapping, ("in free_mapping: after m\n"));
   debug(mapping, ("mapping.c: free_mapping end\n"));
 }
@@ -245,8 +276,8 @@ mapping_t *allocate_mapping(int n) {
   if (n > MAX_MAPPING_SIZE) {
     n = MAX_MAPPING_SIZE;
   }
-  newmap =
-      reinterpret_cast<mapping_t *>(DMALLOC(sizeof(mapping_t), TAG_MAPPING, "allocate_mapping: 1"));
+  newmap = reinterpret_cast<mapping_t *>(
+      SLAB_ALLOC(sizeof(mapping_t), TAG_MAPPING, "allocate_mapping: 1"));
   debug(mapping, "mapping.c: allocate_mapping begin, newmap = %p\n", (void *)newmap);
   if (newmap == NULL) {
     error("Allocate_mapping - out of memory.\n");
@@ -275,6 +306,7 @@ mapping_t *allocate_mapping(int n) {
   total_mapping_size += sizeof(mapping_t) + n;
   newmap->ref = 1;
   newmap->count = 0;
+  newmap->share_next = 0;
 #ifdef PACKAGE_MUDLIB_STATS
   if (current_object) {
     assign_stats(&newmap->stats, current_object);
@@ -332,13 +364,31 @@ mapping_t *mkmapping(array_t *k, array_t *v) {
   copyMapping: make a copy of a mapping
 */
 
+static void copy_nodes(mapping_node_t **c, mapping_node_t **b, int k) {
+  mapping_node_t *elt, *nelt, **a;
+
+  while (k--) {
+    if ((elt = b[k])) {
+      a = c + k;
+      do {
+        nelt = new_map_node();
+
+        assign_svalue_no_free(nelt->values, elt->values);
+        assign_svalue_no_free(nelt->values + 1, elt->values + 1);
+        nelt->next = *a;
+        *a = nelt;
+      } while ((elt = elt->next));
+    }
+  }
+}
+
 static mapping_t *copyMapping(mapping_t *m) {
   mapping_t *newmap;
   int k = m->table_size;
-  mapping_node_t *elt, *nelt, **a, **b = m->table, **c;
+  mapping_node_t **b = m->table, **c;
 
   newmap =
-      reinterpret_cast<mapping_t *>(DMALLOC(sizeof(mapping_t), TAG_MAPPING, "copy_mapping: 1"));
+      reinterpret_cast<mapping_t *>(SLAB_ALLOC(sizeof(mapping_t), TAG_MAPPING, "copy_mapping: 1"));
   if (newmap == NULL) {
     error("copyMapping - out of memory.\n");
   }
@@ -348,10 +398,11 @@ static mapping_t *copyMapping(mapping_t *m) {
   c = newmap->table = reinterpret_cast<mapping_node_t **>(
       DCALLOC(k, sizeof(mapping_node_t *), TAG_MAP_TBL, "copy_mapping: 2"));
   if (!c) {
-    FREE((char *)newmap);
+    SLAB_FREE(newmap, sizeof(mapping_t));
     error("copyMapping 2 - out of memory.\n");
   }
-  newmap->count = m->count;
+  newmap->count = m->count & ~MAP_LOCKED;
+  newmap->share_next = 0;
   total_mapping_nodes += MAP_COUNT(m);
   memset(c, 0, k * sizeof(mapping_node_t *));
   total_mapping_size +=
@@ -366,22 +417,75 @@ static mapping_t *copyMapping(mapping_t *m) {
   }
 #endif
   num_mappings++;
-  while (k--) {
-    if ((elt = b[k])) {
-      a = c + k;
-      do {
-        nelt = new_map_node();
+  copy_nodes(c, b, k);
+  return newmap;
+}
 
-        assign_svalue_no_free(nelt->values, elt->values);
-        assign_svalue_no_free(nelt->values + 1, elt->values + 1);
-        nelt->next = *a;
-        *a = nelt;
-      } while ((elt = elt->next));
-    }
+mapping_t *share_mapping(mapping_t *m) {
+  mapping_t *newmap;
+
+  /* a ref may point into the nodes, so writes wouldn't be noticed */
+  if ((m->count & MAP_LOCKED) || global_ref_list) {
+    return copyMapping(m);
+  }
+  newmap =
+      reinterpret_cast<mapping_t *>(SLAB_ALLOC(sizeof(mapping_t), TAG_MAPPING, "share_mapping"));
+  if (newmap == NULL) {
+    error("share_mapping - out of memory.\n");
+  }
+  newmap->ref = 1;
+  newmap->table = m->table;
+  newmap->table_size = m->table_size;
+  newmap->unfilled = m->unfilled;
+  newmap->count = m->count;
+  newmap->share_next = m->share_next ? m->share_next : m;
+  m->share_next = newmap;
+  total_mapping_size += sizeof(mapping_t);
+#ifdef PACKAGE_MUDLIB_STATS
+  if (current_object) {
+    assign_stats(&newmap->stats, current_object);
+    add_array_size(&newmap->stats, MAP_COUNT(m) << 1);
+  } else {
+    null_stats(&newmap->stats);
   }
+#endif
+  num_mappings++;
+  num_shared_mappings++;
   return newmap;
 }
 
+void unshare_mapping(mapping_t *m) {
+  int k = m->table_size + 1;
+  mapping_node_t **b = m->table, **c;
+
+  c = reinterpret_cast<mapping_node_t **>(
+      DCALLOC(k, sizeof(mapping_node_t *), TAG_MAP_TBL, "unshare_mapping"));
+  if (!c) {
+    error("unshare_mapping - out of memory.\n");
+  }
+  unlink_shared(m);
+  num_shared_mappings--;
+  m->table = c;
+  total_mapping_nodes += MAP_COUNT(m);
+  total_mapping_size += sizeof(mapping_node_t *) * k + sizeof(mapping_node_t) * MAP_COUNT(m);
+  copy_nodes(c, b, k);
+}
+
+#ifdef DEBUGMALLOC_EXTENSIONS
+/* Whether checkmemory() should count m's table and nodes: only one of the
+ * mappings sharing them does. */
+int mapping_owns_table(mapping_t *m) {
+  mapping_t *other;
+
+  for (other = m->share_next; other && other != m; other = other->share_next) {
+    if (other < m) {
+      return 0;
+    }
+  }
+  return 1;
+}
+#endif
+
 int restore_hash_string(char **val, svalue_t *sv) {
   char *cp = *val;
   char c, *start = cp;
@@ -475,6 +579,9 @@ int msameval(svalue_t *arg1, svalue_t *arg2) {
 */
 
 void mapping_delete(mapping_t *m, svalue_t *lv) {
+  if (m->share_next) {
+    unshare_mapping(m);
+  }
   int i = svalue_to_int(lv) & m->table_size;
   mapping_node_t **prev = m->table + i, *elt;
 
@@ -506,6 +613,9 @@ void mapping_delete(mapping_t *m, svalue_t *lv) {
  */
 
 svalue_t *find_for_insert(mapping_t *m, svalue_t *lv, int doTheFree) {
+  if (m->share_next) {
+    unshare_mapping(m);
+  }
   int oi = svalue_to_int(lv);
   unsigned int i = oi & m->table_size;
   mapping_node_t *n, *newnode, **a = m->table + i;
@@ -926,6 +1036,9 @@ static void unique_add_to_mapping(mapping_t *m1, mapping_t *m2, int free_flag) {
 void absorb_mapping(mapping_t *m1, mapping_t *m2) {
   if (MAP_COUNT(m2)) {
     if (m1 != m2) {
+      if (m1->share_next) {
+        unshare_mapping(m1);
+      }
       add_to_mapping(m1, m2, 0);
     }
   }
@@ -945,13 +1058,13 @@ mapping_t *add_mapping(mapping_t *m1, mapping_t *m2) {
       add_to_mapping(newmap = copyMapping(m1), m2, 1);
       return newmap;
     } else {
-      return copyMapping(m1);
+      return share_mapping(m1);
     }
   } else if (MAP_COUNT(m1)) {
     unique_add_to_mapping(newmap = copyMapping(m2), m1, 1);
     return newmap;
   } else {
-    return copyMapping(m2);
+    return share_mapping(m2);
   }
   debug(mapping, ("mapping.c: add_mapping end\n"));
 }
@@ -977,6 +1090,9 @@ void map_mapping(svalue_t *arg, int num_arg) {
     arg->u.map = m;
   } else {
     m = arg->u.map;
+    if (m->share_next) {
+      unshare_mapping(m);
+    }
   }
 
   j = m->table_size;
@@ -1097,6 +1213,8 @@ mapping_t *compose_mapping(mapping_t *m1, mapping_t *m2, unsigned short flag) {
   debug(mapping, ("mapping.c: compose_mapping\n"));
   if (flag) {
     m1 = copyMapping(m1);
+  } else if (m1->share_next) {
+    unshare_mapping(m1);
   }
   a = m1->table;
 
@@ -47,6 +47,7 @@ struct mapping_t {
                               have
                               entries */
   unsigned int count;      /* total # of nodes actually in mapping  */
+  struct mapping_t *share_next; /* ring of mappings sharing table, or 0 */
 #ifdef PACKAGE_MUDLIB_STATS
   struct statgroup_t stats; /* creators of the mapping */
 #endif
@@ -85,6 +86,11 @@ svalue_t *find_in_mapping(mapping_t *, svalue_t *);
 svalue_t *find_string_in_mapping(mapping_t *, const char *);
 svalue_t *find_for_insert(mapping_t *, svalue_t *, int);
 void absorb_mapping(mapping_t *, mapping_t *);
+mapping_t *share_mapping(mapping_t *);
+void unshare_mapping(mapping_t *);
+#ifdef DEBUGMALLOC_EXTENSIONS
+int mapping_owns_table(mapping_t *);
+#endif
 void mapping_delete(mapping_t *, svalue_t *);
 mapping_t *add_mapping(mapping_t *, mapping_t *);
 mapping_node_t *new_map_node(void);
@@ -1842,6 +1842,7 @@ void dealloc_object(object_t *ob, const char *from) {
   ob->prev_all = 0;
   tot_dangling_object--;
 #endif
+  tot_destructed_object--;
   tot_alloc_object--;
   FREE((char *)ob);
 }
@@ -34,6 +34,9 @@
 
 #define O_CLONE 0x08            /* Is it cloned from a master copy ? */
 #define O_DESTRUCTED 0x10       /* Is it destructed ?                */
+#ifndef NO_ENVIRONMENT
+#define O_PRESENT_IDS 0x20 /* ids registered for present()      */
+#endif
 #define O_ONCE_INTERACTIVE 0x40 /* Has it ever been interactive ?    */
 #define O_RESET_STATE 0x80      /* Object in a 'reset':ed state ?    */
 #define O_WILL_CLEAN_UP 0x100   /* clean_up will be called next time */
@@ -62,9 +65,15 @@ struct sentence_t {
   char *verb;
 #endif
   struct sentence_t *next;
+#ifndef NO_ADD_ACTION
+  struct sentence_t *prev;
+#endif
   struct object_t *ob;
   union string_or_func function;
   int flags;
+#ifndef NO_ADD_ACTION
+  uint64_t seq; /* order of add_action() calls, see verb_index.cc */
+#endif
 };
 
 struct object_t {
@@ -82,6 +91,7 @@ struct object_t {
   int next_reset; /* Time of next reset of this object */
 #endif
   int time_of_ref; /* Time when last referenced. Used by clean_uo */
+  unsigned int reset_queue_index; /* Place in the reset queue, see backend.cc */
   program_t *prog;
   struct object_t *next_all;
   struct object_t *prev_all;
@@ -89,6 +99,10 @@ struct object_t {
   struct object_t *next_inv;
   struct object_t *contains;
   struct object_t *super; /* Which object surround us ? */
+  unsigned int deep_count; /* Objects inside us, at any depth */
+#ifdef F_SET_HIDE
+  unsigned int deep_hidden; /* How many of those are hidden */
+#endif
 #endif
   struct interactive_t *interactive; /* Data about an interactive user */
   char *replaced_program;            /* Program replaced with */
@@ -101,6 +115,7 @@ struct object_t {
 #endif                        /* NO_SHADOWS */
 #ifndef NO_ADD_ACTION
   sentence_t *sent;
+  struct verb_index_t *verb_index; /* sent, indexed by verb */
   struct object_t *next_hashed_living;
   char *living_name; /* Name of living object if in hash */
 #endif
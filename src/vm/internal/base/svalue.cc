@@ -85,7 +85,7 @@ void int_free_svalue(svalue_t *v)
           CHECK_STRING_STATS;
         } else {
           SUB_NEW_STRING(size, sizeof(malloc_block_t));
-          FREE(MSTR_BLOCK(str));
+          free_mstr_block(MSTR_BLOCK(str));
           CHECK_STRING_STATS;
         }
       } else {
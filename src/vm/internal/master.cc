@@ -12,6 +12,7 @@
 #include "applies_table.autogen.h"
 #include "vm/internal/apply.h"
 #include "vm/internal/simulate.h"
+#include "packages/core/file.h"  // for set_valid_path_cache_ttl
 
 struct object_t *master_ob = 0;
 struct function_lookup_info_t *master_applies = 0;
@@ -200,4 +201,8 @@ void set_master(object_t *ob) {
     master_ob->euid = master_ob->uid;
   }
 #endif
+
+  // Decisions made by the old master are no longer valid.
+  ret = apply_master_ob(APPLY_VALID_PATH_CACHE_TTL, 0);
+  set_valid_path_cache_ttl((ret && ret->type == T_NUMBER) ? ret->u.number : 0);
 }
@@ -18,9 +18,13 @@
 #include "vm/internal/compiler/lex.h"  // for total_lines, FIXME
 
 #include "packages/core/add_action.h"
+#include "packages/core/verb_index.h"
+#include "packages/core/present_index.h"
 #include "packages/core/call_out.h"
 #include "packages/core/ed.h"
+#include "packages/core/reclaim.h"
 #include "packages/core/file.h"
+#include "packages/core/matcher.h"
 #ifdef PACKAGE_ASYNC
 #include "packages/async/async.h"
 #endif
@@ -47,6 +51,8 @@ void db_cleanup(void);  // FIXME
 
 #include "vm/internal/trace.h" // for dump_trace && get_svalue_trace
 
+#include <unordered_set>
+
 /*
  * This one is called from HUP.
  */
@@ -118,9 +124,56 @@ static int init_object(object_t * /*ob*/);
 static object_t *load_virtual_object(const char * /*name*/, int /*clone*/);
 static char *make_new_name(const char * /*str*/);
 #ifndef NO_ENVIRONMENT
-static void send_say(object_t * /*ob*/, const char * /*text*/, array_t * /*avoid*/);
+static int deep_hidden_of(object_t * /*ob*/);
 #endif
 
+namespace {
+// Avoid arrays longer than this are hashed.
+const int kAvoidSetHashThreshold = 8;
+
+/*
+ * The avoid/exclude array of say(), tell_room() and message().  Big ones are
+ * hashed once, instead of being scanned again for every receiver.
+ */
+struct avoid_set_t {
+  explicit avoid_set_t(array_t *arr) : arr(arr) {
+    if (arr->size > kAvoidSetHashThreshold) {
+      for (int i = 0; i < arr->size; i++) {
+        if (arr->item[i].type == T_OBJECT) {
+          hashed.insert(arr->item[i].u.ob);
+        }
+      }
+    }
+  }
+
+  bool contains(object_t *ob) const {
+    if (arr->size > kAvoidSetHashThreshold) {
+      return hashed.count(ob) != 0;
+    }
+    for (int i = 0; i < arr->size; i++) {
+      if (arr->item[i].type == T_OBJECT && arr->item[i].u.ob == ob) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  array_t *arr;
+  std::unordered_set<object_t *> hashed;
+};
+
+/*
+ * tell_object() for one of many receivers of the same message.
+ */
+void tell_object_shared(object_t *ob, shared_message_t *msg) {
+  if (!CONFIG_INT(__RC_INTERACTIVE_CATCH_TELL__) && ob->interactive) {
+    add_message(ob, msg);
+  } else {
+    tell_object(ob, msg->data, msg->len);
+  }
+}
+}  // namespace
+
 void check_legal_string(const char *s) {
   if (strlen(s) > LARGEST_PRINTABLE_STRING) {
     error("Printable strings limited to length of %d.\n", LARGEST_PRINTABLE_STRING);
@@ -563,6 +616,9 @@ object_t *load_object(const char *lname, int callcreate) {
   if (!(ob->flags & O_DESTRUCTED) && function_exists(APPLY_CLEAN_UP, ob, 1)) {
     ob->flags |= O_WILL_CLEAN_UP;
   }
+  if (!(ob->flags & O_DESTRUCTED)) {
+    reset_queue_update(ob);
+  }
   restore_command_giver();
 
   if (ob) {
@@ -652,6 +708,7 @@ object_t *clone_object(const char *str1, int num_arg) {
   if (new_ob->flags & O_DESTRUCTED) {
     return (0);
   }
+  reset_queue_update(new_ob);
   return (new_ob);
 }
 
@@ -680,7 +737,7 @@ object_t *environment(svalue_t *arg) {
  */
 
 #ifdef F_PRESENT
-static object_t *object_present2(const char * /*str*/, object_t * /*ob*/);
+static object_t *object_present2(const char * /*str*/, object_t * /*env*/);
 
 object_t *object_present(svalue_t *v, object_t *ob) {
   svalue_t *ret;
@@ -708,7 +765,7 @@ object_t *object_present(svalue_t *v, object_t *ob) {
     }
     return 0;
   }
-  ret_ob = object_present2(v->u.string, ob->contains);
+  ret_ob = object_present2(v->u.string, ob);
   if (ret_ob) {
     return ret_ob;
   }
@@ -716,15 +773,19 @@ object_t *object_present(svalue_t *v, object_t *ob) {
     return 0;
   }
   if (ob->super) {
-    push_svalue(v);
-    ret = apply(APPLY_ID, ob->super, 1, ORIGIN_DRIVER);
-    if (ob->super->flags & O_DESTRUCTED) {
-      return 0;
+    int known = present_index_id(ob->super, v->u.string);
+    if (known < 0) {
+      push_svalue(v);
+      ret = apply(APPLY_ID, ob->super, 1, ORIGIN_DRIVER);
+      if (ob->super->flags & O_DESTRUCTED) {
+        return 0;
+      }
+      known = !IS_ZERO(ret);
     }
-    if (!IS_ZERO(ret)) {
+    if (known) {
       return ob->super;
     }
-    return object_present2(v->u.string, ob->super->contains);
+    return object_present2(v->u.string, ob->super);
   }
   return 0;
 }
@@ -732,8 +793,11 @@ object_t *object_present(svalue_t *v, object_t *ob) {
 // id(str) returns true, return that object.
 // If string is in format of "xxx 1", then look for the <digits>-th
 // object that id("xx") returns true.
-static object_t *object_present2(const char *str, object_t *ob) {
+// Objects that registered their ids with set_present_ids() are not asked.
+static object_t *object_present2(const char *str, object_t *env) {
   svalue_t *ret;
+  object_t *ob;
+  bool complete;
 
   const char *name = NULL;
   int namelen = 0, count = 0;
@@ -758,19 +822,31 @@ static object_t *object_present2(const char *str, object_t *ob) {
     }
   }
 
-  for (; ob; ob = ob->next_inv) {
-    char *str_to_push = new_string(namelen, "object_present2");
-    memcpy(str_to_push, name, namelen);
-    str_to_push[namelen] = 0;
-    push_malloced_string(str_to_push);
+  std::string id(name, namelen);
+  ob = present_index_lookup(env, id.c_str(), count, &complete);
+  if (complete) {
+    return ob;
+  }
 
-    ret = apply(APPLY_ID, ob, 1, ORIGIN_DRIVER);
-    if (ob->flags & O_DESTRUCTED) {
-      return 0;
-    }
-    if (IS_ZERO(ret)) {
+  for (ob = env->contains; ob; ob = ob->next_inv) {
+    int known = present_index_id(ob, id.c_str());
+    if (!known) {
       continue;
     }
+    if (known < 0) {
+      char *str_to_push = new_string(namelen, "object_present2");
+      memcpy(str_to_push, name, namelen);
+      str_to_push[namelen] = 0;
+      push_malloced_string(str_to_push);
+
+      ret = apply(APPLY_ID, ob, 1, ORIGIN_DRIVER);
+      if (ob->flags & O_DESTRUCTED) {
+        return 0;
+      }
+      if (IS_ZERO(ret)) {
+        continue;
+      }
+    }
     if (--count > 0) {
       continue;
     }
@@ -932,6 +1008,8 @@ void destruct_object(object_t *ob) {
 #endif
     remove_sent(ob->super, ob);
     remove_sent(ob, ob->super);
+    present_index_leave(ob, ob->super);
+    add_deep_count(ob->super, -1 - static_cast<int>(ob->deep_count), -deep_hidden_of(ob));
     for (pp = &ob->super->contains; *pp;) {
       remove_sent(*pp, ob);
       if (*pp != ob) {
@@ -999,6 +1077,7 @@ void destruct_object(object_t *ob) {
    * because an error in the above code would halt execution.
    */
   // removed = 0;
+  reclaim_object_removed(ob);
   if (ob->prev_all) {
     ob->prev_all->next_all = ob->next_all;
     if (ob->next_all) {
@@ -1019,7 +1098,11 @@ void destruct_object(object_t *ob) {
    DEBUG_CHECK(!removed, "Failed to delete object.\n");//*/
 
   remove_living_name(ob);
+  close_file_cursors(ob);
+  free_matchers(ob);
+  forget_pending_init(ob);
 #ifndef NO_ENVIRONMENT
+  present_index_forget(ob);
   ob->super = 0;
   ob->next_inv = 0;
   ob->contains = 0;
@@ -1031,7 +1114,9 @@ void destruct_object(object_t *ob) {
   ob->prev_all = 0;
   obj_list_destruct = ob;
   set_heart_beat(ob, 0);
+  reset_queue_remove(ob);
   ob->flags |= O_DESTRUCTED;
+  tot_destructed_object++;
   /* moved this here from destruct2() -- see comments in destruct2() */
   if (ob->interactive) {
     remove_interactive(ob, 1);
@@ -1091,6 +1176,8 @@ void destruct2(object_t *ob) {
     s = next;
   }
   ob->sent = 0;
+  verb_index_free(ob);
+  clear_pending_inits(ob);
 #endif
 
 #ifdef DEBUG
@@ -1121,24 +1208,12 @@ void destruct2(object_t *ob) {
  */
 
 #ifndef NO_ENVIRONMENT
-static void send_say(object_t *ob, const char *text, array_t *avoid) {
-  int valid, j;
-
-  for (valid = 1, j = 0; j < avoid->size; j++) {
-    if (avoid->item[j].type != T_OBJECT) {
-      continue;
-    }
-    if (avoid->item[j].u.ob == ob) {
-      valid = 0;
-      break;
-    }
-  }
-
-  if (!valid) {
+static void send_say(object_t *ob, shared_message_t *msg, const avoid_set_t &avoid) {
+  if (avoid.contains(ob)) {
     return;
   }
 
-  tell_object(ob, text, strlen(text));
+  tell_object_shared(ob, msg);
 }
 
 void say(svalue_t *v, array_t *avoid) {
@@ -1147,6 +1222,8 @@ void say(svalue_t *v, array_t *avoid) {
 
   check_legal_string(v->u.string);
   buff = v->u.string;
+  shared_message_t msg(buff, strlen(buff));
+  avoid_set_t avoid_set(avoid);
 
   if (current_object->flags & O_LISTENER || current_object->interactive) {
     save_command_giver(current_object);
@@ -1162,13 +1239,13 @@ void say(svalue_t *v, array_t *avoid) {
   /* To our surrounding object... */
   if ((ob = origin->super)) {
     if (ob->flags & O_LISTENER || ob->interactive) {
-      send_say(ob, buff, avoid);
+      send_say(ob, &msg, avoid_set);
     }
 
     /* And its inventory... */
     for (ob = origin->super->contains; ob; ob = ob->next_inv) {
       if (ob != origin && (ob->flags & O_LISTENER || ob->interactive)) {
-        send_say(ob, buff, avoid);
+        send_say(ob, &msg, avoid_set);
         if (ob->flags & O_DESTRUCTED) {
           break;
         }
@@ -1178,7 +1255,7 @@ void say(svalue_t *v, array_t *avoid) {
   /* Our inventory... */
   for (ob = origin->contains; ob; ob = ob->next_inv) {
     if (ob->flags & O_LISTENER || ob->interactive) {
-      send_say(ob, buff, avoid);
+      send_say(ob, &msg, avoid_set);
       if (ob->flags & O_DESTRUCTED) {
         break;
       }
@@ -1196,7 +1273,6 @@ void say(svalue_t *v, array_t *avoid) {
 void tell_room(object_t *room, svalue_t *v, array_t *avoid) {
   object_t *ob;
   const char *buff;
-  int valid, j;
   char txt_buf[LARGEST_PRINTABLE_STRING + 1];
 
   switch (v->type) {
@@ -1222,22 +1298,15 @@ void tell_room(object_t *room, svalue_t *v, array_t *avoid) {
 #endif
   }
 
+  shared_message_t msg(buff, strlen(buff));
+  avoid_set_t avoid_set(avoid);
+
   for (ob = room->contains; ob; ob = ob->next_inv) {
     if (!ob->interactive && !(ob->flags & O_LISTENER)) {
       continue;
     }
 
-    for (valid = 1, j = 0; j < avoid->size; j++) {
-      if (avoid->item[j].type != T_OBJECT) {
-        continue;
-      }
-      if (avoid->item[j].u.ob == ob) {
-        valid = 0;
-        break;
-      }
-    }
-
-    if (!valid) {
+    if (avoid_set.contains(ob)) {
       continue;
     }
 
@@ -1247,7 +1316,7 @@ void tell_room(object_t *room, svalue_t *v, array_t *avoid) {
         break;
       }
     } else {
-      tell_object(ob, buff, strlen(buff));
+      tell_object_shared(ob, &msg);
       if (ob->flags & O_DESTRUCTED) {
         break;
       }
@@ -1261,6 +1330,7 @@ void shout_string(const char *str) {
   object_t *ob;
 
   check_legal_string(str);
+  shared_message_t msg(str, strlen(str));
 
   for (ob = obj_list; ob; ob = ob->next_all) {
     if (!(ob->flags & O_LISTENER) || (ob == command_giver)
@@ -1270,7 +1340,7 @@ void shout_string(const char *str) {
         ) {
       continue;
     }
-    tell_object(ob, str, strlen(str));
+    tell_object_shared(ob, &msg);
   }
 }
 
@@ -1519,6 +1589,8 @@ void move_object(object_t *item, object_t *dest) {
 #ifndef NO_LIGHT
     add_light(item->super, -item->total_light);
 #endif
+    present_index_leave(item, item->super);
+    add_deep_count(item->super, -1 - static_cast<int>(item->deep_count), -deep_hidden_of(item));
     for (pp = &item->super->contains; *pp;) {
       if (*pp != item) {
         remove_sent(item, *pp);
@@ -1538,12 +1610,16 @@ void move_object(object_t *item, object_t *dest) {
     }
 #endif
   }
+  clear_pending_inits(item);
+  forget_pending_init(item);
   /*
    * link object into target's inventory list
    */
   item->next_inv = dest->contains;
   dest->contains = item;
   item->super = dest;
+  add_deep_count(dest, 1 + item->deep_count, deep_hidden_of(item));
+  present_index_enter(item, dest);
 
   setup_new_commands(dest, item);
   restore_command_giver();
@@ -1569,6 +1645,31 @@ void add_light(object_t *p, int n) {
 }
 #endif
 
+#ifndef NO_ENVIRONMENT
+/*
+ * Every object also counts the objects inside it at any depth, and how many
+ * of those are hidden, so inventory_count() doesn't have to walk the tree.
+ * Add n objects, hidden of them hidden, to p.
+ */
+void add_deep_count(object_t *p, int n, int hidden) {
+  for (; p; p = p->super) {
+    p->deep_count += n;
+#ifdef F_SET_HIDE
+    p->deep_hidden += hidden;
+#endif
+  }
+}
+
+/* What moving ob in or out of somewhere adds up to. */
+static int deep_hidden_of(object_t *ob) {
+#ifdef F_SET_HIDE
+  return ob->deep_hidden + ((ob->flags & O_HIDDEN) ? 1 : 0);
+#else
+  return 0;
+#endif
+}
+#endif
+
 static sentence_t *sent_free = 0;
 uint64_t tot_alloc_sentence;
 
@@ -1955,11 +2056,11 @@ void error(const char *const fmt, ...) {
   error_handler(err_buf);
 }
 
-void do_message(svalue_t *lclass, svalue_t *msg, array_t *scope, array_t *exclude, int recurse) {
-  int i, j, valid;
+static void do_message_to(svalue_t *lclass, svalue_t *msg, array_t *scope,
+                          const avoid_set_t &exclude, int recurse) {
   object_t *ob;
 
-  for (i = 0; i < scope->size; i++) {
+  for (int i = 0; i < scope->size; i++) {
     switch (scope->item[i].type) {
       case T_STRING:
         ob = find_object(scope->item[i].u.string);
@@ -1974,16 +2075,7 @@ void do_message(svalue_t *lclass, svalue_t *msg, array_t *scope, array_t *exclud
         continue;
     }
     if (ob->flags & O_LISTENER || ob->interactive) {
-      for (valid = 1, j = 0; j < exclude->size; j++) {
-        if (exclude->item[j].type != T_OBJECT) {
-          continue;
-        }
-        if (exclude->item[j].u.ob == ob) {
-          valid = 0;
-          break;
-        }
-      }
-      if (valid) {
+      if (!exclude.contains(ob)) {
         push_svalue(lclass);
         push_svalue(msg);
         apply(APPLY_RECEIVE_MESSAGE, ob, 2, ORIGIN_DRIVER);
@@ -1994,13 +2086,17 @@ void do_message(svalue_t *lclass, svalue_t *msg, array_t *scope, array_t *exclud
       array_t *tmp;
 
       tmp = all_inventory(ob, 1);
-      do_message(lclass, msg, tmp, exclude, 0);
+      do_message_to(lclass, msg, tmp, exclude, 0);
       free_array(tmp);
     }
 #endif
   }
 }
 
+void do_message(svalue_t *lclass, svalue_t *msg, array_t *scope, array_t *exclude, int recurse) {
+  do_message_to(lclass, msg, scope, avoid_set_t(exclude), recurse);
+}
+
 void try_reset(object_t *ob) {
   if ((ob->next_reset < g_current_gametick) && !(ob->flags & O_RESET_STATE)) {
     debug(d_flag, "(lazy) RESET /%s\n", ob->obname);
@@ -26,6 +26,9 @@ void check_legal_string(const char *);
 #ifndef NO_LIGHT
 void add_light(object_t *, int);
 #endif
+#ifndef NO_ENVIRONMENT
+void add_deep_count(object_t *, int, int);
+#endif
 void free_sentence(sentence_t *);
 
 sentence_t *alloc_sentence(void);
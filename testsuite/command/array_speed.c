@@ -0,0 +1,55 @@
+// Times the array set operators on arrays of growing size, in microseconds
+// per operation.  The two arrays share a third of their items.  Each time
+// is the best of a few runs, which hides most of the scheduling noise.
+
+#define RUNS 5
+
+float best(int op, mixed *a, mixed *b, int reps) {
+    mixed *r;
+    int i, run, t, min = -1;
+
+    for (run = 0; run < RUNS; run++) {
+        reset_eval_cost();
+        switch (op) {
+        case 0:
+            t = time_expression { for (i = 0; i < reps; i++) r = a & b; };
+            break;
+        case 1:
+            t = time_expression { for (i = 0; i < reps; i++) r = a | b; };
+            break;
+        default:
+            t = time_expression { for (i = 0; i < reps; i++) r = a - b; };
+            break;
+        }
+        if (min == -1 || t < min) min = t;
+    }
+    return to_float(min) / reps;
+}
+
+int
+main(string arg)
+{
+    int *sizes = ({ 1, 4, 8, 16, 24, 32, 48, 64, 96, 128, 256, 512, 1024, 4096, 7000 });
+    mixed *a, *b;
+    string out;
+    int n, i, reps, str;
+
+    out = sprintf("%-6s %6s %10s %10s %10s\n", "items", "size", "&", "|", "-");
+    foreach (n in sizes) {
+        for (str = 0; str < 2; str++) {
+            a = allocate(n);
+            b = allocate(n);
+            for (i = 0; i < n; i++) {
+                a[i] = str ? "item" + (i * 2) : i * 2;
+                b[i] = str ? "item" + (i * 3) : i * 3;
+            }
+            reps = 400000 / (n + 4);
+            out += sprintf("%-6s %6d %10.3f %10.3f %10.3f\n",
+                           str ? "string" : "int", n,
+                           best(0, a, b, reps), best(1, a, b, reps),
+                           best(2, a, b, reps));
+        }
+    }
+    write(out);
+    return 1;
+}
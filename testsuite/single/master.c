@@ -225,6 +225,38 @@ string privs_file(string f) {
   return f;
 }
 
+// Everything may be read and written, except what the flush_valid_path_cache
+// test denies for itself.
+string denied_write_prefix;
+int valid_write_calls;
+
+int valid_read(string file, mixed user, string func) {
+  return 1;
+}
+
+int valid_write(string file, mixed user, string func) {
+  valid_write_calls++;
+  return !denied_write_prefix || strsrch(file, denied_write_prefix) != 0;
+}
+
+void set_denied_write_prefix(string prefix) {
+  denied_write_prefix = prefix;
+  flush_valid_path_cache();
+}
+
+int query_valid_write_calls() {
+  return valid_write_calls;
+}
+
+void flush_path_cache() {
+  flush_valid_path_cache();
+}
+
+// Let the driver remember the answers above for a minute.
+int valid_path_cache_ttl() {
+  return 60;
+}
+
 staticf void error_handler(mapping map, int flag) {
   object ob;
   string str;
@@ -1,5 +1,11 @@
 int called;
 int xverb;
+string *order;
+
+int record(string which, int ret) {
+    order += ({ which });
+    return ret;
+}
 
 void do_tests() {
 #ifndef __NO_ADD_ACTION__
@@ -14,5 +20,25 @@ void do_tests() {
     command("bar");
     ASSERT(called);
     ASSERT(xverb);
+
+    // Every kind of verb that matches is tried, newest first.
+    order = ({});
+    SAVETP;
+    enable_commands();
+    add_action( (: record("any", 0) :), "");
+    add_action( (: record("exact", 0) :), "look");
+    add_action( (: record("short", 0) :), "lo", 1);
+    add_action( (: record("nospace", 0) :), "l", 2);
+    add_action( (: record("other", 1) :), "take");
+    add_action( (: record("last", 1) :), "look");
+    RESTORETP;
+    ASSERT(command("look at me"));
+    ASSERT_EQ(({ "last" }), order);
+    order = ({});
+    ASSERT(!command("lo"));
+    ASSERT_EQ(({ "nospace", "short", "any" }), order);
+    order = ({});
+    ASSERT(command("take it"));
+    ASSERT_EQ(({ "other" }), order);
 #endif
 }
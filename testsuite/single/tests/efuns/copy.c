@@ -0,0 +1,55 @@
+void bump(mapping m, string k) {
+    m[k]++;
+}
+
+void do_tests() {
+    mapping m = ([ "a" : 1, "b" : 2, "c" : 3 ]);
+    mapping c, d;
+    mixed *arr = ({ 1, ({ 2 }) });
+    mixed *carr;
+
+    // Writes to either side of a copy stay on that side.
+    c = copy(m);
+    ASSERT_EQ(m, c);
+    ASSERT(c != m);
+    c["a"] = 10;
+    ASSERT_EQ(1, m["a"]);
+    m["d"] = 4;
+    ASSERT(undefinedp(c["d"]));
+    map_delete(c, "b");
+    ASSERT_EQ(2, m["b"]);
+    ASSERT_EQ(4, sizeof(m));
+    ASSERT_EQ(2, sizeof(c));
+
+    c = m + ([ ]);
+    d = ([ ]) + m;
+    c += ([ "e" : 5 ]);
+    ASSERT(undefinedp(m["e"]));
+    ASSERT(undefinedp(d["e"]));
+    bump(d, "a");
+    ASSERT_EQ(2, d["a"]);
+    ASSERT_EQ(1, m["a"]);
+    ASSERT_EQ(1, c["a"]);
+
+    c = copy(m);
+    c = map(c, (: $2 * 2 :));
+    ASSERT_EQ(2, c["a"]);
+    ASSERT_EQ(1, m["a"]);
+
+    c = copy(m);
+    d = copy(m);
+    m = 0;
+    c["a"] = 7;
+    ASSERT_EQ(1, d["a"]);
+    ASSERT_EQ(7, c["a"]);
+
+    // Values that need copying themselves are still copied.
+    m = ([ "x" : ({ 1 }) ]);
+    c = copy(m);
+    c["x"][0] = 2;
+    ASSERT_EQ(1, m["x"][0]);
+
+    carr = copy(arr);
+    carr[1][0] = 3;
+    ASSERT_EQ(2, arr[1][0]);
+}
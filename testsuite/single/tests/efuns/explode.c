@@ -75,4 +75,19 @@ void do_tests() {
     ASSERT(ret[6] == "test");
 #endif
 
+    // One character pieces are shared constants, writing to one must not
+    // show up anywhere else.
+    ret = explode("abc", "");
+    ret[0][0] = 'z';
+    ASSERT_EQ(({ "z", "b", "c" }), ret);
+    ASSERT_EQ(({ "a", "b", "c" }), explode("abc", ""));
+    ret = explode("a b c", " ");
+    ret[1] += "x";
+    ASSERT_EQ(({ "a", "bx", "c" }), ret);
+    ASSERT_EQ(({ "a", "b", "c" }), explode("a b c", " "));
+    tmp = "abc"[1..1];
+    tmp[0] = 'q';
+    ASSERT_EQ("q", tmp);
+    ASSERT_EQ("b", "abc"[1..1]);
+    ASSERT_EQ("c", "abc"[2..]);
 }
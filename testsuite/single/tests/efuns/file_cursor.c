@@ -0,0 +1,63 @@
+int open_cursor(string file) {
+    return file_cursor_open(file);
+}
+
+void do_tests() {
+    string str = "";
+    int i, fc;
+    object ob;
+
+    for (i = 1; i <= 1000; i++) {
+        str += "line " + i + "\n";
+    }
+    rm("/testfile.cursor");
+    write_file("/testfile.cursor", str);
+
+    ASSERT_EQ(-1, file_cursor_open("/does_not_exist"));
+    ASSERT_EQ(-1, file_cursor_open("/single"));
+
+    fc = file_cursor_open("/testfile.cursor");
+    ASSERT(fc >= 0);
+    ASSERT_EQ(1, file_cursor_tell(fc));
+    ASSERT_EQ("line 1\nline 2\n", file_cursor_read(fc, 2));
+    ASSERT_EQ(3, file_cursor_tell(fc));
+    ASSERT_EQ("line 3\n", file_cursor_read(fc, 1));
+    ASSERT_EQ(read_file("/testfile.cursor", 4, 300), file_cursor_read(fc, 300));
+
+    // forward, backward, and through the line index
+    ASSERT(file_cursor_seek(fc, 900));
+    ASSERT_EQ("line 900\n", file_cursor_read(fc, 1));
+    ASSERT(file_cursor_seek(fc, 257));
+    ASSERT_EQ("line 257\nline 258\n", file_cursor_read(fc, 2));
+    ASSERT(file_cursor_seek(fc, 1));
+    ASSERT_EQ("line 1\n", file_cursor_read(fc, 1));
+    ASSERT(file_cursor_seek(fc, 600));
+    ASSERT_EQ(read_file("/testfile.cursor", 600, 10), file_cursor_read(fc, 10));
+
+    // end of file
+    ASSERT_EQ("line 1000\n", (file_cursor_seek(fc, 1000), file_cursor_read(fc, 5)));
+    ASSERT_EQ(0, file_cursor_read(fc, 1));
+    ASSERT_EQ(0, file_cursor_seek(fc, 2000));
+    ASSERT_EQ(1001, file_cursor_tell(fc));
+
+    // appended lines show up
+    write_file("/testfile.cursor", "line 1001\r\n");
+    ASSERT_EQ("line 1001\n", file_cursor_read(fc, 1));
+
+    file_cursor_close(fc);
+    ASSERT(catch(file_cursor_read(fc, 1)));
+    ASSERT(catch(file_cursor_close(fc)));
+
+    // destructing the owner frees its cursor right away
+    ob = new(__FILE__);
+    fc = ob->open_cursor("/testfile.cursor");
+    ASSERT(fc >= 0);
+#ifdef __DEBUGMALLOC_EXTENSIONS__
+    // the cursor's ref on its owner is accounted for
+    ASSERT(strsrch(check_memory(), "Bad ref count") == -1);
+#endif
+    destruct(ob);
+    ASSERT_EQ(fc, file_cursor_open("/testfile.cursor"));
+    file_cursor_close(fc);
+    rm("/testfile.cursor");
+}
@@ -0,0 +1,36 @@
+int calls() {
+    return master()->query_valid_write_calls();
+}
+
+void do_tests() {
+    int n;
+
+    ASSERT(catch(flush_valid_path_cache()));
+
+    rm("/testfile.vpc");
+    master()->set_denied_write_prefix("/denied/");
+
+    n = calls();
+    ASSERT(!write_file("/denied/testfile", "x"));
+    ASSERT_EQ(n + 1, calls());
+    // the same question is answered from the cache
+    ASSERT(!write_file("/denied/testfile", "x"));
+    ASSERT_EQ(n + 1, calls());
+    // another file in the same directory is asked about
+    ASSERT(!write_file("/denied/testfile2", "x"));
+    ASSERT_EQ(n + 2, calls());
+
+    ASSERT(write_file("/testfile.vpc", "x", 1));
+    ASSERT(write_file("/testfile.vpc", "y", 1));
+    ASSERT_EQ(n + 3, calls());
+    ASSERT_EQ("y", read_file("/testfile.vpc"));
+
+    master()->flush_path_cache();
+    ASSERT(!write_file("/denied/testfile", "x"));
+    ASSERT_EQ(n + 4, calls());
+
+    master()->set_denied_write_prefix(0);
+    ASSERT(write_file("/testfile.vpc", "z", 1));
+    ASSERT_EQ(n + 5, calls());
+    ASSERT(rm("/testfile.vpc"));
+}
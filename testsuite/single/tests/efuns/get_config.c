@@ -1,4 +1,7 @@
 void do_tests() {
     ASSERT(get_config(0) == MUD_NAME);
     ASSERT(catch(get_config(-1)));
+    ASSERT_EQ(15000, get_config("maximum array size"));
+    ASSERT(catch(get_config("no such setting")));
+    ASSERT(catch(set_config("no such setting", 1)));
 }
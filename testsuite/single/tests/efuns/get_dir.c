@@ -1,3 +1,28 @@
 void do_tests() {
-    // more later
+    rm("/testdir/a");
+    rm("/testdir/b.c");
+    rmdir("/testdir");
+    ASSERT(!get_dir("/testdir/"));
+
+    ASSERT(mkdir("/testdir"));
+    ASSERT_EQ(({}), get_dir("/testdir/"));
+    write_file("/testdir/a", "1234");
+    ASSERT_EQ(({ "a" }), get_dir("/testdir/"));
+    write_file("/testdir/b.c", "12");
+    ASSERT_EQ(({ "a", "b.c" }), get_dir("/testdir/"));
+    ASSERT_EQ(({ "b.c" }), get_dir("/testdir/*.c"));
+    ASSERT_EQ(({ "a" }), get_dir("/testdir/a"));
+    ASSERT_EQ(4, get_dir("/testdir/", -1)[0][1]);
+
+    write_file("/testdir/a", "5678");
+    ASSERT_EQ(8, get_dir("/testdir/", -1)[0][1]);
+    ASSERT_EQ(8, file_size("/testdir/a"));
+
+    rm("/testdir/a");
+    ASSERT_EQ(({ "b.c" }), get_dir("/testdir/"));
+    ASSERT_EQ(-1, file_size("/testdir/a"));
+    rm("/testdir/b.c");
+    rmdir("/testdir");
+    ASSERT(!get_dir("/testdir/"));
+    ASSERT_EQ(-1, file_size("/testdir"));
 }
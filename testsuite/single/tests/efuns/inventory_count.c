@@ -0,0 +1,78 @@
+// from include/inventory.h
+#define INV_DEEP 1
+#define INV_LIVING 2
+#define INV_INTERACTIVE 4
+
+void create(object ob) {
+#ifndef __NO_ENVIRONMENT__
+  if (ob) move_object(ob);
+#endif
+}
+
+void move(object ob) {
+#ifndef __NO_ENVIRONMENT__
+  move_object(ob);
+#endif
+}
+
+void make_living() {
+  enable_commands();
+}
+
+void hide() {
+  set_hide(1);
+}
+
+void do_tests() {
+#ifndef __NO_ENVIRONMENT__
+  object root, a, b, c, l, ob;
+
+  root = new(__FILE__);
+  a = new(__FILE__, root);
+  b = new(__FILE__, a);
+  c = new(__FILE__, b);
+  l = new(__FILE__, a);
+  l->make_living();
+
+  ASSERT_EQ(4, inventory_count(root, INV_DEEP));
+  ASSERT_EQ(sizeof(deep_inventory(root)), inventory_count(root, INV_DEEP));
+  ASSERT_EQ(1, inventory_count(root, 0));
+  ASSERT_EQ(2, inventory_count(a, 0));
+  ASSERT_EQ(0, inventory_count(c, INV_DEEP));
+  ASSERT_EQ(1, inventory_count(root, INV_DEEP | INV_LIVING));
+  ASSERT_EQ(0, inventory_count(root, INV_LIVING));
+  ASSERT_EQ(0, inventory_count(root, INV_DEEP | INV_INTERACTIVE));
+  ASSERT_EQ(4, inventory_count(root, INV_DEEP, this_object()));
+  ASSERT_EQ(0, inventory_count(root, INV_DEEP, load_object("/single/void")));
+
+  // The same objects in the same order as deep_inventory(), up to max.
+  ASSERT_EQ(deep_inventory(root), inventory_find(root, INV_DEEP, 0));
+  ASSERT_EQ(deep_inventory(root)[0..1], inventory_find(root, INV_DEEP, 2));
+  ASSERT_EQ(({ l }), inventory_find(root, INV_DEEP | INV_LIVING, 5));
+  ASSERT_EQ(({ a }), inventory_find(root, 0, 5));
+  ASSERT_EQ(({ }), inventory_find(c, INV_DEEP, 5));
+
+  // Moving and destructing keep the counts.
+  b->move(root);
+  ASSERT_EQ(4, inventory_count(root, INV_DEEP));
+  ASSERT_EQ(1, inventory_count(a, INV_DEEP));
+  ASSERT_EQ(2, inventory_count(root, 0));
+  destruct(c);
+  ASSERT_EQ(3, inventory_count(root, INV_DEEP));
+  ASSERT_EQ(0, inventory_count(b, INV_DEEP));
+  a->move(b);
+  ASSERT_EQ(3, inventory_count(root, INV_DEEP));
+  ASSERT_EQ(2, inventory_count(b, INV_DEEP));
+  ASSERT_EQ(deep_inventory(root), inventory_find(root, INV_DEEP, 0));
+
+  l->hide();
+  ASSERT_EQ(sizeof(deep_inventory(root)), inventory_count(root, INV_DEEP));
+  ASSERT_EQ(deep_inventory(root), inventory_find(root, INV_DEEP, 0));
+
+  foreach (ob in deep_inventory(root)) {
+    if (ob) destruct(ob);
+  }
+  ASSERT_EQ(0, inventory_count(root, INV_DEEP));
+  destruct(root);
+#endif
+}
@@ -0,0 +1,96 @@
+int inits;
+
+void move(object ob) {
+  move_object(ob);
+}
+
+void init() {
+  inits++;
+  add_action("nothing", "poke");
+}
+
+int nothing() {
+  return 1;
+}
+
+int query_inits() {
+  return inits;
+}
+
+void make_living() {
+  enable_commands();
+}
+
+int count_commands() {
+  return sizeof(commands());
+}
+
+int do_command(string str) {
+  return command(str);
+}
+
+int dropped() {
+  int deferred, run, dropped;
+
+  sscanf(mud_status(1), "%*sLazy init: %d deferred, %d run, %d dropped", deferred, run, dropped);
+  return dropped;
+}
+
+void do_tests() {
+#ifdef __NO_ADD_ACTION__
+    write("NO_ADD_ACTION is defined, test not ran.\n");
+#else
+#ifdef __NO_ENVIRONMENT__
+    write("NO_ENVIRONMENT is defined, test not ran.\n");
+#else
+    object tp, living, ob, other;
+    int r, d;
+
+    set_config("lazy init", 1);
+    living = new(__FILE__);
+    SAVETP;
+    living->make_living();
+    RESTORETP;
+    other = new(__FILE__);
+    ob = new(__FILE__);
+    r = refs(ob);
+
+    // init() waits for the next command, holding a reference
+    ob->move(living);
+    ASSERT_EQ(0, ob->query_inits());
+    ASSERT_EQ(r + 1, refs(ob));
+
+    // which is dropped when the object goes away again
+    ob->move(other);
+    ASSERT_EQ(r, refs(ob));
+    ob->move(living);
+
+    // commands() runs it, once
+    ASSERT_EQ(1, living->count_commands());
+    ASSERT_EQ(1, ob->query_inits());
+    ASSERT_EQ(r, refs(ob));
+    ASSERT_EQ(1, living->count_commands());
+    ASSERT_EQ(1, ob->query_inits());
+    ASSERT(living->do_command("poke"));
+
+    // destructing an object drops its init() right away
+    destruct(ob);
+    ob = new(__FILE__);
+    ob->move(living);
+    d = dropped();
+    destruct(ob);
+    ASSERT_EQ(d + 1, dropped());
+    ASSERT_EQ(0, living->count_commands());
+
+    // without lazy init, init() is called right away
+    set_config("lazy init", 0);
+    ob = new(__FILE__);
+    ob->move(living);
+    ASSERT_EQ(1, ob->query_inits());
+
+    destruct(ob);
+    destruct(other);
+    destruct(living);
+#endif
+#endif
+}
@@ -0,0 +1,59 @@
+int same_array(mixed *x, mixed *y) {
+    if (!arrayp(x) || !arrayp(y)) return 0;
+    if (sizeof(x) != sizeof(y)) return 0;
+    for (int i = 0; i < sizeof(x); i++) {
+	if (x[i] != y[i])
+	    return 0;
+    }
+    return 1;
+}
+
+int compile(string *words) {
+    return matcher_compile(words);
+}
+
+void do_tests() {
+    int m;
+    string *words = ({});
+    object ob;
+
+    ASSERT(catch(matcher_compile(({ "" }))));
+    ASSERT(catch(matcher_compile(({ 1 }))));
+    ASSERT(catch(matcher_compile(({ "a" }), ({ "+" }))));
+    ASSERT(catch(matcher_match(-1, "foo")));
+
+    // overlapping keywords, and ones that are suffixes of others
+    m = matcher_compile(({ "he", "she", "his", "hers" }));
+    ASSERT(same_array(matcher_match(m, "ushers"), ({ 0, 1, 3 })));
+    ASSERT(same_array(matcher_match(m, "this"), ({ 2 })));
+    ASSERT(same_array(matcher_match(m, "nothing"), ({})));
+    ASSERT(same_array(matcher_match(m, ""), ({})));
+    matcher_free(m);
+    ASSERT(catch(matcher_match(m, "he")));
+
+    // regexps come after the keywords
+    m = matcher_compile(({ "dragon" }), ({ "gold.*coin", "^[0-9]+$", "x*y" }));
+    ASSERT(same_array(matcher_match(m, "a dragon sits on gold"), ({ 0 })));
+    ASSERT(same_array(matcher_match(m, "a gold coin"), ({ 1 })));
+    ASSERT(same_array(matcher_match(m, "xxy"), ({ 3 })));
+    ASSERT(same_array(matcher_match(m, "1234"), ({ 2 })));
+    ASSERT(same_array(matcher_match(m, "zzz"), ({})));
+    matcher_free(m);
+
+    // same answers as looping over the patterns
+    for (int i = 0; i < 500; i++) {
+	words += ({ "w" + i + "w" });
+    }
+    m = matcher_compile(words, ({ "a" }));
+    ASSERT(same_array(matcher_match(m, "w7w w499ww10w"), ({ 7, 10, 499 })));
+    ASSERT(same_array(matcher_match(m, "w1 w2ww3w a"), ({ 2, 3, 500 })));
+    matcher_free(m);
+
+    // the matcher's ref on its owner is accounted for
+    ob = new(__FILE__);
+    ASSERT(ob->compile(({ "a" })) > 0);
+#ifdef __DEBUGMALLOC_EXTENSIONS__
+    ASSERT(strsrch(check_memory(), "Bad ref count") == -1);
+#endif
+    destruct(ob);
+}
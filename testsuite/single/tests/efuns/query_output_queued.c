@@ -0,0 +1,8 @@
+void do_tests() {
+    ASSERT(query_output_queued(this_object()) == 0);
+    ASSERT(catch(set_output_watermarks(this_object(), 1024, 0, 0)));
+    if (this_player()) {
+        ASSERT(intp(query_output_queued(this_player())));
+        ASSERT(catch(set_output_watermarks(this_player(), 1024, 0, -1)));
+    }
+}
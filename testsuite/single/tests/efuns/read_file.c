@@ -20,4 +20,13 @@ void do_tests() {
     ASSERT(all == read_file("/testfile", 10, 0x7fffffff));
     ASSERT(!read_file("/does_not_exist"));
     ASSERT(!read_file("/testfile", 10000, 1));
+
+    // changes must be visible right away, even with the file cache on.
+    write_file("/testfile.zerolength", "abc\n", 1);
+    ASSERT_EQ("abc\n", read_file("/testfile.zerolength"));
+    write_file("/testfile.zerolength", "def\n");
+    ASSERT_EQ("abc\ndef\n", read_file("/testfile.zerolength"));
+    ASSERT_EQ("def\n", read_file("/testfile.zerolength", 2, 1));
+    rm("/testfile.zerolength");
+    ASSERT(!read_file("/testfile.zerolength"));
 }
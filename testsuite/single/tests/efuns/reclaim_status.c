@@ -0,0 +1,23 @@
+object *held;
+
+void do_tests() {
+    mapping m = reclaim_status();
+    int passes = m["passes"];
+    object ob;
+
+    ASSERT(mapp(m));
+    ASSERT(intp(m["pass usec"]));
+
+    // a destructed object held in a variable is counted until reclaimed
+    ob = new("/single/void");
+    held = ({ ob });
+    destruct(ob);
+    ASSERT(reclaim_status()["destructed"] > 0);
+    ASSERT(reclaim_objects() > 0);
+    ASSERT_EQ(({ 0 }), held);
+
+    m = reclaim_status();
+    ASSERT_EQ(passes + 1, m["passes"]);
+    ASSERT(m["cleaned"] > 0);
+    ASSERT(m["pass objects"] > 0);
+}
@@ -12,6 +12,9 @@ int same_array(mixed *x, mixed *y) {
 }
 
 void do_tests() {
+    string *pats;
+    int *toks;
+
     ASSERT(same_array(
 	       reg_assoc("testhahatest", ({ "haha", "te" }), ({ 2, 3 }), 4),
 	       ({ ({ "", "te", "st", "haha", "", "te", "st" }),
@@ -19,4 +22,17 @@ void do_tests() {
     ASSERT(catch(reg_assoc("foo", ({ 1 }), ({ 2, 3 }))));
     ASSERT(catch(reg_assoc("foo", ({ 1, 2 }), ({ 2, 3 }))));
     ASSERT(catch(reg_assoc("foo", ({ "bar", "+" }), ({ 0, 1 }))));
+
+    // more patterns than the regexp cache holds
+    pats = ({});
+    toks = ({});
+    for (int i = 0; i < 300; i++) {
+	pats += ({ "a" + i + "b" });
+	toks += ({ i });
+    }
+    for (int i = 0; i < 2; i++) {
+	ASSERT(same_array(reg_assoc("a299b a0b", pats, toks, -1),
+			  ({ ({ "", "a299b", " ", "a0b", "" }),
+			     ({ -1, 299, -1, 0, -1 }) })));
+    }
 }
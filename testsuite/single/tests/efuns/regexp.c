@@ -29,4 +29,13 @@ void do_tests() {
 		      ({ "foo", 1, "bazz", 3 })));
     ASSERT(catch(regexp("foo", "+")));
     ASSERT(catch(regexp( ({ "foo", "bar" }), "+")));
+
+    // same answers once the patterns come from the cache
+    for (int i = 0; i < 3; i++) {
+	ASSERT(regexp("tabba", "a*b"));
+	ASSERT(!regexp("tbba", "a+b"));
+	ASSERT(same_array(regexp( ({ "foo", "bar", "bazz" }), "(oo|zz)", 1),
+			  ({ "foo", 1, "bazz", 3 })));
+	ASSERT(catch(regexp("foo", "+")));
+    }
 }
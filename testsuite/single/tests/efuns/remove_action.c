@@ -1,10 +1,40 @@
 int called = 0;
+string verb;
 
 void func() { called = 1; }
 
+int act() { return 1; }
+
+void create(string v) { verb = v; }
+
+void move(object ob) { move_object(ob); }
+
+void make_living() { enable_commands(); }
+
+void init() {
+    if (verb) {
+        add_action("act", verb);
+        add_action("act", verb + "2");
+    }
+}
+
+int do_command(string str) { return command(str); }
+
+mixed *do_commands() { return commands(); }
+
+// Add first, middle and last, then remove middle twice.
+int *remove_middle() {
+    enable_commands();
+    add_action("act", "first");
+    add_action("act", "middle");
+    add_action("act", "last");
+    return ({ remove_action("act", "middle"), remove_action("act", "middle") });
+}
+
 void do_tests() {
 #ifndef __NO_ADD_ACTION__
-    object tp;
+    object tp, living, a, b, other;
+    int *removed;
 
     SAVETP;
     enable_commands();
@@ -13,5 +43,46 @@ void do_tests() {
     RESTORETP;
     command("bar");
     ASSERT(!called);
+
+#ifndef __NO_ENVIRONMENT__
+    living = new(__FILE__);
+    SAVETP;
+    living->make_living();
+    RESTORETP;
+    other = new(__FILE__);
+    a = new(__FILE__, "poke");
+    b = new(__FILE__, "prod");
+    a->move(living);
+    b->move(living);
+    ASSERT(living->do_command("poke"));
+    ASSERT(living->do_command("prod2"));
+
+    // removing a sentence from the middle leaves the others alone
+    SAVETP;
+    removed = living->remove_middle();
+    RESTORETP;
+    ASSERT_EQ(({ 1, 0 }), removed);
+    ASSERT(!living->do_command("middle"));
+    ASSERT(living->do_command("first"));
+    ASSERT(living->do_command("last"));
+
+    // moving an object away takes only its own sentences
+    a->move(other);
+    ASSERT(!living->do_command("poke"));
+    ASSERT(!living->do_command("poke2"));
+    ASSERT(living->do_command("prod"));
+    ASSERT(living->do_command("prod2"));
+    ASSERT(living->do_command("first"));
+    ASSERT_EQ(4, sizeof(living->do_commands()));
+
+    // and so does destructing it
+    destruct(b);
+    ASSERT(!living->do_command("prod"));
+    ASSERT(living->do_command("last"));
+
+    destruct(a);
+    destruct(other);
+    destruct(living);
+#endif
 #endif
 }
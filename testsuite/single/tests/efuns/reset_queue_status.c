@@ -0,0 +1,32 @@
+void do_tests() {
+    mapping m = reset_queue_status();
+    int queued = m["queued"];
+    mapping st, later;
+    object ob;
+
+    ASSERT(mapp(m));
+    ASSERT(queued > 0);
+    ASSERT(m["due"] <= queued);
+    ASSERT(intp(m["tick usec"]));
+
+    // a clone that can reset joins the queue
+    ob = new("/single/void");
+    queued = reset_queue_status()["queued"];
+    st = reset_queue_status(ob);
+    ASSERT_EQ(1, st["queued"]);
+    ASSERT(st["position"] >= 0 && st["position"] < queued);
+
+    // set_reset() moves it
+    set_reset(ob, 1000);
+    later = reset_queue_status(ob);
+    ASSERT(later["due in"] >= 999 && later["due in"] <= 1000);
+    set_reset(ob, 10);
+    st = reset_queue_status(ob);
+    ASSERT(st["due in"] >= 9 && st["due in"] <= 10);
+    ASSERT(st["position"] <= later["position"]);
+    ASSERT_EQ(queued, reset_queue_status()["queued"]);
+
+    // and destructing it takes it out
+    destruct(ob);
+    ASSERT_EQ(queued - 1, reset_queue_status()["queued"]);
+}
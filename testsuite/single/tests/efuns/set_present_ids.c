@@ -0,0 +1,80 @@
+string id;
+
+int id(string name) { return name == id; }
+
+void ids(mixed arr) {
+#ifndef __NO_ENVIRONMENT__
+  set_present_ids(arr);
+#endif
+}
+
+void move(object ob) {
+  move_object(ob);
+}
+
+void create(string arg) {
+  id = arg;
+}
+
+void do_tests() {
+#ifndef __NO_ENVIRONMENT__
+  object box, a, b, u;
+
+  box = new(__FILE__, "box");
+  a = new(__FILE__, "nothing");
+  b = new(__FILE__, "nothing");
+  a->ids(({ "sword", "blade", "sword" }));
+  b->ids(({ "sword" }));
+  a->move(box);
+  b->move(box);
+
+  // Registered ids take the place of id().
+  ASSERT_EQ(({ "sword", "blade" }), query_present_ids(a));
+  ASSERT_EQ(0, query_present_ids(box));
+  ASSERT_EQ(b, present("sword", box));
+  ASSERT_EQ(b, present("sword 1", box));
+  ASSERT_EQ(a, present("sword 2", box));
+  ASSERT_EQ(0, present("sword 3", box));
+  ASSERT_EQ(a, present("blade", box));
+  ASSERT_EQ(0, present("nothing", box));
+  ASSERT_EQ(0, present("no such id here", box));
+
+  // Objects that registered nothing are still asked.
+  u = new(__FILE__, "sword");
+  u->move(box);
+  ASSERT_EQ(u, present("sword", box));
+  ASSERT_EQ(b, present("sword 2", box));
+  ASSERT_EQ(a, present("sword 3", box));
+  destruct(u);
+  ASSERT_EQ(b, present("sword", box));
+
+  // Changing the ids in place keeps the inventory order.
+  a->ids(({ "axe" }));
+  ASSERT_EQ(0, present("blade", box));
+  ASSERT_EQ(a, present("axe", box));
+  ASSERT_EQ(0, present("sword 2", box));
+  a->ids(({ "sword" }));
+  b->ids(({ "sword", "dagger" }));
+  ASSERT_EQ(b, present("sword", box));
+  ASSERT_EQ(a, present("sword 2", box));
+  ASSERT_EQ(b, present("dagger", box));
+
+  // Unregistering goes back to id().
+  b->ids(0);
+  ASSERT_EQ(0, query_present_ids(b));
+  ASSERT_EQ(a, present("sword", box));
+  ASSERT_EQ(b, present("nothing", box));
+
+  a->move(this_object());
+  ASSERT_EQ(0, present("sword", box));
+  ASSERT_EQ(a, present("sword", this_object()));
+  ASSERT_EQ(a, present("sword"));
+  destruct(a);
+  ASSERT_EQ(0, present("sword", this_object()));
+
+  ASSERT(catch(set_present_ids(({ "ok", 1 }))));
+  ASSERT_EQ(0, query_present_ids(this_object()));
+  destruct(b);
+  destruct(box);
+#endif
+}
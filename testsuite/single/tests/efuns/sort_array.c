@@ -2,8 +2,16 @@ int func(int x, int y) {
   return x - y;
 }
 
+int cmp(mixed x, mixed y) {
+  return x < y ? -1 : x > y;
+}
+
 void do_tests() {
   mixed *tmp;
+  mixed *big;
+  string *words = ({ "", "a", "ab", "abcdefgh", "abcdefghi", "abcdefghij", "abcdefgi", "b", "\xff" });
+  int i;
+
   tmp = ({ 4, 3, 2 , 1 });
 
   // sort with built-in sorter
@@ -14,4 +22,29 @@ void do_tests() {
   ASSERT_EQ(({ 1, 2, 3, 4 }), sort_array(tmp, "func"));
   ASSERT_EQ(({ 1, 2, 3, 4 }), sort_array(tmp, (: $1 - $2 :)));
   ASSERT_EQ(({ 4, 3, 2, 1 }), sort_array(tmp, (: $2 - $1 :)));
+
+  // big arrays of one type take the specialized sorts
+  big = allocate(15000);
+  for (i = 0; i < sizeof(big); i++) {
+    big[i] = random(2000000) - 1000000;
+  }
+  big[0] = MIN_INT;
+  big[1] = MAX_INT;
+  ASSERT_EQ(sort_array(big, (: cmp :)), sort_array(big, 1));
+  ASSERT_EQ(sort_array(big, (: cmp($2, $1) :)), sort_array(big, -1));
+
+  for (i = 0; i < sizeof(big); i++) {
+    big[i] = to_float(random(2000000) - 1000000) / 7;
+  }
+  ASSERT_EQ(sort_array(big, (: cmp :)), sort_array(big, 1));
+
+  for (i = 0; i < sizeof(big); i++) {
+    big[i] = words[random(sizeof(words))] + random(100);
+  }
+  ASSERT_EQ(sort_array(big, (: strcmp :)), sort_array(big, 1));
+  ASSERT_EQ(sort_array(words, (: strcmp :)), sort_array(words, 1));
+
+  // mixed types still go through the generic sort
+  ASSERT_EQ(({ ({ 1 }), ({ 2 }) }), sort_array(({ ({ 2 }), ({ 1 }) }), 1));
+  ASSERT_EQ(({ 0, 1, 2 }), sort_array(({ 2, 0, 1 }), 1));
 }
@@ -0,0 +1,27 @@
+void do_tests() {
+#ifdef __USE_ICONV__
+    string s;
+
+    // ASCII is shared by both encodings and comes back unchanged.
+    ASSERT_EQ("hello", to_utf8("hello", "ISO-8859-1"));
+    ASSERT_EQ("hello", utf8_to("hello", "ISO-8859-1"));
+    // A fresh string is freed along with the argument.
+    s = "hel";
+    ASSERT_EQ("hello", to_utf8(s + "lo", "ISO-8859-1"));
+    ASSERT_EQ("hello", utf8_to(s + "lo", "ISO-8859-1"));
+
+    // Valid UTF-8 passes through a UTF-8 translator as is.
+    s = arr_to_str(({ 0xe9, 0x4e2d, 'x' }));
+    ASSERT_EQ(s, to_utf8(s, "UTF-8"));
+    ASSERT_EQ(s, utf8_to(s, "UTF-8"));
+    ASSERT_EQ(s + s, to_utf8(s + s, "UTF-8"));
+    ASSERT_EQ(({ 0xe9, 0x4e2d, 'x' }), str_to_arr(s)[0..2]);
+
+    // Latin-1 bytes are not UTF-8 and must really be converted.
+    s = utf8_to("caf" + arr_to_str(({ 0xe9 })), "ISO-8859-1");
+    ASSERT_EQ(4, strlen(s));
+    ASSERT_EQ("caf" + arr_to_str(({ 0xe9 })), to_utf8(s, "ISO-8859-1"));
+
+    ASSERT(catch(to_utf8("hello", "no-such-encoding")));
+#endif
+}
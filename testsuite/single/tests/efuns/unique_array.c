@@ -0,0 +1,28 @@
+void do_tests() {
+    mixed *arr = ({ 1, 2, 3, 4, 5, 6 });
+    mixed *big = ({ });
+    mixed *res;
+    int i;
+
+    // Groups come in the order their first member appears.
+    ASSERT_EQ(({ ({ 1, 3, 5 }), ({ 2, 4, 6 }) }), unique_array(arr, (: $1 % 2 + 1 :)));
+    // Anything that matches the skip value, 0 by default, is left out.
+    ASSERT_EQ(({ ({ 1, 3, 5 }) }), unique_array(arr, (: $1 % 2 :)));
+    ASSERT_EQ(({ ({ 1, 2, 3 }) }), unique_array(arr, (: $1 / 4 :), 1));
+    ASSERT_EQ(({ }), unique_array(({ }), (: $1 :)));
+    ASSERT_EQ(({ ({ 1, 2 }), ({ 3, 4 }) }),
+              unique_array(({ 1, 2, 3, 4 }), (: $1 < 3 ? ($1 == 1 ? 0.0 : -0.0) : 1.0 :), -1));
+    ASSERT_EQ(({ ({ "ab", "ac" }), ({ "b" }) }),
+              unique_array(({ "ab", "b", "ac" }), (: $1[0..0] :)));
+
+    for (i = 0; i < 2000; i++) {
+        big += ({ i });
+    }
+    res = unique_array(big, (: "k" + ($1 % 100) :));
+    ASSERT_EQ(100, sizeof(res));
+    for (i = 0; i < 100; i++) {
+        ASSERT_EQ(20, sizeof(res[i]));
+        ASSERT_EQ(i, res[i][0]);
+        ASSERT_EQ(1900 + i, res[i][19]);
+    }
+}
@@ -0,0 +1,64 @@
+mixed *numbers(int from, int to) {
+    mixed *ret = ({ });
+    int i;
+
+    for (i = from; i < to; i++) {
+        ret += ({ i });
+    }
+    return ret;
+}
+
+void do_tests() {
+    mixed *a = ({ 1, "two", 3.0, 4, "two", 0 });
+    mixed *big, *other, *res;
+    int i;
+
+    ASSERT_EQ(({ 3.0, 4, 0 }), a - ({ 1, "two" }));
+    ASSERT_EQ(({ 1, 3.0, 0 }), a - ({ 4, "two", 3 }));
+    ASSERT_EQ(a, a - ({ }));
+    ASSERT_EQ(({ }), ({ }) - a);
+    ASSERT_EQ(({ }), a - a);
+    ASSERT_EQ(({ "two", 4, "two" }), a & ({ 4, "tw" + "o", 9 }));
+    ASSERT_EQ(({ 4, "two" }), ({ 4, "two", 9 }) & a);
+    ASSERT_EQ(({ }), a & ({ }));
+    ASSERT_EQ(({ 1, 2, 3, 4, 5, 5 }), ({ 1, 2, 3 }) | ({ 3, 4, 5, 5, 1 }));
+    ASSERT_EQ(a, a | a);
+
+    // 1 and 1.0 are different elements.
+    ASSERT_EQ(({ 1 }), ({ 1, 1.0 }) - ({ 1.0 }));
+
+    // Big enough for the sorted lookup.  "aB" and "b\x1d" hash the same.
+    big = numbers(0, 40) + ({ "aB", 1.0 });
+    other = numbers(20, 60) + ({ "b\x1d", "aB" });
+    ASSERT_EQ(numbers(0, 20) + ({ 1.0 }), big - other);
+    ASSERT_EQ(numbers(20, 40) + ({ "aB" }), other & big);
+    ASSERT_EQ(big + numbers(40, 60) + ({ "b\x1d" }), big | other);
+
+    // Big enough to go through the hash table.
+    big = numbers(0, 1000);
+    other = numbers(500, 1500);
+    ASSERT_EQ(numbers(0, 500), big - other);
+    ASSERT_EQ(numbers(500, 1000), big & other);
+    ASSERT_EQ(numbers(0, 1500), big | other);
+    res = map(big, (: "s" + $1 :)) - map(other, (: "s" + $1 :));
+    ASSERT_EQ(map(numbers(0, 500), (: "s" + $1 :)), res);
+
+    res = big;
+    res -= other;
+    ASSERT_EQ(500, sizeof(res));
+    ASSERT_EQ(1000, sizeof(big));
+    for (i = 0; i < 500; i++) {
+        ASSERT_EQ(i, res[i]);
+    }
+    res = big;
+    res &= other;
+    ASSERT_EQ(numbers(500, 1000), res);
+    res = big;
+    res |= other;
+    ASSERT_EQ(numbers(0, 1500), res);
+
+    // Destructed objects turn into 0 first.
+    res = ({ new("/single/void"), 0, 1 });
+    destruct(res[0]);
+    ASSERT_EQ(({ 1 }), res - ({ 0 }));
+}